@@ -0,0 +1,76 @@
+#include "server.h"
+#include "socket.h"
+#include "sig.h"
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_PORT          "3101"
+#define BENCH_CLIENTS       8
+#define BENCH_CONNECTIONS   1000    // Per client.
+
+class StormServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {}
+public:
+    StormServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Measures the accept rate of a sharded server, with many clients
+///  connecting and disconnecting as fast as possible at the same time.
+static void bench_shards(int shards) {
+    pid_t server_pid;
+    pid_t clients[BENCH_CLIENTS];
+    double begin, total;
+
+    fflush(stdout);
+    if ( (server_pid = fork()) == 0) {
+        StormServer server("127.0.0.1", BENCH_PORT);
+        server.start_sharded(shards, true, 1024);
+        exit(0);
+    }
+    while(!Socket::is_listening("127.0.0.1", BENCH_PORT));
+    begin = now_us();
+    for (int i = 0; i < BENCH_CLIENTS; i++) {
+        if ( (clients[i] = fork()) == 0) {
+            for (int j = 0; j < BENCH_CONNECTIONS; j++) {
+                Socket socket("127.0.0.1", BENCH_PORT);
+            }
+            exit(0);
+        }
+    }
+    for (int i = 0; i < BENCH_CLIENTS; i++) {
+        waitpid(clients[i], NULL, 0);
+    }
+    total = now_us() - begin;
+    Signal::kill(server_pid, SIGINT);
+    waitpid(server_pid, NULL, 0);
+
+    printf("%3d shards %10.0f accepts/s\n", shards,
+        (BENCH_CLIENTS * BENCH_CONNECTIONS) / (total / 1e6));
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf(INFO("Accept: %d clients, %d connections each, %d CPUs\n"),
+        BENCH_CLIENTS, BENCH_CONNECTIONS, cpus);
+    for (int shards = 1; shards < cpus; shards *= 2) {
+        bench_shards(shards);
+    }
+    bench_shards(cpus);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "shm_arena.h"
+#include <sys/wait.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_ID        14
+#define BENCH_BLOCKS    1000000
+#define BENCH_ENTRIES   (8 * 1024 * 1024)  // 64 MB table of longs.
+#define BENCH_READERS   8
+
+typedef std::vector<long, ShmAllocator<long>> shm_vector;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Allocates and frees blocks of 16 to 1024 bytes, with malloc() and
+///  with the arena.
+static void bench_allocate(void) {
+    ShmArena arena(".", BENCH_ID, 256 * 1024 * 1024);
+    std::vector<void*> blocks(1024);
+    double begin, heap, shared;
+
+    begin = now_us();
+    for (int i = 0; i < BENCH_BLOCKS; i++) {
+        free(blocks[i % 1024]);
+        blocks[i % 1024] = malloc(16 << (i % 7));
+    }
+    heap = now_us() - begin;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        free(blocks[i]);
+        blocks[i] = NULL;
+    }
+    begin = now_us();
+    for (int i = 0; i < BENCH_BLOCKS; i++) {
+        arena.deallocate(blocks[i % 1024]);
+        blocks[i % 1024] = arena.allocate(16 << (i % 7));
+    }
+    shared = now_us() - begin;
+    printf("allocate   malloc %6.1f ns/block   arena %6.1f ns/block\n",
+        heap * 1e3 / BENCH_BLOCKS, shared * 1e3 / BENCH_BLOCKS);
+}
+
+/// @brief Every reader gets the table and sums it: by copying it from a flat
+///  shared memory into its own std::vector, or by using the arena's in place.
+static void bench_startup(void) {
+    ShmArena arena(".", BENCH_ID, BENCH_ENTRIES * sizeof(long) + 1024 * 1024);
+    SharedMemory<long> flat(".", BENCH_ID + 1, BENCH_ENTRIES);
+    shm_vector* table = arena.construct<shm_vector>(ShmAllocator<long>(arena));
+    double begin, copy, in_place;
+
+    table->resize(BENCH_ENTRIES);
+    for (long i = 0; i < BENCH_ENTRIES; i++) {
+        (*table)[i] = i;
+        flat[i] = i;
+    }
+    arena.set_root(table);
+    fflush(stdout);
+    begin = now_us();
+    for (int r = 0; r < BENCH_READERS; r++) {
+        if (fork() == 0) {
+            SharedMemory<long> child_flat(".", BENCH_ID + 1);
+            std::vector<long> local(child_flat.get_size());
+            long sum = 0;
+            child_flat.read(local.data(), local.size());
+            for (size_t i = 0; i < local.size(); i++) {
+                sum += local[i];
+            }
+            exit(sum == 0);
+        }
+    }
+    for (int r = 0; r < BENCH_READERS; r++) {
+        wait(NULL);
+    }
+    copy = now_us() - begin;
+    begin = now_us();
+    for (int r = 0; r < BENCH_READERS; r++) {
+        if (fork() == 0) {
+            ShmArena child_arena(".", BENCH_ID);
+            shm_vector* child_table = (shm_vector*) child_arena.get_root();
+            long sum = 0;
+            for (size_t i = 0; i < child_table->size(); i++) {
+                sum += (*child_table)[i];
+            }
+            exit(sum == 0);
+        }
+    }
+    for (int r = 0; r < BENCH_READERS; r++) {
+        wait(NULL);
+    }
+    in_place = now_us() - begin;
+    printf("startup    copy %8.1f ms (%d MB per reader)   in place %8.1f ms (0 MB)\n",
+        copy / 1e3, (int) (BENCH_ENTRIES * sizeof(long) >> 20), in_place / 1e3);
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Arena: %d allocations, and %d readers of a %d MB table\n"),
+        BENCH_BLOCKS, BENCH_READERS, (int) (BENCH_ENTRIES * sizeof(long) >> 20));
+    bench_allocate();
+    bench_startup();
+    return 0;
+}
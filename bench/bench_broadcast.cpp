@@ -0,0 +1,116 @@
+#include "msg_queue.h"
+#include "shm_broadcast.h"
+#include <sys/wait.h>
+#include <time.h>
+#include <string.h>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_UPDATES       50000
+#define BENCH_SUBSCRIBERS   20
+#define BENCH_FIRST_ID      20
+
+typedef struct update_t {
+    char symbol[8];
+    double price;
+    long sequence;
+} update_t;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void print_result(const char* name, double publish, double total, unsigned long lost) {
+    printf("%-10s %8.3f us/update to publish   %10.0f updates/s delivered   %lu lost\n", name,
+        publish / BENCH_UPDATES, (double) BENCH_UPDATES * BENCH_SUBSCRIBERS / (total / 1e6), lost);
+}
+
+/// @brief Fans out each update with one MsgQueue per subscriber.
+static void bench_msg_queue(void) {
+    MsgQueue<update_t>* queues[BENCH_SUBSCRIBERS];
+    double begin, publish;
+    update_t update;
+
+    for (int s = 0; s < BENCH_SUBSCRIBERS; s++) {
+        queues[s] = new MsgQueue<update_t>(".", BENCH_FIRST_ID + s, true);
+    }
+    fflush(stdout);
+    for (int s = 0; s < BENCH_SUBSCRIBERS; s++) {
+        if (fork() == 0) {
+            MsgQueue<update_t> queue(".", BENCH_FIRST_ID + s);
+            for (int i = 0; i < BENCH_UPDATES; i++) {
+                queue >> update;
+            }
+            exit(0);
+        }
+    }
+    memset(&update, 0, sizeof(update_t));
+    strcpy(update.symbol, "CCOTTI");
+    begin = now_us();
+    for (int i = 0; i < BENCH_UPDATES; i++) {
+        update.sequence = i;
+        for (int s = 0; s < BENCH_SUBSCRIBERS; s++) {
+            *queues[s] << update;
+        }
+    }
+    publish = now_us() - begin;
+    for (int s = 0; s < BENCH_SUBSCRIBERS; s++) {
+        wait(NULL);
+    }
+    print_result("msg_queue", publish, now_us() - begin, 0);
+    for (int s = 0; s < BENCH_SUBSCRIBERS; s++) {
+        delete queues[s];
+    }
+}
+
+/// @brief Publishes each update once, to every subscriber of a ShmBroadcast.
+///  Subscribers report how many updates they lost in their exit status.
+static void bench_broadcast(void) {
+    ShmBroadcast<update_t> channel(".", BENCH_FIRST_ID, BENCH_UPDATES);
+    double begin, publish;
+    unsigned long lost = 0;
+    update_t update;
+    int status;
+
+    fflush(stdout);
+    for (int s = 0; s < BENCH_SUBSCRIBERS; s++) {
+        if (fork() == 0) {
+            ShmBroadcast<update_t> subscriber(".", BENCH_FIRST_ID);
+            subscriber.seek_oldest();
+            update.sequence = -1;
+            do {
+                update = subscriber.read(&status);
+            } while (status == EOVERFLOW || update.sequence < BENCH_UPDATES - 1);
+            exit(subscriber.get_lost() > 255 ? 255 : subscriber.get_lost());
+        }
+    }
+    memset(&update, 0, sizeof(update_t));
+    strcpy(update.symbol, "CCOTTI");
+    begin = now_us();
+    for (int i = 0; i < BENCH_UPDATES; i++) {
+        update.sequence = i;
+        channel << update;
+    }
+    publish = now_us() - begin;
+    for (int s = 0; s < BENCH_SUBSCRIBERS; s++) {
+        wait(&status);
+        lost += WEXITSTATUS(status);
+    }
+    print_result("broadcast", publish, now_us() - begin, lost);
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Broadcast: %d updates of %zu bytes to %d subscribers\n"),
+        BENCH_UPDATES, sizeof(update_t), BENCH_SUBSCRIBERS);
+    bench_msg_queue();
+    bench_broadcast();
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "server.h"
+#include "socket.h"
+#include "buffered_socket.h"
+#include "sig.h"
+#include <sys/wait.h>
+#include <time.h>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_PORT          "3103"
+#define BENCH_RECORDS       100000
+
+/// @brief Reads "<int> <char>" records until a negative number, and answers
+///  with the number of records read.
+class RecordServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {
+        BufferedSocket buffered(socket);
+        int number, records = 0;
+        char c;
+        try {
+            while (true) {
+                buffered >> number >> c;
+                if (number < 0) {
+                    buffered << records;
+                    buffered.flush();
+                    return;
+                }
+                records++;
+            }
+        } catch (std::runtime_error& e) {}
+    }
+public:
+    RecordServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Writes BENCH_RECORDS records, plus the closing one, through the
+///  stream operators of either a Socket or a BufferedSocket.
+template <typename T>
+static void send_records(T& stream) {
+    for (int i = 0; i < BENCH_RECORDS; i++) {
+        stream << i << 'x';
+    }
+    stream << -1 << 'x';
+}
+
+static void bench_operators(const char* name, bool use_buffer, double writes) {
+    double begin, total;
+    int records;
+    pid_t pid;
+
+    fflush(stdout);
+    if ( (pid = fork()) == 0) {
+        RecordServer server("localhost", BENCH_PORT);
+        server.start();
+        exit(0);
+    }
+    while(!Socket::is_listening("localhost", BENCH_PORT));
+    Socket socket("localhost", BENCH_PORT);
+    {
+        BufferedSocket buffered(socket);
+        begin = now_us();
+        if (use_buffer) {
+            send_records(buffered);
+        } else {
+            send_records(socket);
+        }
+        buffered >> records;
+        total = now_us() - begin;
+    }
+    socket.close();
+    Signal::kill(pid, SIGINT);
+    waitpid(pid, NULL, 0);
+    printf("%-10s %10.0f records/s   %8.5f writes/record   (%d records)\n", name,
+        BENCH_RECORDS / (total / 1e6), writes / BENCH_RECORDS, records);
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Buffered: %d records written with \"<< int << char\"\n"), BENCH_RECORDS);
+    bench_operators("socket", false, 2.0 * BENCH_RECORDS);
+    bench_operators("buffered", true,
+        (double) BENCH_RECORDS * (sizeof(int) + sizeof(char)) / BUFFERED_SIZE);
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "server.h"
+#include "socket.h"
+#include "framed_socket.h"
+#include "sig.h"
+#include <sys/wait.h>
+#include <time.h>
+#include <string.h>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_PORT          "3102"
+#define BENCH_MESSAGES      200000
+#define BENCH_BATCH         64
+
+typedef struct msg_t {
+    char text[50];
+    int number;
+} msg_t;
+
+/// @brief Receives fixed size structs until one with a negative number.
+class FixedServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {
+        msg_t msg;
+        while (socket.read(&msg, sizeof(msg_t), MSG_WAITALL) == sizeof(msg_t)) {
+            if (msg.number < 0) {
+                socket.write(&msg, sizeof(msg_t));
+                return;
+            }
+        }
+    }
+public:
+    FixedServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+/// @brief Receives frames until an empty text.
+class FramedServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {
+        FramedSocket framed(socket);
+        char text[sizeof(msg_t)];
+        int len;
+        while ( (len = framed.read_frame(text, sizeof(text))) > 0) {
+            if (len == 1 && text[0] == '\0') {
+                framed.write_frame(text, len);
+                return;
+            }
+        }
+    }
+public:
+    FramedServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void print_result(const char* name, double total, double bytes, double writes) {
+    printf("%-8s %10.0f msg/s   %6.1f bytes/msg   %6.3f writes/msg\n", name,
+        BENCH_MESSAGES / (total / 1e6), bytes / BENCH_MESSAGES, writes / BENCH_MESSAGES);
+}
+
+/// @brief One "msg_t" per Socket::write(), as done by hand until now.
+static void bench_fixed(void) {
+    double begin, total;
+    msg_t msg;
+    pid_t pid;
+
+    fflush(stdout);
+    if ( (pid = fork()) == 0) {
+        FixedServer server("localhost", BENCH_PORT);
+        server.start();
+        exit(0);
+    }
+    while(!Socket::is_listening("localhost", BENCH_PORT));
+    Socket socket("localhost", BENCH_PORT);
+    memset(&msg, 0, sizeof(msg_t));
+    begin = now_us();
+    for (int i = 0; i < BENCH_MESSAGES; i++) {
+        sprintf(msg.text, "message %d", i);
+        msg.number = i;
+        socket.write(&msg, sizeof(msg_t));
+    }
+    msg.number = -1;
+    socket.write(&msg, sizeof(msg_t));
+    socket.read(&msg, sizeof(msg_t), MSG_WAITALL);
+    total = now_us() - begin;
+    socket.close();
+    Signal::kill(pid, SIGINT);
+    waitpid(pid, NULL, 0);
+    print_result("fixed", total, (double) BENCH_MESSAGES * sizeof(msg_t), BENCH_MESSAGES);
+}
+
+/// @brief The same text sent as frames, flushed every BENCH_BATCH messages.
+static void bench_framed(void) {
+    double begin, total, bytes = 0, writes = 0;
+    char text[sizeof(msg_t)];
+    int len;
+    pid_t pid;
+
+    fflush(stdout);
+    if ( (pid = fork()) == 0) {
+        FramedServer server("localhost", BENCH_PORT);
+        server.start();
+        exit(0);
+    }
+    while(!Socket::is_listening("localhost", BENCH_PORT));
+    Socket socket("localhost", BENCH_PORT);
+    FramedSocket framed(socket);
+    begin = now_us();
+    for (int i = 0; i < BENCH_MESSAGES; i++) {
+        len = sprintf(text, "message %d", i) + 1;
+        framed.write_frame(text, len, true);
+        bytes += len + 1;   // Texts shorter than 128 bytes use a 1 byte prefix.
+        if ((i + 1) % BENCH_BATCH == 0) {
+            framed.flush();
+            writes++;
+        }
+    }
+    text[0] = '\0';
+    framed.write_frame(text, 1);
+    framed.read_frame(text, sizeof(text));
+    total = now_us() - begin;
+    socket.close();
+    Signal::kill(pid, SIGINT);
+    waitpid(pid, NULL, 0);
+    print_result("framed", total, bytes, writes);
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Framing: %d one-way messages, framed ones flushed every %d\n"),
+        BENCH_MESSAGES, BENCH_BATCH);
+    bench_fixed();
+    bench_framed();
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "shm_hash_map.h"
+#include <sys/wait.h>
+#include <signal.h>
+#include <time.h>
+#include <unordered_map>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_ID        15
+#define BENCH_KEYS      1000000
+#define BENCH_LOOKUPS   10000000
+#define BENCH_READERS   4
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Looks up random keys, half of them missing, in a local
+///  std::unordered_map and in the shared map.
+static void bench_lookup(ShmHashMap<long, long>& map) {
+    std::unordered_map<long, long> local;
+    unsigned long index = 1;
+    double begin, heap, shared;
+    long value, found = 0;
+
+    local.reserve(BENCH_KEYS);
+    for (long k = 0; k < BENCH_KEYS; k++) {
+        local[k] = k;
+    }
+    begin = now_us();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        index = index * 6364136223846793005UL + 1442695040888963407UL;
+        found += local.count((index >> 16) % (2 * BENCH_KEYS));
+    }
+    heap = now_us() - begin;
+    begin = now_us();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        index = index * 6364136223846793005UL + 1442695040888963407UL;
+        found += map.find((index >> 16) % (2 * BENCH_KEYS), value);
+    }
+    shared = now_us() - begin;
+    printf("lookup     unordered_map %6.1f ns   shm hash map %6.1f ns   (%ld found)\n",
+        heap * 1e3 / BENCH_LOOKUPS, shared * 1e3 / BENCH_LOOKUPS, found);
+}
+
+/// @brief Readers look up random keys while a writer updates them.
+static void bench_concurrent(ShmHashMap<long, long>& map) {
+    double begin, total;
+    int status, lookups = BENCH_LOOKUPS / BENCH_READERS;
+    pid_t writer;
+
+    fflush(stdout);
+    if ( (writer = fork()) == 0) {
+        ShmHashMap<long, long> child_map(".", BENCH_ID);
+        for (long i = 0; ; i++) {
+            child_map.insert(i % BENCH_KEYS, i);
+        }
+    }
+    begin = now_us();
+    for (int r = 0; r < BENCH_READERS; r++) {
+        if (fork() == 0) {
+            ShmHashMap<long, long> child_map(".", BENCH_ID);
+            unsigned long index = r + 1;
+            long value, found = 0;
+            for (int i = 0; i < lookups; i++) {
+                index = index * 6364136223846793005UL + 1442695040888963407UL;
+                found += child_map.find((index >> 16) % BENCH_KEYS, value);
+            }
+            exit(found != lookups);
+        }
+    }
+    for (int r = 0; r < BENCH_READERS; r++) {
+        wait(&status);
+    }
+    total = now_us() - begin;
+    kill(writer, SIGKILL);
+    waitpid(writer, NULL, 0);
+    printf("concurrent %d readers + 1 writer: %10.0f lookups/s\n", BENCH_READERS,
+        BENCH_LOOKUPS / (total / 1e6));
+}
+
+/// @brief Nanoseconds per lookup of a missing key.
+static double miss_ns(ShmHashMap<long, long>& map) {
+    double begin = now_us();
+    long value, found = 0;
+    for (long k = 0; k < BENCH_LOOKUPS; k++) {
+        found += map.find(-1 - k, value);
+    }
+    return (now_us() - begin) * 1e3 / (BENCH_LOOKUPS + found);
+}
+
+/// @brief Misses in a half full map, before and after inserting and erasing
+///  many other keys.
+static void bench_churn(void) {
+    ShmHashMap<long, long> map(".", BENCH_ID + 1, BENCH_KEYS);
+    double fresh, churned, begin;
+    for (long k = 0; k < BENCH_KEYS / 2; k++) {
+        map.insert(k, k);
+    }
+    fresh = miss_ns(map);
+    begin = now_us();
+    for (long k = BENCH_KEYS; k < 5 * BENCH_KEYS; k++) {
+        map.insert(k, k);
+        map.erase(k);
+    }
+    begin = now_us() - begin;
+    churned = miss_ns(map);
+    printf("churn      miss before %6.1f ns   after %6.1f ns   (insert + erase %.1f ns)\n",
+        fresh, churned, begin * 1e3 / (4 * BENCH_KEYS));
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    ShmHashMap<long, long> map(".", BENCH_ID, BENCH_KEYS);
+    double begin = now_us();
+    for (long k = 0; k < BENCH_KEYS; k++) {
+        map.insert(k, k);
+    }
+    printf(INFO("Hash map: %d keys, inserted in %.1f ns each\n"), BENCH_KEYS,
+        (now_us() - begin) * 1e3 / BENCH_KEYS);
+    bench_lookup(map);
+    bench_concurrent(map);
+    bench_churn();
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "journal.h"
+#include <time.h>
+#include <string.h>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_DIR       "./bench_journal_data"
+#define BENCH_RECORDS   1000000
+#define BENCH_RECORD    64
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Removes the journal directory and its files.
+static void remove_journal(void) {
+    DIR* dir_stream = opendir(BENCH_DIR);
+    struct dirent* entry;
+    if (dir_stream == NULL) {
+        return;
+    }
+    while ( (entry = readdir(dir_stream)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            unlink((std::string(BENCH_DIR) + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir_stream);
+    rmdir(BENCH_DIR);
+}
+
+/// @brief Appends "records" records, syncing every "sync_every" of them, and
+///  then reads them back.
+static void bench_journal(const char* name, int records, int sync_every) {
+    char data[BENCH_RECORD];
+    double begin, append, read;
+    int count = 0;
+
+    remove_journal();
+    memset(data, 'x', sizeof(data));
+    {
+        Journal journal(BENCH_DIR, JOURNAL_SEGMENT_SIZE, sync_every, -1);
+        begin = now_us();
+        for (int i = 0; i < records; i++) {
+            memcpy(data, &i, sizeof(i));
+            journal.append(data, sizeof(data));
+        }
+        journal.sync();
+        append = now_us() - begin;
+    }
+    JournalReader reader(BENCH_DIR, "bench");
+    begin = now_us();
+    while (reader.read(data, sizeof(data)) > 0) {
+        count++;
+    }
+    read = now_us() - begin;
+    printf("%-12s %10.0f appends/s   %10.0f reads/s   (%d records)\n", name,
+        records / (append / 1e6), count / (read / 1e6), count);
+    remove_journal();
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Journal: records of %d bytes, synced every N records\n"), BENCH_RECORD);
+    bench_journal("sync 1", BENCH_RECORDS / 500, 1);
+    bench_journal("sync 64", BENCH_RECORDS / 10, 64);
+    bench_journal("sync 1024", BENCH_RECORDS, 1024);
+    bench_journal("sync at end", BENCH_RECORDS, 0);
+    return 0;
+}
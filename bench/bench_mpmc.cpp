@@ -0,0 +1,96 @@
+#include "msg_queue.h"
+#include "shm_mpmc_queue.h"
+#include <sys/wait.h>
+#include <time.h>
+#include <string.h>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_MESSAGES  320000
+#define BENCH_CAPACITY  1024
+
+typedef struct msg_t {
+    char text[50];
+    int number;
+} msg_t;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Sends BENCH_MESSAGES through a queue of type "queue_t", split
+///  between "processes" producers and read by as many consumers.
+template <class queue_t>
+static double bench_queue(int processes, queue_t* (*create)(void), queue_t* (*connect)(void)) {
+    queue_t* queue = create();
+    int per_process = BENCH_MESSAGES / processes;
+    double begin, total;
+
+    fflush(stdout);
+    begin = now_us();
+    for (int p = 0; p < processes; p++) {
+        if (fork() == 0) {
+            queue_t* child_queue = connect();
+            msg_t msg;
+            memset(&msg, 0, sizeof(msg_t));
+            strcpy(msg.text, "message");
+            for (int i = 0; i < per_process; i++) {
+                msg.number = i;
+                *child_queue << msg;
+            }
+            delete child_queue;
+            exit(0);
+        }
+        if (fork() == 0) {
+            queue_t* child_queue = connect();
+            msg_t msg;
+            for (int i = 0; i < per_process; i++) {
+                *child_queue >> msg;
+            }
+            delete child_queue;
+            exit(0);
+        }
+    }
+    for (int p = 0; p < 2 * processes; p++) {
+        wait(NULL);
+    }
+    total = now_us() - begin;
+    delete queue;
+    return per_process * processes / (total / 1e6);
+}
+
+static MsgQueue<msg_t>* create_msg_queue(void) {
+    return new MsgQueue<msg_t>(".", 11, true);
+}
+
+static MsgQueue<msg_t>* connect_msg_queue(void) {
+    return new MsgQueue<msg_t>(".", 11);
+}
+
+static ShmMpmcQueue<msg_t>* create_mpmc_queue(void) {
+    return new ShmMpmcQueue<msg_t>(".", 11, BENCH_CAPACITY);
+}
+
+static ShmMpmcQueue<msg_t>* connect_mpmc_queue(void) {
+    return new ShmMpmcQueue<msg_t>(".", 11);
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("MPMC: %d messages of %zu bytes, N producers and N consumers\n"),
+        BENCH_MESSAGES, sizeof(msg_t));
+    printf("%4s %16s %16s\n", "N", "msg_queue", "shm_mpmc");
+    for (int processes = 1; processes <= 32; processes *= 2) {
+        double msg_queue = bench_queue(processes, create_msg_queue, connect_msg_queue);
+        double shm_mpmc = bench_queue(processes, create_mpmc_queue, connect_mpmc_queue);
+        printf("%4d %10.0f msg/s %10.0f msg/s\n", processes, msg_queue, shm_mpmc);
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "mutex.h"
+#include "sem.h"
+#include "shared_memory.h"
+#include <sys/wait.h>
+#include <time.h>
+#include <new>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_ID            18
+#define BENCH_LOCKS         1000000
+#define BENCH_PROCESSES     2
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Each process locks, increments a shared counter and unlocks,
+///  "BENCH_LOCKS" times. Prints the time per lock and unlock.
+template <class lock_t, class unlock_t>
+static void bench_lock(const char* name, int processes, lock_t lock, unlock_t unlock) {
+    SharedMemory<long> counter(".", BENCH_ID + 1, 1);
+    double begin, total;
+
+    counter[0] = 0;
+    fflush(stdout);
+    begin = now_us();
+    for (int p = 0; p < processes; p++) {
+        if (fork() == 0) {
+            for (int i = 0; i < BENCH_LOCKS; i++) {
+                lock();
+                counter[0]++;
+                unlock();
+            }
+            exit(0);
+        }
+    }
+    for (int p = 0; p < processes; p++) {
+        wait(NULL);
+    }
+    total = now_us() - begin;
+    printf("%-12s %d process(es) %8.1f ns/lock   counter %s\n", name, processes,
+        total * 1e3 / (processes * BENCH_LOCKS),
+        (counter[0] == (long) processes * BENCH_LOCKS) ? "ok" : "WRONG");
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    SharedMemory<char> shm(".", BENCH_ID, sizeof(SharedMutex));
+    SharedMutex* mutex = new (&(shm[0])) SharedMutex();
+    Sem sem(".", BENCH_ID, true);
+
+    printf(INFO("Lock, increment and unlock, %d times per process\n"), BENCH_LOCKS);
+    for (int processes = 1; processes <= BENCH_PROCESSES; processes++) {
+        bench_lock("Sem", processes, [&]() { sem.op(-1); }, [&]() { sem.op(1); });
+        bench_lock("SharedMutex", processes, [&]() { mutex->lock(); }, [&]() { mutex->unlock(); });
+    }
+    mutex->~SharedMutex();
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "msg_queue.h"
+#include "shm_ring_queue.h"
+#include <sys/wait.h>
+#include <time.h>
+#include <string.h>
+#include <algorithm>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_MESSAGES  500000
+#define BENCH_CAPACITY  1024
+#define BENCH_BATCH     64
+#define BENCH_TEXT_MAX  4096
+
+// Fixed size message, sized for the longest text.
+typedef struct text_t {
+    char text[BENCH_TEXT_MAX];
+} text_t;
+
+typedef struct msg_t {
+    char text[50];
+    int number;
+} msg_t;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Sends BENCH_MESSAGES from a child process to this one through a
+///  queue of type "queue_t", created with "create" and connected to with
+///  "connect".
+template <class queue_t>
+static void bench_queue(const char* name, queue_t* (*create)(void), queue_t* (*connect)(void)) {
+    queue_t* queue = create();
+    double begin, total;
+    msg_t msg;
+    pid_t pid;
+
+    fflush(stdout);
+    begin = now_us();
+    if ( (pid = fork()) == 0) {
+        queue_t* child_queue = connect();
+        memset(&msg, 0, sizeof(msg_t));
+        strcpy(msg.text, "message");
+        for (int i = 0; i < BENCH_MESSAGES; i++) {
+            msg.number = i;
+            *child_queue << msg;
+        }
+        delete child_queue;
+        exit(0);
+    }
+    for (int i = 0; i < BENCH_MESSAGES; i++) {
+        *queue >> msg;
+    }
+    total = now_us() - begin;
+    waitpid(pid, NULL, 0);
+    delete queue;
+    printf("%-10s %10.0f msg/s   %8.3f us/msg\n", name,
+        BENCH_MESSAGES / (total / 1e6), total / BENCH_MESSAGES);
+}
+
+/// @brief Same as bench_queue(), but MsgQueue messages are written and read
+///  in batches of up to BENCH_BATCH.
+static void bench_msg_batch(const char* name) {
+    MsgQueue<msg_t> queue(".", 10, true);
+    msg_t msgs[BENCH_BATCH];
+    double begin, total;
+    int received = 0, result;
+    pid_t pid;
+
+    fflush(stdout);
+    begin = now_us();
+    if ( (pid = fork()) == 0) {
+        MsgQueue<msg_t> child_queue(".", 10);
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < BENCH_MESSAGES; ) {
+            for (int j = 0; j < BENCH_BATCH; j++) {
+                strcpy(msgs[j].text, "message");
+                msgs[j].number = i + j;
+            }
+            if ( (result = child_queue.write_many(msgs, std::min(BENCH_BATCH, BENCH_MESSAGES - i))) == -1) {
+                exit(1);
+            }
+            i += result;
+        }
+        exit(0);
+    }
+    while (received < BENCH_MESSAGES) {
+        if ( (result = queue.read_many(msgs, BENCH_BATCH)) == -1) {
+            break;
+        }
+        received += result;
+    }
+    total = now_us() - begin;
+    waitpid(pid, NULL, 0);
+    printf("%-10s %10.0f msg/s   %8.3f us/msg\n", name,
+        BENCH_MESSAGES / (total / 1e6), total / BENCH_MESSAGES);
+}
+
+/// @brief Sends BENCH_MESSAGES short texts through a MsgQueue, either as
+///  fixed size "text_t" messages or as variable length ones.
+static void bench_msg_text(const char* name, bool variable) {
+    MsgQueue<text_t> queue(".", 10, true);
+    text_t msg;
+    double begin, total;
+    pid_t pid;
+
+    fflush(stdout);
+    begin = now_us();
+    if ( (pid = fork()) == 0) {
+        MsgQueue<text_t> child_queue(".", 10);
+        memset(&msg, 0, sizeof(text_t));
+        for (int i = 0; i < BENCH_MESSAGES; i++) {
+            int len = snprintf(msg.text, BENCH_TEXT_MAX, "message number %d, with some text", i) + 1;
+            if (variable) {
+                child_queue.write(msg.text, len);
+            } else {
+                child_queue.write(msg);
+            }
+        }
+        exit(0);
+    }
+    for (int i = 0; i < BENCH_MESSAGES; i++) {
+        if (variable) {
+            queue.read(msg.text, BENCH_TEXT_MAX);
+        } else {
+            msg = queue.read();
+        }
+    }
+    total = now_us() - begin;
+    waitpid(pid, NULL, 0);
+    printf("%-10s %10.0f msg/s   %8.3f us/msg\n", name,
+        BENCH_MESSAGES / (total / 1e6), total / BENCH_MESSAGES);
+}
+
+/// @brief Measures MsgQueue::is_empty(), which schedulers poll in loops.
+static void bench_is_empty(const char* name, int flags) {
+    MsgQueue<msg_t> queue(".", 10, true, flags);
+    volatile bool empty;
+    double begin, total;
+
+    begin = now_us();
+    for (int i = 0; i < BENCH_MESSAGES; i++) {
+        empty = queue.is_empty();
+    }
+    total = now_us() - begin;
+    (void) empty;
+    printf("%-10s %10.0f calls/s %8.3f us/call\n", name,
+        BENCH_MESSAGES / (total / 1e6), total / BENCH_MESSAGES);
+}
+
+static MsgQueue<msg_t>* create_msg_queue(void) {
+    return new MsgQueue<msg_t>(".", 10, true);
+}
+
+static MsgQueue<msg_t>* connect_msg_queue(void) {
+    return new MsgQueue<msg_t>(".", 10);
+}
+
+static MsgQueue<msg_t>* create_posix_queue(void) {
+    return new MsgQueue<msg_t>(".", 10, true, MSGQ_POSIX);
+}
+
+static MsgQueue<msg_t>* connect_posix_queue(void) {
+    return new MsgQueue<msg_t>(".", 10, false, MSGQ_POSIX);
+}
+
+static ShmRingQueue<msg_t>* create_ring_queue(void) {
+    return new ShmRingQueue<msg_t>(".", 10, BENCH_CAPACITY);
+}
+
+static ShmRingQueue<msg_t>* connect_ring_queue(void) {
+    return new ShmRingQueue<msg_t>(".", 10);
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Queues: %d messages of %zu bytes between two processes\n"),
+        BENCH_MESSAGES, sizeof(msg_t));
+    bench_queue("msg_queue", create_msg_queue, connect_msg_queue);
+    bench_msg_batch("msg_batch");
+    bench_queue("msg_posix", create_posix_queue, connect_posix_queue);
+    bench_queue("shm_ring", create_ring_queue, connect_ring_queue);
+    printf(INFO("Queues: %d texts of about 40 bytes, in %zu byte messages or variable length\n"),
+        BENCH_MESSAGES, sizeof(text_t));
+    bench_msg_text("msg_fixed", false);
+    bench_msg_text("msg_var", true);
+    printf(INFO("Queues: %d calls to MsgQueue::is_empty()\n"), BENCH_MESSAGES);
+    bench_is_empty("msgctl", MSGQ_SYSV);
+    bench_is_empty("stats", MSGQ_SYSV | MSGQ_STATS);
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "server.h"
+#include "socket.h"
+#include "sig.h"
+#include <sys/wait.h>
+#include <time.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_PORT          "3105"
+#define BENCH_FILE_SIZE     (64 * 1024 * 1024)
+#define BENCH_REPEAT        8
+#define BENCH_BUFFER_SIZE   65536
+
+/// @brief Serves the whole file BENCH_REPEAT times to each client, either by
+///  reading it into a buffer and writing it, or with Socket::send_file().
+class BlobServer: public Server {
+private:
+    int fd;
+    bool zero_copy;
+protected:
+    void on_accept(Socket& socket) override {
+        std::vector<char> buffer(BENCH_BUFFER_SIZE);
+        char request;
+        ssize_t len;
+        if (socket.read(&request, sizeof(char)) <= 0) {
+            return;
+        }
+        for (int i = 0; i < BENCH_REPEAT; i++) {
+            if (this->zero_copy) {
+                socket.send_file(this->fd, 0, BENCH_FILE_SIZE);
+                continue;
+            }
+            for (off_t offset = 0; offset < BENCH_FILE_SIZE; offset += len) {
+                len = pread(this->fd, buffer.data(), buffer.size(), offset);
+                socket.write(buffer.data(), len);
+            }
+        }
+    }
+public:
+    BlobServer(const char* ip, const char* port, int fd, bool zero_copy):
+        Server(ip, port), fd(fd), zero_copy(zero_copy) {}
+};
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void bench_blob(const char* name, int fd, bool zero_copy) {
+    std::vector<char> buffer(1 << 20);
+    double begin, total;
+    long received = 0;
+    int len;
+    pid_t pid;
+
+    fflush(stdout);
+    if ( (pid = fork()) == 0) {
+        BlobServer server("localhost", BENCH_PORT, fd, zero_copy);
+        server.start();
+        exit(0);
+    }
+    while(!Socket::is_listening("localhost", BENCH_PORT));
+    Socket socket("localhost", BENCH_PORT);
+    begin = now_us();
+    socket << 'f';
+    while (received < (long) BENCH_FILE_SIZE * BENCH_REPEAT &&
+           (len = socket.read(buffer.data(), buffer.size())) > 0) {
+        received += len;
+    }
+    total = now_us() - begin;
+    socket.close();
+    Signal::kill(pid, SIGINT);
+    waitpid(pid, NULL, 0);
+    printf("%-10s %8.0f MB/s\n", name, received / (total / 1e6) / (1 << 20));
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    char path[] = "/tmp/bench_sendfile_XXXXXX";
+    std::vector<char> data(BENCH_FILE_SIZE, 'x');
+    int fd = mkstemp(path);
+    unlink(path);
+    if (fd == -1 || write(fd, data.data(), data.size()) != (ssize_t) data.size()) {
+        perror(ERROR("Couldn't create the file"));
+        return 1;
+    }
+    printf(INFO("Sendfile: a %d MB file served %d times over loopback\n"),
+        BENCH_FILE_SIZE >> 20, BENCH_REPEAT);
+    bench_blob("read+write", fd, false);
+    bench_blob("send_file", fd, true);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "server.h"
+#include "socket.h"
+#include "sig.h"
+#include <sys/wait.h>
+#include <time.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_PORT          "3100"
+#define BENCH_CONNECTIONS   2000
+
+typedef struct msg_t {
+    char text[50];
+    int number;
+} msg_t;
+
+class BenchServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {
+        msg_t msg;
+        while (socket.read(&msg, sizeof(msg_t)) > 0) {
+            socket.write(&msg, sizeof(msg_t));
+        }
+    }
+    int on_data(Socket& socket, const char* data, int len) override {
+        return this->send_async(socket, data, len);
+    }
+public:
+    BenchServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+static void run_fork(BenchServer& server) {
+    server.start();
+}
+
+static void run_reactor(BenchServer& server) {
+    server.start_reactor();
+}
+
+static void run_pool(BenchServer& server) {
+    server.start_pool();
+}
+
+static void run_prefork(BenchServer& server) {
+    server.start_prefork();
+}
+
+static void run_uring(BenchServer& server) {
+    server.start_uring();
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Measures connections per second and latency of a full
+///  "connect, echo, close" cycle against a server running in some mode.
+static void bench_mode(const char* name, void (*run)(BenchServer&)) {
+    std::vector<double> latency;
+    double start, begin, total;
+    msg_t msg;
+    pid_t pid;
+
+    fflush(stdout);
+    if ( (pid = fork()) == 0) {
+        BenchServer server("localhost", BENCH_PORT);
+        run(server);
+        exit(0);
+    }
+    while(!Socket::is_listening("localhost", BENCH_PORT));
+    strcpy(msg.text, "ping");
+    begin = now_us();
+    for (int i = 0; i < BENCH_CONNECTIONS; i++) {
+        start = now_us();
+        Socket socket("localhost", BENCH_PORT);
+        msg.number = i;
+        socket.write(&msg, sizeof(msg_t));
+        socket.read(&msg, sizeof(msg_t));
+        socket.close();
+        latency.push_back(now_us() - start);
+    }
+    total = now_us() - begin;
+    Signal::kill(pid, SIGINT);
+    waitpid(pid, NULL, 0);
+
+    std::sort(latency.begin(), latency.end());
+    printf("%-10s %10.0f conn/s   p50 %8.1f us   p99 %8.1f us\n", name,
+        BENCH_CONNECTIONS / (total / 1e6),
+        latency[latency.size() / 2],
+        latency[(latency.size() * 99) / 100]);
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Server: %d sequential connect/echo/close cycles\n"), BENCH_CONNECTIONS);
+    bench_mode("fork", run_fork);
+    bench_mode("reactor", run_reactor);
+    bench_mode("pool", run_pool);
+    bench_mode("prefork", run_prefork);
+    bench_mode("uring", run_uring);
+    return 0;
+}
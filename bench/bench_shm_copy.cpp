@@ -0,0 +1,90 @@
+#include "shared_memory.h"
+#include <time.h>
+#include <string.h>
+#include <vector>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_ID        12
+#define BENCH_MAX_SIZE  (1024UL * 1024 * 1024)
+#define BENCH_BYTES     (256UL * 1024 * 1024)   // Bytes copied for each size.
+
+/// @brief A byte that isn't trivially copyable, so SharedMemory copies it
+///  element by element, like it did before the block copy.
+struct slow_byte_t {
+    char value;
+    slow_byte_t& operator= (const slow_byte_t& other) {
+        this->value = other.value;
+        return *this;
+    }
+};
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Prints the throughput, in GB/s, of writing and reading "size" bytes
+///  element by element, as a single block, and with streaming stores.
+static void bench_size(SharedMemory<char>& shm, SharedMemory<slow_byte_t>& slow,
+                       char* buffer, size_t size) {
+    size_t reps = BENCH_BYTES / size ? BENCH_BYTES / size : 1;
+    double begin, loop_w, loop_r, bulk_w, bulk_r, stream_w, stream_r;
+
+    begin = now_us();
+    for (size_t i = 0; i < reps; i++) {
+        slow.write((slow_byte_t*) buffer, size);
+    }
+    loop_w = now_us() - begin;
+    begin = now_us();
+    for (size_t i = 0; i < reps; i++) {
+        slow.read((slow_byte_t*) buffer, size);
+    }
+    loop_r = now_us() - begin;
+    begin = now_us();
+    for (size_t i = 0; i < reps; i++) {
+        shm.write(buffer, size);
+    }
+    bulk_w = now_us() - begin;
+    begin = now_us();
+    for (size_t i = 0; i < reps; i++) {
+        shm.read(buffer, size);
+    }
+    bulk_r = now_us() - begin;
+    begin = now_us();
+    for (size_t i = 0; i < reps; i++) {
+        shm_stream_copy(&shm[0], buffer, size);
+    }
+    stream_w = now_us() - begin;
+    begin = now_us();
+    for (size_t i = 0; i < reps; i++) {
+        shm_stream_copy(buffer, &shm[0], size);
+    }
+    stream_r = now_us() - begin;
+
+    double bytes = (double) size * reps / 1e3;  // GB/s = bytes / us / 1e3
+    printf("%10zu B  loop %6.2f/%6.2f   block %6.2f/%6.2f   stream %6.2f/%6.2f GB/s\n",
+        size, bytes / loop_w, bytes / loop_r, bytes / bulk_w, bytes / bulk_r,
+        bytes / stream_w, bytes / stream_r);
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    SharedMemory<char> shm(".", BENCH_ID, BENCH_MAX_SIZE);
+    SharedMemory<slow_byte_t> slow(".", BENCH_ID);
+    std::vector<char> buffer(BENCH_MAX_SIZE, 'x');
+
+    printf(INFO("SharedMemory copy: write/read throughput (SHM_STREAM_THRESHOLD %d)\n"),
+        SHM_STREAM_THRESHOLD);
+    memset(&shm[0], 0, BENCH_MAX_SIZE);
+    for (size_t size = 64; size <= BENCH_MAX_SIZE; size *= 8) {
+        bench_size(shm, slow, buffer.data(), size);
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "shared_memory.h"
+#include <time.h>
+#include <string.h>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_ID        13
+#define BENCH_SIZE      (512UL * 1024 * 1024 / sizeof(long))  // 512 MB table.
+#define BENCH_LOOKUPS   10000000
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Creates the table with "flags", and measures how long it takes to
+///  create it, to touch every page once, and to read random entries.
+static void bench_pages(const char* name, int flags) {
+    double begin, create, touch, lookup;
+    unsigned long index = 1, sum = 0;
+    try {
+        begin = now_us();
+        SharedMemory<long> table(".", BENCH_ID, BENCH_SIZE, flags);
+        create = now_us() - begin;
+        begin = now_us();
+        for (size_t i = 0; i < BENCH_SIZE; i += 512) {
+            table[i] = i;
+        }
+        touch = now_us() - begin;
+        begin = now_us();
+        for (int i = 0; i < BENCH_LOOKUPS; i++) {
+            index = index * 6364136223846793005UL + 1442695040888963407UL;
+            sum += table[(index >> 16) % BENCH_SIZE];
+        }
+        lookup = now_us() - begin;
+    } catch (std::runtime_error&) {
+        printf("%-18s not available\n", name);
+        return;
+    }
+    printf("%-18s create %8.1f ms   first touch %8.1f ms   %6.1f ns/lookup   (%lu)\n", name,
+        create / 1e3, touch / 1e3, lookup * 1e3 / BENCH_LOOKUPS, sum & 1);
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("SharedMemory pages: %lu MB table, %d random lookups\n"),
+        BENCH_SIZE * sizeof(long) >> 20, BENCH_LOOKUPS);
+    bench_pages("sysv", SHMEM_SYSV);
+    bench_pages("sysv populate", SHMEM_SYSV | SHMEM_POPULATE);
+    bench_pages("posix", SHMEM_POSIX);
+    bench_pages("posix populate", SHMEM_POSIX | SHMEM_POPULATE);
+    bench_pages("memfd thp", SHMEM_MEMFD | SHMEM_THP | SHMEM_POPULATE);
+    bench_pages("sysv hugetlb", SHMEM_SYSV | SHMEM_HUGETLB | SHMEM_POPULATE);
+    bench_pages("memfd hugetlb", SHMEM_MEMFD | SHMEM_HUGETLB | SHMEM_POPULATE);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "shm_rcu.h"
+#include <sys/wait.h>
+#include <signal.h>
+#include <time.h>
+#include <vector>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_ID        17
+#define BENCH_ELEMENTS  (64 * 1024 / 8)
+#define BENCH_READS     20000
+#define BENCH_READERS   2
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Readers check the first and last value of the table, while a writer
+///  rewrites it with equal values. With the seqlock each reader copies the
+///  table out; with ShmRcu it's used in place. Prints snapshots per second and
+///  versions published meanwhile.
+static void bench_snapshot(const char* name, bool rcu_mode) {
+    SharedMemory<long> table(".", BENCH_ID, rcu_mode ? 1 : BENCH_ELEMENTS, SHMEM_SEQLOCK);
+    ShmRcu<long>* rcu = rcu_mode ? new ShmRcu<long>(".", BENCH_ID + 1, BENCH_ELEMENTS) : NULL;
+    SharedMemory<long> published(".", BENCH_ID + 2, 1);
+    std::vector<long> values(BENCH_ELEMENTS, 0);
+    double begin, total;
+    int status, torn = 0;
+    pid_t writer;
+
+    published[0] = 0;
+    fflush(stdout);
+    if ( (writer = fork()) == 0) {
+        for (long i = 1; ; i++) {
+            if (rcu_mode) {
+                long* next = rcu->write_begin(false);
+                for (int j = 0; j < BENCH_ELEMENTS; j++) {
+                    next[j] = i;
+                }
+                rcu->publish();
+            } else {
+                for (int j = 0; j < BENCH_ELEMENTS; j++) {
+                    values[j] = i;
+                }
+                table.write(values.data(), BENCH_ELEMENTS);
+            }
+            published[0] = i;
+        }
+    }
+    begin = now_us();
+    for (int r = 0; r < BENCH_READERS; r++) {
+        if (fork() == 0) {
+            int count = 0;
+            for (int i = 0; i < BENCH_READS; i++) {
+                if (rcu_mode) {
+                    const long* version = rcu->read_lock();
+                    count += version[0] != version[BENCH_ELEMENTS - 1];
+                    rcu->read_unlock();
+                } else {
+                    table.read(values.data(), BENCH_ELEMENTS);
+                    count += values[0] != values[BENCH_ELEMENTS - 1];
+                }
+            }
+            exit(count > 255 ? 255 : count);
+        }
+    }
+    for (int r = 0; r < BENCH_READERS; r++) {
+        wait(&status);
+        torn += WEXITSTATUS(status);
+    }
+    total = now_us() - begin;
+    kill(writer, SIGKILL);
+    waitpid(writer, NULL, 0);
+    printf("%-10s %10.0f snapshots/s %10.0f versions/s   %d torn\n", name,
+        BENCH_READERS * BENCH_READS / (total / 1e6), published[0] / (total / 1e6), torn);
+    delete rcu;
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Snapshots: %d readers of %d longs, while a process rewrites them\n"),
+        BENCH_READERS, BENCH_ELEMENTS);
+    bench_snapshot("seqlock", false);
+    bench_snapshot("rcu", true);
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "shared_memory.h"
+#include "sem.h"
+#include <sys/wait.h>
+#include <signal.h>
+#include <time.h>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_ID        16
+#define BENCH_ELEMENTS  64
+#define BENCH_READS     500000
+#define BENCH_READERS   2
+
+enum bench_mode { MODE_NONE, MODE_SEM, MODE_SEQLOCK };
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// @brief Readers take snapshots of the table while a writer rewrites it with
+///  equal values. A snapshot with different values is torn. Readers report
+///  how many torn snapshots they saw (up to 255) in their exit status.
+static void bench_snapshot(const char* name, int mode) {
+    SharedMemory<long> table(".", BENCH_ID, BENCH_ELEMENTS, (mode == MODE_SEQLOCK) ? SHMEM_SEQLOCK : 0);
+    Sem sem(".", BENCH_ID, true);
+    long values[BENCH_ELEMENTS] = {0};
+    double begin, total;
+    int status, torn = 0;
+    pid_t writer;
+
+    table.write(values, BENCH_ELEMENTS);
+    fflush(stdout);
+    if ( (writer = fork()) == 0) {
+        for (long i = 1; ; i++) {
+            for (int j = 0; j < BENCH_ELEMENTS; j++) {
+                values[j] = i;
+            }
+            if (mode == MODE_SEM) {
+                sem.op(-1);
+            }
+            table.write(values, BENCH_ELEMENTS);
+            if (mode == MODE_SEM) {
+                sem.op(1);
+            }
+        }
+    }
+    begin = now_us();
+    for (int r = 0; r < BENCH_READERS; r++) {
+        if (fork() == 0) {
+            int count = 0;
+            for (int i = 0; i < BENCH_READS; i++) {
+                if (mode == MODE_SEM) {
+                    sem.op(-1);
+                }
+                table.read(values, BENCH_ELEMENTS);
+                if (mode == MODE_SEM) {
+                    sem.op(1);
+                }
+                count += values[0] != values[BENCH_ELEMENTS - 1];
+            }
+            exit(count > 255 ? 255 : count);
+        }
+    }
+    for (int r = 0; r < BENCH_READERS; r++) {
+        wait(&status);
+        torn += WEXITSTATUS(status);
+    }
+    total = now_us() - begin;
+    kill(writer, SIGKILL);
+    waitpid(writer, NULL, 0);
+    printf("%-10s %10.0f snapshots/s   %d%s torn\n", name,
+        BENCH_READERS * BENCH_READS / (total / 1e6), torn, (torn >= 255) ? "+" : "");
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Snapshots: %d readers of %d longs, while a process rewrites them\n"),
+        BENCH_READERS, BENCH_ELEMENTS);
+    bench_snapshot("unlocked", MODE_NONE);
+    bench_snapshot("sem", MODE_SEM);
+    bench_snapshot("seqlock", MODE_SEQLOCK);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "server.h"
+#include "socket.h"
+#include "sig.h"
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <vector>
+
+/******************************************************************************
+ * Benchmark auxiliary definitions
+******************************************************************************/
+
+#define BENCH_PORT          "3106"
+#define BENCH_TOTAL         (2L << 30)
+#define BENCH_CHUNK         (4 << 20)
+#define BENCH_BUFFERS       8
+
+/// @brief Discards everything it receives.
+class SinkServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {
+        std::vector<char> buffer(1 << 20);
+        while (socket.read(buffer.data(), buffer.size()) > 0);
+    }
+public:
+    SinkServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+typedef struct release_t {
+    int free;
+    int copied;
+} release_t;
+
+static void on_release(const void* buf, int len, bool copied, void* arg) {
+    release_t* release = (release_t*) arg;
+    release->free++;
+    release->copied += copied;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double cpu_us(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 +
+        usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/// @brief Sends BENCH_TOTAL bytes in BENCH_CHUNK writes, rotating over
+///  BENCH_BUFFERS buffers. With zero-copy, a buffer is only reused after the
+///  kernel released it. Only the CPU time of the sender is measured.
+static void bench_send(const char* name, bool zero_copy) {
+    std::vector<char> buffers[BENCH_BUFFERS];
+    release_t release = {BENCH_BUFFERS, 0};
+    double begin, total, cpu;
+    long chunks = 0;
+    pid_t pid;
+
+    fflush(stdout);
+    if ( (pid = fork()) == 0) {
+        SinkServer server("localhost", BENCH_PORT);
+        server.start();
+        exit(0);
+    }
+    while(!Socket::is_listening("localhost", BENCH_PORT));
+    Socket socket("localhost", BENCH_PORT);
+    for (int i = 0; i < BENCH_BUFFERS; i++) {
+        buffers[i].assign(BENCH_CHUNK, 'x');
+    }
+    if (zero_copy) {
+        socket.set_zerocopy();
+    }
+    begin = now_us();
+    cpu = cpu_us();
+    for (long sent = 0; sent < BENCH_TOTAL; sent += BENCH_CHUNK, chunks++) {
+        char* buf = buffers[chunks % BENCH_BUFFERS].data();
+        if (!zero_copy) {
+            socket.write(buf, BENCH_CHUNK);
+            continue;
+        }
+        while (release.free == 0) {
+            socket.reap_zerocopy(-1);
+        }
+        release.free--;
+        socket.write_zerocopy(buf, BENCH_CHUNK, on_release, &release);
+        socket.reap_zerocopy(0);
+    }
+    while (socket.get_zerocopy_pending() > 0) {
+        socket.reap_zerocopy(-1);
+    }
+    cpu = cpu_us() - cpu;
+    total = now_us() - begin;
+    socket.close();
+    Signal::kill(pid, SIGINT);
+    waitpid(pid, NULL, 0);
+    printf("%-10s %8.0f MB/s   %6.3f CPU s/GB", name,
+        BENCH_TOTAL / (total / 1e6) / (1 << 20), (cpu / 1e6) / (BENCH_TOTAL / (double) (1 << 30)));
+    if (zero_copy) {
+        printf("   (%ld%% of the buffers were copied by the kernel)", 100L * release.copied / chunks);
+    }
+    printf("\n");
+}
+
+/******************************************************************************
+ * Benchmark
+******************************************************************************/
+
+int main(void) {
+    printf(INFO("Zero-copy: %ld MB sent in %d MB writes over loopback\n"),
+        BENCH_TOTAL >> 20, BENCH_CHUNK >> 20);
+    bench_send("copy", false);
+    bench_send("zerocopy", true);
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef BUFFERED_SOCKET_H
+#define BUFFERED_SOCKET_H
+
+#include "socket.h"
+#include "tools.h"
+#include <sys/uio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+
+// Default size of the send and receive ring buffers of a BufferedSocket.
+#define BUFFERED_SIZE   65536
+
+/// @brief Buffered stream on top of a Socket. Writes are coalesced in a ring
+///  buffer and sent together when BufferedSocket::flush() is called, when the
+///  buffered data reaches a size threshold, or when it gets older than a time
+///  threshold. Reads fill another ring buffer with everything available, and
+///  it can be consumed by delimiter, by exact size, or through views that
+///  point straight into the buffer. Pending writes are always flushed before
+///  blocking on a read, so request/response protocols don't deadlock.
+class BufferedSocket {
+private:
+    /// @brief Byte ring of fixed capacity. "head" is the first used byte.
+    struct Ring {
+        std::vector<char> data;
+        size_t head, len;
+        Ring(size_t size): data(size), head(0), len(0) {}
+        size_t size(void) const {return this->data.size();}
+        int used_iov(struct iovec* iov);
+        int free_iov(struct iovec* iov);
+        void push(const void* src, size_t len);
+        void pop(void* dst, size_t len);
+        const char* linearize(size_t len);
+        void consume(size_t len);
+    };
+    Socket& socket;
+    Ring rx, tx;
+    size_t flush_size;
+    long flush_us;
+    struct timespec first_write;
+
+    int fill(void);
+
+public:
+    BufferedSocket(Socket& socket, size_t buffer_size=BUFFERED_SIZE, size_t flush_size=0, long flush_us=-1);
+    ~BufferedSocket();
+
+    int write(const void* data, int len);
+    int flush(void);
+
+    int read(void* data, int len);
+    int read_exact(void* data, int len);
+    int read_until(char delimiter, void* data, int max_len);
+
+    int peek(const char** view, int len);
+    int peek_until(char delimiter, const char** view);
+    void consume(int len);
+    int available(void) const;
+
+    Socket& get_socket(void);
+
+    BufferedSocket& operator<< (const char* a);
+    BufferedSocket& operator<< (int a);
+    BufferedSocket& operator<< (char a);
+    BufferedSocket& operator>> (int &a);
+    BufferedSocket& operator>> (char &a);
+};
+
+#endif // BUFFERED_SOCKET_H
@@ -0,0 +1,48 @@
+#ifndef FRAMED_SOCKET_H
+#define FRAMED_SOCKET_H
+
+#include "socket.h"
+#include "tools.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <vector>
+
+// Default size of the send and receive buffers of a FramedSocket.
+#define FRAME_BUFFER_SIZE   65536
+// Largest frame accepted, to protect against corrupted length prefixes.
+#define FRAME_MAX_SIZE      (16 * 1024 * 1024)
+// Largest length prefix (a varint of 32 bits).
+#define FRAME_HEADER_MAX    5
+
+/// @brief Message framing on top of a stream Socket. Each frame is sent as a
+///  varint length prefix followed by the payload, so only the used bytes go
+///  on the wire. Frames are accumulated in a send buffer and sent together
+///  with a single syscall, and each read fills the receive buffer with as many
+///  frames as are available, reassembling the ones received partially.
+class FramedSocket {
+private:
+    Socket& socket;
+    std::vector<char> rx;
+    size_t rx_start, rx_end;
+    std::vector<char> tx;
+    size_t tx_len;
+
+    int decode_header(uint32_t* frame_len);
+
+public:
+    FramedSocket(Socket& socket, size_t buffer_size=FRAME_BUFFER_SIZE);
+    ~FramedSocket();
+
+    int write_frame(const void* data, int len, bool more=false);
+    int flush(void);
+    int read_frame(void* data, int max_len);
+    bool has_frame(void);
+
+    Socket& get_socket(void);
+
+    static int encode_varint(uint32_t value, char* buf);
+    static int decode_varint(const char* buf, int len, uint32_t* value);
+};
+
+#endif // FRAMED_SOCKET_H
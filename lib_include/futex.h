@@ -0,0 +1,25 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include "tools.h"
+#include <unistd.h>
+#include <atomic>
+
+/// @brief Thin wrappers over the "futex()" syscall. They are not private to
+///  the process, so the futex word can live in shared memory and be used by
+///  different processes.
+namespace Futex {
+    int wait(void* addr, uint32_t expected, const struct timespec* timeout=NULL);
+    int wake(void* addr, int count=INT_MAX);
+    void lock(std::atomic<uint32_t>& word);
+    void unlock(std::atomic<uint32_t>& word);
+} // namespace Futex
+
+#endif // FUTEX_H
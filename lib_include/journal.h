@@ -0,0 +1,115 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "tools.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdexcept>
+#include <string>
+
+// Default size of each segment file of a Journal.
+#define JOURNAL_SEGMENT_SIZE    (64 * 1024 * 1024)
+// Default time, in microseconds, appended records can wait to be synced.
+#define JOURNAL_SYNC_US         10000
+
+/// @brief Durable append-only queue. Records are appended to memory mapped
+///  segment files inside a directory, so writing one is a memcpy, and they
+///  survive both the process and the machine going down once synced. Syncs
+///  are batched: every "N" records, or when the oldest unsynced record gets
+///  older than "T" microseconds, all of them are flushed together. When a
+///  segment is full, a new one is started. Only one Journal can append at a
+///  time: the directory is locked while it's open.
+///
+///  Each record has an 8 byte header (length and checksum), and is padded to
+///  8 bytes. Records are addressed by their offset: the position of the header
+///  since the beginning of the journal, counting the whole size of previous
+///  segments. Segment files are named after the offset of their first byte.
+///  Readers only see synced records: the end of the last one is published in
+///  the file "synced" of the directory, so a reader can't consume (and commit)
+///  a record that a power loss would erase.
+class Journal {
+private:
+    std::string dir;
+    size_t segment_size;
+    int sync_every;
+    long sync_us;
+    int lock_fd;
+    uint64_t* synced;       // Offset up to which records are durable.
+    int fd;
+    char* segment;
+    size_t current_size;    // Size of the current segment.
+    uint64_t base;          // Offset of the current segment.
+    size_t write_pos;       // Position inside the current segment.
+    size_t synced_pos;      // Bytes of the current segment already synced.
+    int unsynced;
+    struct timespec first_unsynced;
+
+    int open_segment(uint64_t base, bool create);
+    void close_segment(void);
+    int recover(void);
+    void publish_synced(void);
+
+public:
+    Journal(const char* dir, size_t segment_size=JOURNAL_SEGMENT_SIZE, int sync_every=0,
+        long sync_us=JOURNAL_SYNC_US);
+    ~Journal();
+
+    int append(const void* data, size_t len);
+    int sync(void);
+    int trim(uint64_t offset);
+    uint64_t get_offset(void) const;
+
+    // Shared with JournalReader.
+    struct Header {
+        uint32_t len;
+        uint32_t checksum;
+    };
+    static const uint32_t SKIP = UINT32_MAX;    // Rest of the segment unused.
+    static uint32_t checksum(const void* data, size_t len);
+    static size_t record_size(size_t len);
+    static std::string segment_path(const std::string& dir, uint64_t base);
+    static int find_segment(const std::string& dir, uint64_t offset, uint64_t* base);
+    static std::string synced_path(const std::string& dir);
+};
+
+/// @brief Consumer of a Journal, in this or another process. Its offset is
+///  kept in a file named after the consumer, inside the journal directory, so
+///  that after a crash or a restart it replays from the last committed record.
+class JournalReader {
+private:
+    std::string dir;
+    std::string name;
+    int offset_fd;
+    uint64_t* synced;
+    int fd;
+    char* segment;
+    size_t segment_size;
+    uint64_t base;
+    size_t read_pos;
+
+    int open_segment(uint64_t base);
+    void close_segment(void);
+    uint64_t get_synced(void);
+
+public:
+    JournalReader(const char* dir, const char* name);
+    ~JournalReader();
+
+    ssize_t read(void* data, size_t max_len);
+    int commit(void);
+    int seek(uint64_t offset);
+    uint64_t get_offset(void) const;
+};
+
+#endif // JOURNAL_H
@@ -5,10 +5,40 @@
 #include <sys/ipc.h>
 #include <stdio.h>
 #include <sys/msg.h>
+#include <mqueue.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
 #include "tools.h"
+#include "shared_memory.h"
 #include <stdexcept>
 #include <errno.h>
 #include <unistd.h>
+#include <string.h>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+// Options of a MsgQueue, chosen when it's created or connected to. The backend
+// can be "or"ed with MSGQ_STATS.
+#define MSGQ_SYSV   0   // System V queue (msgget). Supports mtype filters and peek.
+#define MSGQ_POSIX  1   // POSIX queue (mq_open). Has a descriptor for poll/epoll.
+#define MSGQ_STATS  2   // Depth and rate counters in a shared memory sidecar.
+
+// Capacity of a POSIX queue, in messages. "10" is the default limit for
+// unprivileged processes (see /proc/sys/fs/mqueue/msg_max).
+#define MSGQ_POSIX_MAXMSG   10
+
+/// @brief Statistics of a queue created with MSGQ_STATS.
+struct MsgQueueStats {
+    int depth;                  // Messages in the queue.
+    int high_water;             // Maximum depth since the creation, or the last reset.
+    unsigned long enqueued;     // Messages written since the creation.
+    unsigned long dequeued;     // Messages read since the creation.
+    double enqueue_rate;        // Messages written per second, since the last call.
+    double dequeue_rate;        // Messages read per second, since the last call.
+};
 
 template <class msg_t>
 class MsgQueue {
@@ -20,18 +50,47 @@ private:
     int msg_id;
     bool creator;
     pid_t pid;
+    int backend;
+    mqd_t mqd;
+    char name[32];
+    // Counters shared by every process using the queue with MSGQ_STATS.
+    struct Stats {
+        alignas(SHM_CACHE_LINE) std::atomic<int32_t> depth;
+        std::atomic<int32_t> high_water;
+        alignas(SHM_CACHE_LINE) std::atomic<uint64_t> enqueued;
+        alignas(SHM_CACHE_LINE) std::atomic<uint64_t> dequeued;
+    };
+    std::unique_ptr<SharedMemory<char>> stats_shm;
+    Stats* stats;
+    // Last counters returned by MsgQueue::get_stats(), to compute rates.
+    MsgQueueStats last_stats;
+    struct timespec last_stats_time;
+
+    static char* get_buffer(size_t len);
+    int send(const void* msgp, size_t len, int flags);
+    ssize_t receive(void* msgp, size_t max_len, long mtype, int flags);
+    static int get_name(const char* path, int id, char* name);
 
 public:
-    MsgQueue(const char* path, int id, bool create=false);
+    MsgQueue(const char* path, int id, bool create=false, int flags=MSGQ_SYSV);
     ~MsgQueue();
-    bool static exists(const char* path, int id);
-    int write(msg_t msg, long mtype=1);
+    bool static exists(const char* path, int id, int backend=MSGQ_SYSV);
+    int write(const msg_t& msg, long mtype=1);
+    int write_many(const msg_t* msgs, int n, long mtype=1, int flags=0);
+    int write(const void* data, size_t len, long mtype=1);
     msg_t read(int mtype=0, int* status=NULL, int flags=0);
+    int read_many(msg_t* msgs, int max_n, long mtype=0, int flags=0);
+    ssize_t read(void* data, size_t max_len, long mtype=0, int flags=0);
     msg_t peek(int index, int* status=NULL);
     int get_msg_qtty(void);
     bool is_empty(void);
     bool has_msg(void);
-    MsgQueue& operator<<(msg_t msg);
+    int get_stats(MsgQueueStats* output);
+    void reset_high_water(void);
+    int get_fd(void);
+    int notify(int signo);
+    int notify(void (*function)(union sigval), void* arg);
+    MsgQueue& operator<<(const msg_t& msg);
     MsgQueue& operator>>(msg_t& msg);
 };
 
@@ -47,12 +106,53 @@ public:
 /// @param id Can be any number. Identifier for the message queue.
 /// @param create If "true", create the queue. If "false", connect to an
 ///  already existing one.
+/// @param flags The backend, MSGQ_SYSV (default) or MSGQ_POSIX, optionally
+///  "or"ed with MSGQ_STATS. All processes must use the same flags.
+///  * A POSIX queue can be waited on with poll/epoll (see MsgQueue::get_fd())
+///  and notify a process when a message arrives (see MsgQueue::notify()), but
+///  it holds at most MSGQ_POSIX_MAXMSG messages, and its "mtype" is a priority
+///  instead of a filter.
+///  * With MSGQ_STATS, every read and write also updates counters in a shared
+///  memory, so MsgQueue::get_msg_qtty() is a memory read instead of a syscall.
+///  See MsgQueue::get_stats(). It's a POSIX memory named after the queue, with
+///  a "_stats" suffix (/dev/shm/ccotti_msgq_<key>_stats), so it doesn't take
+///  the key of a SharedMemory created with the same "path" and "id".
 /// @return If error, throws an exception with std::runtime_error
 template <class msg_t>
-MsgQueue<msg_t>::MsgQueue(const char* path, int id, bool create): creator(create) {
+MsgQueue<msg_t>::MsgQueue(const char* path, int id, bool create, int flags):
+    creator(create), backend(flags & MSGQ_POSIX), stats(NULL) {
     key_t key;
-    int flags = (create) ? (IPC_CREAT | 0666) : 0;
     this->pid = gettid();
+    if (flags & MSGQ_STATS) {
+        char stats_name[32];
+        if (get_name(path, id, stats_name) == -1) {
+            perror(ERROR("ftok in MsgQueue::MsgQueue"));
+            throw(std::runtime_error("ftok"));
+        }
+        strcat(stats_name, "_stats");
+        this->stats_shm.reset(new SharedMemory<char>(stats_name, 0, (create) ? sizeof(Stats) : 0,
+                                                     SHMEM_POSIX | SHMEM_NAMED));
+        this->stats = (Stats*) &((*this->stats_shm)[0]);
+        memset(&(this->last_stats), 0, sizeof(MsgQueueStats));
+        clock_gettime(CLOCK_MONOTONIC, &(this->last_stats_time));
+    }
+    if (this->backend == MSGQ_POSIX) {
+        struct mq_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.mq_maxmsg = MSGQ_POSIX_MAXMSG;
+        attr.mq_msgsize = sizeof(msg_t);
+        if (get_name(path, id, this->name) == -1) {
+            perror(ERROR("ftok in MsgQueue::MsgQueue"));
+            throw(std::runtime_error("ftok"));
+        }
+        this->mqd = (create) ? mq_open(this->name, O_RDWR | O_CREAT | O_EXCL, 0666, &attr) :
+            mq_open(this->name, O_RDWR);
+        if (this->mqd == (mqd_t) -1) {
+            perror(ERROR("mq_open in MsgQueue::MsgQueue"));
+            throw(std::runtime_error("mq_open"));
+        }
+        return;
+    }
     if ( (key = ftok(path, id) ) == -1) {
         perror(ERROR("ftok in MsgQueue::MsgQueue"));
         throw(std::runtime_error("ftok"));
@@ -74,6 +174,15 @@ MsgQueue<msg_t>::MsgQueue(const char* path, int id, bool create): creator(create
 ///  thread or proccess.
 template <class msg_t>
 MsgQueue<msg_t>::~MsgQueue(void) {
+    if (this->backend == MSGQ_POSIX) {
+        if (mq_close(this->mqd) == -1) {
+            perror(ERROR("mq_close in MsgQueue::~MsgQueue"));
+        }
+        if (this->creator && this->pid == gettid() && mq_unlink(this->name) == -1) {
+            perror(ERROR("mq_unlink in MsgQueue::~MsgQueue"));
+        }
+        return;
+    }
     if (this->creator && this->pid == gettid()) {
         if (msgctl(this->msg_id, IPC_RMID, NULL) == -1) {
             perror(ERROR("msgctl in MsgQueue::~MsgQueue"));
@@ -82,10 +191,20 @@ MsgQueue<msg_t>::~MsgQueue(void) {
 }
 
 /// @brief Checks if the message queue already exists.
+/// @param backend MSGQ_SYSV (default) or MSGQ_POSIX.
 /// @return "true" if it exists, "false" otherwise.
 template <class msg_t>
-bool MsgQueue<msg_t>::exists(const char* path, int id) {
+bool MsgQueue<msg_t>::exists(const char* path, int id, int backend) {
     key_t key;
+    char name[32];
+    mqd_t mqd;
+    if (backend == MSGQ_POSIX) {
+        if (get_name(path, id, name) == -1 || (mqd = mq_open(name, O_RDONLY)) == (mqd_t) -1) {
+            return false;
+        }
+        mq_close(mqd);
+        return true;
+    }
     if ( (key = ftok(path, id) ) == -1) {
         return false;
     }
@@ -100,15 +219,72 @@ bool MsgQueue<msg_t>::exists(const char* path, int id) {
 /// @param mtype Message identifier (default "1").
 /// @return "0" on success, "-1" on error.
 template <class msg_t>
-int MsgQueue<msg_t>::write(msg_t msg, long mtype) {
+int MsgQueue<msg_t>::write(const msg_t& msg, long mtype) {
     struct msgbuf sending_msg;
     if (mtype <= 0) {
         mtype = 1;
     }
     sending_msg.mtype = mtype;
     sending_msg.msg = msg;
-    if (msgsnd(this->msg_id, &sending_msg, (size_t) sizeof(msg_t), 0) == -1) {
-        perror(ERROR("msgsnd in MsgQueue::write"));
+    if (this->send(&sending_msg, (size_t) sizeof(msg_t), 0) == -1) {
+        perror(ERROR("send in MsgQueue::write"));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Writes several messages. Only the first one can block (unless
+///  "flags" has IPC_NOWAIT); the rest are written while there is room left in
+///  the queue.
+/// @param msgs Messages to be written, in order.
+/// @param n Amount of messages in "msgs".
+/// @param mtype Message identifier for all of them (default "1").
+/// @param flags "0" or IPC_NOWAIT.
+/// @return Amount of messages written, or "-1" if none could be written (with
+///  errno set to EAGAIN if the queue was full and IPC_NOWAIT was set).
+template <class msg_t>
+int MsgQueue<msg_t>::write_many(const msg_t* msgs, int n, long mtype, int flags) {
+    struct msgbuf sending_msg;
+    int written;
+    if (mtype <= 0) {
+        mtype = 1;
+    }
+    sending_msg.mtype = mtype;
+    for (written = 0; written < n; written++) {
+        sending_msg.msg = msgs[written];
+        if (this->send(&sending_msg, (size_t) sizeof(msg_t),
+            (written == 0) ? flags : flags | IPC_NOWAIT) == -1) {
+            break;
+        }
+    }
+    if (written == 0 && n > 0) {
+        if (errno != EAGAIN) {
+            perror(ERROR("send in MsgQueue::write_many"));
+        }
+        return -1;
+    }
+    return written;
+}
+
+/// @brief Writes a variable length message. Only "len" bytes go through the
+///  kernel, instead of sizeof(msg_t), so it's meant for payloads whose size
+///  changes a lot from one message to the next, like text. They must be read
+///  with the variable length MsgQueue::read().
+/// @param data Payload to be written.
+/// @param len Length of the payload. At most MSGMAX bytes (8192 by default,
+///  see /proc/sys/kernel/msgmax), or sizeof(msg_t) with MSGQ_POSIX.
+/// @param mtype Message identifier (default "1").
+/// @return "0" on success, "-1" on error.
+template <class msg_t>
+int MsgQueue<msg_t>::write(const void* data, size_t len, long mtype) {
+    char* sending_msg = get_buffer(len);
+    if (mtype <= 0) {
+        mtype = 1;
+    }
+    memcpy(sending_msg, &mtype, sizeof(long));
+    memcpy(sending_msg + sizeof(long), data, len);
+    if (this->send(sending_msg, len, 0) == -1) {
+        perror(ERROR("send in MsgQueue::write"));
         return -1;
     }
     return 0;
@@ -127,15 +303,17 @@ int MsgQueue<msg_t>::write(msg_t msg, long mtype) {
 ///  * IPC_NOWAIT; not blocking read.
 ///  * MSG_COPY | IPC_NOWAIT; Copies the message from the queue in position
 ///  "mtype". The message is not removed, and if no message is present in that
-///  position fails immediately.
+///  position fails immediately. Not supported with MSGQ_POSIX (ENOTSUP).
+///  With MSGQ_POSIX, "mtype" must be "0": messages come out by priority (the
+///  "mtype" used to write them), and in FIFO order for the same priority.
 /// @return The value returned from the message queue.
 template <class msg_t>
 msg_t MsgQueue<msg_t>::read(int mtype, int* status, int flags) {
     struct msgbuf output;
     int error_state = 0;
-    if( msgrcv(this->msg_id, &output, (size_t) sizeof(msg_t), (long) mtype, flags) == -1) {
+    if (this->receive(&output, (size_t) sizeof(msg_t), (long) mtype, flags) == -1) {
         error_state = errno;
-        perror(ERROR("msgrcv in MsgQueue::read"));
+        perror(ERROR("receive in MsgQueue::read"));
     }
     if (status != NULL) {
         *status = error_state;
@@ -143,6 +321,57 @@ msg_t MsgQueue<msg_t>::read(int mtype, int* status, int flags) {
     return output.msg;
 }
 
+/// @brief Reads several messages. Only the first read can block (unless
+///  "flags" has IPC_NOWAIT); then it takes whatever else is already in the
+///  queue, so a consumer wakes up once for a whole burst of messages.
+/// @param msgs Where the messages will be stored, in order.
+/// @param max_n Size of "msgs".
+/// @param mtype Which messages to read, same as in MsgQueue::read().
+/// @param flags "0" or IPC_NOWAIT.
+/// @return Amount of messages read, or "-1" if none could be read (with errno
+///  set to ENOMSG if the queue was empty and IPC_NOWAIT was set).
+template <class msg_t>
+int MsgQueue<msg_t>::read_many(msg_t* msgs, int max_n, long mtype, int flags) {
+    struct msgbuf output;
+    int count;
+    for (count = 0; count < max_n; count++) {
+        if (this->receive(&output, (size_t) sizeof(msg_t), mtype,
+            (count == 0) ? flags : flags | IPC_NOWAIT) == -1) {
+            break;
+        }
+        msgs[count] = output.msg;
+    }
+    if (count == 0 && max_n > 0) {
+        if (errno != ENOMSG) {
+            perror(ERROR("receive in MsgQueue::read_many"));
+        }
+        return -1;
+    }
+    return count;
+}
+
+/// @brief Reads a variable length message into a caller buffer.
+/// @param data Where the payload will be stored.
+/// @param max_len Size of "data". If the message is larger, it stays in the
+///  queue, and "-1" is returned with errno set to E2BIG. With MSGQ_POSIX, it
+///  must be at least sizeof(msg_t), or it fails with EMSGSIZE.
+/// @param mtype Which message to read, same as in MsgQueue::read().
+/// @param flags "0" or IPC_NOWAIT.
+/// @return Length of the payload read, or "-1" on error.
+template <class msg_t>
+ssize_t MsgQueue<msg_t>::read(void* data, size_t max_len, long mtype, int flags) {
+    char* output = get_buffer(max_len);
+    ssize_t len;
+    if ( (len = this->receive(output, max_len, mtype, flags)) == -1) {
+        if (errno != ENOMSG && errno != E2BIG) {
+            perror(ERROR("receive in MsgQueue::read"));
+        }
+        return -1;
+    }
+    memcpy(data, output + sizeof(long), len);
+    return len;
+}
+
 /// @brief Returns a copy of a message in the queue, without popping it.
 /// @param index Position in the queue, starting with "0".
 /// @param status If "0", the value was retrieved successfully. If != 0, then
@@ -154,10 +383,25 @@ msg_t MsgQueue<msg_t>::peek(int index, int* status) {
     return output.msg;
 }
 
-/// @brief Returns the amount of messages in the queue, or "-1" on error.
+/// @brief Returns the amount of messages in the queue, or "-1" on error. With
+///  MSGQ_STATS it doesn't need a syscall.
 template <class msg_t>
 int MsgQueue<msg_t>::get_msg_qtty(void) {
     struct msqid_ds info;
+    struct mq_attr attr;
+    int32_t depth;
+    if (this->stats != NULL) {
+        // A reader might count its message before the writer does.
+        depth = this->stats->depth.load(std::memory_order_relaxed);
+        return (depth < 0) ? 0 : depth;
+    }
+    if (this->backend == MSGQ_POSIX) {
+        if (mq_getattr(this->mqd, &attr) == -1) {
+            perror(ERROR("mq_getattr in MsgQueue::get_msg_qtty"));
+            return -1;
+        }
+        return (int) attr.mq_curmsgs;
+    }
     if (msgctl(this->msg_id, MSG_STAT, &info) == -1) {
         perror(ERROR("msgctl in MsgQueue::get_msg_qtty"));
         return -1;
@@ -178,13 +422,210 @@ bool MsgQueue<msg_t>::has_msg(void) {
     return (this->get_msg_qtty() > 0);
 }
 
+/// @brief Loads the statistics of a queue opened with MSGQ_STATS. They are only
+///  accurate if every process uses the queue with MSGQ_STATS.
+/// @param output Where the statistics will be stored. The rates are averaged
+///  since the previous call in this process (or since the queue was opened).
+/// @return "0" on success, "-1" if the queue has no statistics (ENOTSUP).
+template <class msg_t>
+int MsgQueue<msg_t>::get_stats(MsgQueueStats* output) {
+    struct timespec now;
+    double elapsed;
+    if (this->stats == NULL) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - this->last_stats_time.tv_sec) +
+        (now.tv_nsec - this->last_stats_time.tv_nsec) / 1e9;
+    output->depth = this->get_msg_qtty();
+    output->high_water = this->stats->high_water.load(std::memory_order_relaxed);
+    output->enqueued = this->stats->enqueued.load(std::memory_order_relaxed);
+    output->dequeued = this->stats->dequeued.load(std::memory_order_relaxed);
+    output->enqueue_rate = (elapsed > 0) ? (output->enqueued - this->last_stats.enqueued) / elapsed : 0;
+    output->dequeue_rate = (elapsed > 0) ? (output->dequeued - this->last_stats.dequeued) / elapsed : 0;
+    this->last_stats = *output;
+    this->last_stats_time = now;
+    return 0;
+}
+
+/// @brief Sets the high water mark of a MSGQ_STATS queue to its current depth.
+template <class msg_t>
+void MsgQueue<msg_t>::reset_high_water(void) {
+    if (this->stats != NULL) {
+        this->stats->high_water.store(this->get_msg_qtty(), std::memory_order_relaxed);
+    }
+}
+
+/// @brief Returns the descriptor of a MSGQ_POSIX queue, so that it can be
+///  added to poll/epoll (POLLIN when there are messages, POLLOUT when there is
+///  room for more). It's owned by the queue, so don't close it.
+/// @return The descriptor, or "-1" for MSGQ_SYSV queues (errno ENOTSUP).
+template <class msg_t>
+int MsgQueue<msg_t>::get_fd(void) {
+    if (this->backend != MSGQ_POSIX) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    return (int) this->mqd;
+}
+
+/// @brief Asks for signal "signo" to be sent to this process when a message
+///  arrives to the empty MSGQ_POSIX queue. It's sent once: call it again to
+///  keep getting notified. Only one process can be registered per queue, and
+///  it isn't notified if another process is blocked reading the queue.
+/// @param signo Signal to be sent, with "si_value" pointing to this object. If
+///  "0", removes the registration.
+/// @return "0" on success, "-1" on error (ENOTSUP for MSGQ_SYSV queues, EBUSY
+///  if another process is registered).
+template <class msg_t>
+int MsgQueue<msg_t>::notify(int signo) {
+    struct sigevent event;
+    if (this->backend != MSGQ_POSIX) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = signo;
+    event.sigev_value.sival_ptr = this;
+    if (mq_notify(this->mqd, (signo == 0) ? NULL : &event) == -1) {
+        perror(ERROR("mq_notify in MsgQueue::notify"));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Same as MsgQueue::notify(int), but "function" is called in a new
+///  thread instead of sending a signal.
+/// @param function Function to be called, with "arg" as "sival_ptr".
+/// @param arg Any pointer, passed to "function".
+template <class msg_t>
+int MsgQueue<msg_t>::notify(void (*function)(union sigval), void* arg) {
+    struct sigevent event;
+    if (this->backend != MSGQ_POSIX) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD;
+    event.sigev_notify_function = function;
+    event.sigev_value.sival_ptr = arg;
+    if (mq_notify(this->mqd, &event) == -1) {
+        perror(ERROR("mq_notify in MsgQueue::notify"));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Sends a message laid out as "struct msgbuf": an "mtype" followed by
+///  "len" bytes of payload. With MSGQ_POSIX, "mtype" is the priority.
+/// @param flags "0" or IPC_NOWAIT.
+/// @return "0" on success, "-1" on error (EAGAIN if full and IPC_NOWAIT).
+template <class msg_t>
+int MsgQueue<msg_t>::send(const void* msgp, size_t len, int flags) {
+    static const struct timespec expired = {0, 0};
+    int32_t depth, high_water;
+    long mtype;
+    int result;
+    if (this->backend != MSGQ_POSIX) {
+        result = msgsnd(this->msg_id, msgp, len, flags);
+    } else {
+        memcpy(&mtype, msgp, sizeof(long));
+        if (mtype >= MQ_PRIO_MAX) {
+            mtype = MQ_PRIO_MAX - 1;
+        }
+        if (flags & IPC_NOWAIT) {
+            // An absolute timeout in the past doesn't block.
+            result = mq_timedsend(this->mqd, (const char*) msgp + sizeof(long), len, mtype, &expired);
+            if (result == -1 && errno == ETIMEDOUT) {
+                errno = EAGAIN;
+            }
+        } else {
+            result = mq_send(this->mqd, (const char*) msgp + sizeof(long), len, mtype);
+        }
+    }
+    if (result == 0 && this->stats != NULL) {
+        this->stats->enqueued.fetch_add(1, std::memory_order_relaxed);
+        depth = this->stats->depth.fetch_add(1, std::memory_order_relaxed) + 1;
+        high_water = this->stats->high_water.load(std::memory_order_relaxed);
+        while (depth > high_water &&
+            !this->stats->high_water.compare_exchange_weak(high_water, depth, std::memory_order_relaxed));
+    }
+    return result;
+}
+
+/// @brief Receives a message laid out as "struct msgbuf". With MSGQ_POSIX, the
+///  "mtype" is loaded with the priority of the message.
+/// @param flags "0" or IPC_NOWAIT, or MSG_COPY with MSGQ_SYSV.
+/// @return Length of the payload, or "-1" on error (ENOMSG if empty and
+///  IPC_NOWAIT).
+template <class msg_t>
+ssize_t MsgQueue<msg_t>::receive(void* msgp, size_t max_len, long mtype, int flags) {
+    static const struct timespec expired = {0, 0};
+    unsigned int priority;
+    long received_type;
+    ssize_t len;
+    if (this->backend != MSGQ_POSIX) {
+        len = msgrcv(this->msg_id, msgp, max_len, mtype, flags);
+    } else if (mtype != 0 || (flags & MSG_COPY)) {
+        errno = ENOTSUP;
+        return -1;
+    } else {
+        if (flags & IPC_NOWAIT) {
+            len = mq_timedreceive(this->mqd, (char*) msgp + sizeof(long), max_len, &priority, &expired);
+            if (len == -1 && errno == ETIMEDOUT) {
+                errno = ENOMSG;
+            }
+        } else {
+            len = mq_receive(this->mqd, (char*) msgp + sizeof(long), max_len, &priority);
+        }
+        if (len != -1) {
+            received_type = priority;
+            memcpy(msgp, &received_type, sizeof(long));
+        }
+    }
+    if (len != -1 && this->stats != NULL && !(flags & MSG_COPY)) {
+        this->stats->dequeued.fetch_add(1, std::memory_order_relaxed);
+        this->stats->depth.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return len;
+}
+
+/// @brief Builds the name of a POSIX queue from the same key as a System V
+///  one, so that both backends are identified by "path" and "id".
+/// @param name Where the name will be stored. At least 32 bytes.
+/// @return "0" on success, "-1" on error.
+template <class msg_t>
+int MsgQueue<msg_t>::get_name(const char* path, int id, char* name) {
+    key_t key;
+    if ( (key = ftok(path, id)) == -1) {
+        return -1;
+    }
+    snprintf(name, 32, "/ccotti_msgq_%x", (unsigned int) key);
+    return 0;
+}
+
+/// @brief Returns a buffer with room for the "mtype" and "len" bytes of
+///  payload, for variable length messages. There's one per thread, reused by
+///  every call, so reads and writes don't allocate once it grew, and threads
+///  sharing a MsgQueue don't overwrite each other's message.
+template <class msg_t>
+char* MsgQueue<msg_t>::get_buffer(size_t len) {
+    static thread_local std::vector<char> buffer;
+    if (buffer.size() < sizeof(long) + len) {
+        buffer.resize(sizeof(long) + len);
+    }
+    return buffer.data();
+}
+
 /******************************************************************************
  * Overloaded operators
 ******************************************************************************/
 
 /// @brief Sends a message with "mtype=1". Might throw "std::runtime_error".
 template <class msg_t>
-MsgQueue<msg_t>& MsgQueue<msg_t>::operator<<(msg_t msg) {
+MsgQueue<msg_t>& MsgQueue<msg_t>::operator<<(const msg_t& msg) {
     if (this->write(msg, 1) == -1) {
         throw(std::runtime_error("MsgQueue::operator<<"));
     }
@@ -3,7 +3,10 @@
 
 #include <pthread.h>
 #include <stdio.h>
+#include <errno.h>
+#include <time.h>
 #include "tools.h"
+#include <stdexcept>
 
 class Mutex {
 private:
@@ -16,4 +19,44 @@ public:
     ~Mutex();
 };
 
-#endif // MUTEX_H
\ No newline at end of file
+/// @brief Mutex shared by processes. Build it inside a shared memory (with
+///  placement new, once, by the creator) and every process that maps it can
+///  use it. Taking and releasing it uncontended are atomic operations, without
+///  syscalls. It's robust: if the owner dies holding it, the next one to lock
+///  it gets it, and is told so.
+class SharedMutex {
+private:
+    pthread_mutex_t mutex;
+
+    int recover(int error, const char* method);
+    friend class SharedCond;
+
+public:
+    SharedMutex();
+    ~SharedMutex();
+    SharedMutex(const SharedMutex&) = delete;
+    SharedMutex& operator=(const SharedMutex&) = delete;
+
+    int lock(void);
+    int trylock(void);
+    int unlock(void);
+};
+
+/// @brief Condition variable shared by processes, used with a SharedMutex.
+///  Build it inside a shared memory, like the SharedMutex.
+class SharedCond {
+private:
+    pthread_cond_t cond;
+
+public:
+    SharedCond();
+    ~SharedCond();
+    SharedCond(const SharedCond&) = delete;
+    SharedCond& operator=(const SharedCond&) = delete;
+
+    int wait(SharedMutex& mutex, int timeout_ms=-1);
+    int signal(void);
+    int broadcast(void);
+};
+
+#endif // MUTEX_H
@@ -3,11 +3,35 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include "socket.h"
 #include "sig.h"
+#include "thread.h"
+#include "uring.h"
 #include "tools.h"
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Maximum amount of events attended on each iteration of the reactor loop.
+#define SERVER_MAX_EVENTS 256
+// Size of the buffers used to receive data before calling on_data().
+#define SERVER_BUFFER_SIZE 4096
+// Amount of receive buffers provided to the kernel in io_uring mode.
+#define SERVER_URING_BUFFERS 1024
+// Longest wait, in milliseconds, before retrying to fork a pre-fork worker.
+// It starts at 10 ms and doubles after every failed attempt.
+#define SERVER_RESPAWN_MAX_MS 1000
 
 /// @brief Abstract class. The user should inherit from this class and can:
 ///  * Modify the constructor, as long as the parent constructor is called in the
@@ -16,12 +40,75 @@
 ///  * Override the on_start() function to make something right before accepting connections.
 ///  * Override the on_new_client() function to make something right after accepting a new connection.
 ///  * Override the on_quit() function to make some cleanups after the server exits.
+///  * Override on_readable() and on_writable() to handle clients with
+///  start_reactor(), instead of on_accept().
+///  * Override on_busy() to answer clients rejected by start_pool().
+///  * Override on_data() to handle clients with start_uring(), or with
+///  start_reactor() if on_readable() is not overridden.
 ///  The server stops execution after receiving a SIGINT.
 class Server {
+public:
+    // What start_pool() does with a new client when the queue is full.
+    enum PoolPolicy {
+        POOL_BLOCK, // Stop accepting clients until there is room in the queue.
+        POOL_DROP,  // Close the new connection.
+        POOL_BUSY   // Call on_busy() with the new connection, and close it.
+    };
+
 private:
+    struct PoolEntry {
+        int sockfd;
+        struct sockaddr_storage addr;
+    };
+
+    struct Shard {
+        Server* server;
+        Socket* socket;
+        int wakeup_fd;
+    };
+
+    // The socket must be the first member, see Server::send_async().
+    struct UringConn {
+        Socket socket;
+        int pending;
+    };
+
+    struct UringSend {
+        UringConn* conn;
+        char* data;
+        int len;
+        int sent;
+    };
+
     Socket socket;
+    int family, socktype;
     int backlog;
-    static bool exit;
+    int epfd;
+    std::set<Socket*> clients;
+    std::set<Socket*> writable;                 // With on_writable() enabled.
+    std::map<Socket*, std::string> send_queue;  // Unsent data of send_async().
+    std::vector<Socket*> closed_clients;
+    PoolEntry* pool_queue;
+    int pool_depth, pool_head, pool_count;
+    bool pool_exit;
+    pthread_mutex_t pool_mutex;
+    pthread_cond_t pool_not_empty, pool_not_full;
+    Uring* uring;
+    bool uring_multishot;
+    int uring_conns;
+    // Set by the SIGINT handler, and read by the threads of every mode.
+    static std::atomic<bool> exit;
+
+    void accept_clients(void);
+    int update_events(Socket& socket);
+    int flush_client(Socket& socket);
+    int accept_client(int sockfd, struct sockaddr_storage* addr, int wakeup_fd=-1);
+    int pool_push(int sockfd, struct sockaddr_storage* addr, int policy);
+    static void* pool_run(void* server);
+    static void* shard_run(void* shard);
+    pid_t prefork_spawn(void);
+    void uring_complete(struct io_uring_cqe* cqe);
+    void uring_recv(UringConn* conn);
 
 protected:
     // Define this function to handle clients' connections.
@@ -33,12 +120,33 @@ protected:
     virtual void on_new_client(void) {};
     // Override this function to make some cleanups after the server exits.
     virtual void on_quit(void) {};
+    // Reactor mode. Called when the client has data to be read. Return "-1"
+    // to close the connection. By default, reads the data and calls on_data().
+    virtual int on_readable(Socket& socket);
+    // Reactor mode. Called when the client can be written, only if enabled
+    // with set_writable(). Return "-1" to close the connection.
+    virtual int on_writable(Socket& socket) { return 0; };
+    // Pool mode. Called when a client is rejected with the POOL_BUSY policy,
+    // right before closing the connection.
+    virtual void on_busy(Socket& socket) {};
+    // io_uring and reactor modes. Called with the data received from a client,
+    // which must not be kept after returning. Return "-1" to close the connection.
+    virtual int on_data(Socket& socket, const char* data, int len) { return -1; };
 
+    int set_writable(Socket& socket, bool enable=true);
+    void close_client(Socket& socket);
+    int send_async(Socket& socket, const void* data, int len);
     static void leave(int);
+    static void child_exited(int);
 
 public:
     Server(const char* ip, const char* port, int family=AF_UNSPEC, int socktype=SOCK_STREAM);
     void start(int backlog=20);
+    void start_reactor(int backlog=128);
+    void start_pool(int workers=4, int queue_depth=64, int policy=POOL_BLOCK, int backlog=128);
+    void start_sharded(int shards=0, bool pin=false, int backlog=128);
+    void start_prefork(int workers=4, int backlog=128);
+    void start_uring(int backlog=128);
     Socket& get_socket(void);
 };
 
@@ -4,10 +4,136 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include "tools.h"
 #include <stdexcept>
 #include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <type_traits>
+#include <atomic>
+#include <sched.h>
+#include <time.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Size of a cache line. Data written by different processes is kept in
+// different lines, so that they don't invalidate each other (false sharing).
+#define SHM_CACHE_LINE  64
+
+// Copies of at least this many bytes use non-temporal (streaming) stores,
+// which don't pull the destination into the cache. "0" (default) leaves every
+// copy to memcpy(), since glibc already streams copies larger than the cache.
+#ifndef SHM_STREAM_THRESHOLD
+#define SHM_STREAM_THRESHOLD    0
+#endif
+
+// Options of a SharedMemory, chosen when it's created or connected to. One
+// backend, "or"ed with any of the page options. All processes must use the same
+// backend, but each one chooses its own page options.
+#define SHMEM_SYSV      0   // System V segment (shmget), named by ftok.
+#define SHMEM_POSIX     1   // POSIX shm_open + mmap, named after the same key.
+#define SHMEM_MEMFD     2   // Anonymous memfd_create + mmap, shared by fork.
+#define SHMEM_BACKEND   3   // Mask of the backend bits.
+#define SHMEM_HUGETLB   4   // Explicit huge pages, from the hugetlbfs pool.
+#define SHMEM_THP       8   // Transparent huge pages (madvise MADV_HUGEPAGE).
+#define SHMEM_POPULATE  16  // Prefault every page when mapping it.
+#define SHMEM_LOCK      32  // Lock the pages in RAM (mlock).
+#define SHMEM_SEQLOCK   64  // Consistent array reads and writes (see SharedMemory).
+#define SHMEM_NAMED     128 // SHMEM_POSIX named "path" itself (see SharedMemory).
+
+// Maximum time to wait for the creator of a structure inside a shared memory
+// (ShmRingQueue, ShmArena...) to initialize it, when connecting to it.
+#ifndef SHM_READY_TIMEOUT_MS
+#define SHM_READY_TIMEOUT_MS    1000
+#endif
+
+// Size of the huge pages used with SHMEM_HUGETLB (default size on x86-64).
+#ifndef SHMEM_HUGE_PAGE
+#define SHMEM_HUGE_PAGE     (2 * 1024 * 1024)
+#endif
+
+/******************************************************************************
+ * Auxiliary functions
+******************************************************************************/
+
+/// @brief Copies "len" bytes with non-temporal stores, if the CPU has them
+///  (SSE2), or with memcpy() otherwise.
+inline void shm_stream_copy(void* dst, const void* src, size_t len) {
+#ifdef __SSE2__
+    char* d = (char*) dst;
+    const char* s = (const char*) src;
+    // Streaming stores need a 16 byte aligned destination.
+    size_t head = (16 - ((uintptr_t) d & 15)) & 15;
+    head = head < len ? head : len;
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    len -= head;
+    for (; len >= 64; len -= 64, d += 64, s += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i*) s);
+        __m128i b = _mm_loadu_si128((const __m128i*) (s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*) (s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i*) (s + 48));
+        _mm_stream_si128((__m128i*) d, a);
+        _mm_stream_si128((__m128i*) (d + 16), b);
+        _mm_stream_si128((__m128i*) (d + 32), c);
+        _mm_stream_si128((__m128i*) (d + 48), e);
+    }
+    memcpy(d, s, len);
+    // Streaming stores are weakly ordered: make them visible before anything
+    // written after the copy.
+    _mm_sfence();
+#else
+    memcpy(dst, src, len);
+#endif
+}
+
+/// @brief Copies "len" bytes, with shm_stream_copy() if the block is at least
+///  SHM_STREAM_THRESHOLD bytes, or with memcpy() otherwise.
+inline void shm_copy(void* dst, const void* src, size_t len) {
+    if (SHM_STREAM_THRESHOLD > 0 && len >= (size_t) SHM_STREAM_THRESHOLD) {
+        shm_stream_copy(dst, src, len);
+    } else {
+        memcpy(dst, src, len);
+    }
+}
+
+/// @brief Waits for the creator of a structure inside a shared memory to
+///  initialize it. The creator stores the tag of its type in "tag" (with
+///  release order) once everything else is written, so a process that
+///  connects can tell a structure that isn't ready yet ("0"), from a memory
+///  that holds something else.
+/// @param tag Tag of the structure, inside the shared memory.
+/// @param expected Tag of the type being connected to.
+/// @return "0" once the tag is the expected one, "-1" if it's another one
+///  (errno EINVAL), or if it stays "0" for SHM_READY_TIMEOUT_MS because the
+///  creator died or is stuck (errno ETIMEDOUT).
+inline int shm_wait_ready(const std::atomic<uint32_t>& tag, uint32_t expected) {
+    struct timespec start, now, pause = {0, 100000};
+    uint32_t value;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while ( (value = tag.load(std::memory_order_acquire)) == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 >= SHM_READY_TIMEOUT_MS) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        nanosleep(&pause, NULL);
+    }
+    if (value != expected) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
 
 /******************************************************************************
  * Class definition
@@ -17,19 +143,39 @@ template <class data_t>
 class SharedMemory {
 private:
     int shmid;
-    data_t* shmaddr;
+    char* base;         // Start of the mapping.
+    data_t* shmaddr;    // First element, after the version with SHMEM_SEQLOCK.
+    size_t size;
+    size_t length;      // Bytes mapped.
+    std::atomic<uint32_t>* version;     // NULL without SHMEM_SEQLOCK.
     pid_t pid;
     bool creator;
+    int backend;
+    char name[32];
+
+    int map(int fd, int flags, size_t prefix);
+    void open_posix(int flags, size_t prefix);
+    void attach(int flags, int numa_node, size_t prefix);
+    int setup(int flags, int numa_node);
+    void release(void);
+    void lock_version(void);
+    void unlock_version(void);
+    static int get_name(const char* path, int id, char* name);
+
+    static void copy(data_t* dst, const data_t* src, int size, std::true_type trivial);
+    static void copy(data_t* dst, const data_t* src, int size, std::false_type trivial);
 
 public:
-    SharedMemory(const char* path, int id, size_t size=0);
+    SharedMemory(const char* path, int id, size_t size=0, int flags=SHMEM_SYSV, int numa_node=-1);
     ~SharedMemory();
 
-    void write( data_t* elements, int size, int index=0);
+    int write(const data_t* elements, int size, int index=0);
     void write(data_t element, int index);
-    void read(data_t* array, int size, int index=0);
+    int read(data_t* array, int size, int index=0);
     data_t read(int index);
-    static bool exists(const char* path, int id);
+    size_t get_size(void) const;
+    uint32_t get_version(void) const;
+    static bool exists(const char* path, int id, int backend=SHMEM_SYSV);
 
     void operator= (data_t element);
     SharedMemory<data_t>& operator<< (data_t element);
@@ -49,56 +195,275 @@ public:
 /// @param size If size > 0, then the shared memory is created with the size to
 ///  allocate "size" elements of type "data_t".
 ///  already existing one (default = 0).
+/// @param flags The backend, SHMEM_SYSV (default), SHMEM_POSIX or SHMEM_MEMFD,
+///  optionally "or"ed with page options:
+///  * SHMEM_HUGETLB: back it with huge pages reserved in the hugetlbfs pool
+///  (/proc/sys/vm/nr_hugepages). Not supported with SHMEM_POSIX (EINVAL).
+///  * SHMEM_THP: ask for transparent huge pages. The kernel only honours it if
+///  /sys/kernel/mm/transparent_hugepage/shmem_enabled allows it.
+///  * SHMEM_POPULATE: fault in every page now, instead of on first touch.
+///  * SHMEM_LOCK: lock the pages in RAM. Limited by RLIMIT_MEMLOCK.
+///  * SHMEM_SEQLOCK: keep a version number in front of the elements, so that
+///  the write() and read() methods are consistent without locks. Writers make
+///  it odd while they write (waiting for each other), and readers retry their
+///  copy if it changed meanwhile, so they never see a half written array, and
+///  never make a syscall or block writers. Meant for read mostly data. Access
+///  through operator[] isn't protected. "data_t" must be trivially copyable,
+///  and all processes must use this flag, or none.
+///  * SHMEM_NAMED: with SHMEM_POSIX, "path" is the name of the memory (a "/"
+///  and up to 30 more characters, no other "/"), and "id" is ignored. Meant
+///  for memories that belong to another object with the same "path" and "id"
+///  (like the MSGQ_STATS counters of a MsgQueue), so that they don't take the
+///  name of a SharedMemory the user creates with them.
+///  A SHMEM_MEMFD memory has no name: it can only be created, and is shared with
+///  the children forked afterwards. "path" and "id" only label it in
+///  /proc/<pid>/maps.
+/// @param numa_node If ">= 0", the pages are allocated on that NUMA node
+///  (mbind MPOL_BIND). It only applies to pages this process faults in first.
 /// @return On error, std::runtime_error() is thrown.
 template <class data_t>
-SharedMemory<data_t>::SharedMemory(const char* path, int id, size_t size) {
+SharedMemory<data_t>::SharedMemory(const char* path, int id, size_t size, int flags, int numa_node):
+    shmid(-1), base(NULL), shmaddr(NULL), size(size), version(NULL), creator(size > 0),
+    backend(flags & SHMEM_BACKEND) {
+    size_t prefix = (flags & SHMEM_SEQLOCK) ? SHM_CACHE_LINE : 0;
     key_t key;
+    int fd;
     this->pid = gettid();
-    if ( (key = ftok(path, id) ) == -1) {
-        perror( ERROR("ftok in SharedMemory::SharedMemory"));
-        throw(std::runtime_error("ftok"));
+    this->length = prefix + size * sizeof(data_t);
+    if ((flags & SHMEM_SEQLOCK) && !std::is_trivially_copyable<data_t>::value) {
+        errno = EINVAL;
+        perror(ERROR("SHMEM_SEQLOCK needs trivially copyable data in SharedMemory::SharedMemory"));
+        throw(std::runtime_error("seqlock"));
     }
-    if (size) {  // Create new
-        this->creator = true;
-        if( (this->shmid = shmget(key, (size_t)size*sizeof(data_t), IPC_CREAT | IPC_EXCL | 0666) ) == -1) {
-            perror(ERROR("shmget in SharedMemory::SharedMemory"));
-            throw(std::runtime_error("shmget"));
+    if (flags & SHMEM_NAMED) {
+        if (this->backend != SHMEM_POSIX || strlen(path) >= sizeof(this->name)) {
+            errno = EINVAL;
+            perror(ERROR("SHMEM_NAMED in SharedMemory::SharedMemory"));
+            throw(std::runtime_error("name"));
         }
-    } else { // Connect to existing one
-        this->creator = false;
-        if( (this->shmid = shmget(key, 0, 0) ) == -1) {
-            perror(ERROR("shmget in SharedMemory::SharedMemory"));
-            throw(std::runtime_error("shmget"));
+        strcpy(this->name, path);
+        this->open_posix(flags, prefix);
+    } else if (this->backend == SHMEM_POSIX || this->backend == SHMEM_MEMFD) {
+        if (get_name(path, id, this->name) == -1) {
+            perror(ERROR("ftok in SharedMemory::SharedMemory"));
+            throw(std::runtime_error("ftok"));
+        }
+        if (this->backend == SHMEM_POSIX) {
+            this->open_posix(flags, prefix);
+        } else if (!size) {
+            errno = EINVAL;
+            perror(ERROR("connecting to a SHMEM_MEMFD in SharedMemory::SharedMemory"));
+            throw(std::runtime_error("memfd_create"));
+        } else {
+            fd = memfd_create(this->name + 1, MFD_CLOEXEC | ((flags & SHMEM_HUGETLB) ? MFD_HUGETLB : 0));
+            if (fd == -1) {
+                perror(ERROR("memfd_create in SharedMemory::SharedMemory"));
+                throw(std::runtime_error("memfd_create"));
+            }
+            if (this->map(fd, flags, prefix) == -1) {
+                throw(std::runtime_error("mmap"));
+            }
+        }
+    } else {
+        if ( (key = ftok(path, id) ) == -1) {
+            perror( ERROR("ftok in SharedMemory::SharedMemory"));
+            throw(std::runtime_error("ftok"));
+        }
+        if (size) {  // Create new
+            int shmflg = IPC_CREAT | IPC_EXCL | 0666 | ((flags & SHMEM_HUGETLB) ? SHM_HUGETLB : 0);
+            if( (this->shmid = shmget(key, this->length, shmflg) ) == -1) {
+                perror(ERROR("shmget in SharedMemory::SharedMemory"));
+                throw(std::runtime_error("shmget"));
+            }
+        } else { // Connect to existing one
+            if( (this->shmid = shmget(key, 0, 0) ) == -1) {
+                perror(ERROR("shmget in SharedMemory::SharedMemory"));
+                throw(std::runtime_error("shmget"));
+            }
+        }
+        if ( (this->base = (char*) shmat(this->shmid, NULL, 0)) == (char*) -1) {
+            perror(ERROR("shmat in SharedMemory::SharedMemory"));
+            this->base = NULL;
+            this->release();
+            throw(std::runtime_error("shmat"));
+        }
+        if (!size) {
+            struct shmid_ds info;
+            if (shmctl(this->shmid, IPC_STAT, &info) == -1) {
+                perror(ERROR("shmctl in SharedMemory::SharedMemory"));
+                this->release();
+                throw(std::runtime_error("shmctl"));
+            }
+            this->length = info.shm_segsz;
+            this->size = (info.shm_segsz - prefix) / sizeof(data_t);
+        }
+        if ((flags & SHMEM_HUGETLB) && this->length % SHMEM_HUGE_PAGE) {
+            this->length += SHMEM_HUGE_PAGE - this->length % SHMEM_HUGE_PAGE;
         }
     }
-    if ( (this->shmaddr = (data_t*) shmat(this->shmid, NULL, 0)) == (data_t*) -1) {
-        perror(ERROR("shmat in SharedMemory::SharedMemory"));
-        throw(std::runtime_error("shmat"));
-    }
+    this->attach(flags, numa_node, prefix);
 }
 
 /// @brief Detaches pointer from shm. If you are the creator, destroy the shm.
 template <class data_t>
 SharedMemory<data_t>::~SharedMemory() {
-    if (shmdt((void *) this->shmaddr) == -1) {
-        perror(ERROR("shmdt in SharedMemory::~SharedMemory"));
+    this->release();
+}
+
+/// @brief Opens (or creates, with "size" > 0) and maps the SHMEM_POSIX memory
+///  called "name".
+/// @return On error, std::runtime_error() is thrown.
+template <class data_t>
+void SharedMemory<data_t>::open_posix(int flags, size_t prefix) {
+    int fd;
+    if (flags & SHMEM_HUGETLB) {
+        errno = EINVAL;
+        perror(ERROR("SHMEM_HUGETLB with SHMEM_POSIX in SharedMemory::SharedMemory"));
+        throw(std::runtime_error("shm_open"));
+    }
+    if ( (fd = shm_open(this->name, (this->size) ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0666)) == -1) {
+        perror(ERROR("shm_open in SharedMemory::SharedMemory"));
+        throw(std::runtime_error("shm_open"));
+    }
+    if (this->map(fd, flags, prefix) == -1) {
+        throw(std::runtime_error("mmap"));
+    }
+}
+
+/// @brief Finds the elements in the new mapping, and applies the page options.
+/// @return On error, the memory is released and std::runtime_error() is thrown.
+template <class data_t>
+void SharedMemory<data_t>::attach(int flags, int numa_node, size_t prefix) {
+    this->shmaddr = (data_t*) (this->base + prefix);
+    if (prefix) {
+        this->version = (std::atomic<uint32_t>*) this->base;
+    }
+    if (this->setup(flags, numa_node) == -1) {
+        this->release();
+        throw(std::runtime_error("setup"));
+    }
+}
+
+/// @brief Sizes (if creating) and maps the file of a SHMEM_POSIX or SHMEM_MEMFD
+///  memory, and closes it.
+/// @param prefix Bytes in front of the elements.
+/// @return "0" on success, "-1" on error. The memory is released on error.
+template <class data_t>
+int SharedMemory<data_t>::map(int fd, int flags, size_t prefix) {
+    struct stat info;
+    if (this->creator) {
+        if ((flags & SHMEM_HUGETLB) && this->length % SHMEM_HUGE_PAGE) {
+            this->length += SHMEM_HUGE_PAGE - this->length % SHMEM_HUGE_PAGE;
+        }
+        if (ftruncate(fd, this->length) == -1) {
+            perror(ERROR("ftruncate in SharedMemory::map"));
+            close(fd);
+            this->release();
+            return -1;
+        }
+    } else {
+        if (fstat(fd, &info) == -1) {
+            perror(ERROR("fstat in SharedMemory::map"));
+            close(fd);
+            return -1;
+        }
+        this->length = info.st_size;
+        this->size = (info.st_size - prefix) / sizeof(data_t);
+    }
+    this->base = (char*) mmap(NULL, this->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (this->base == (char*) MAP_FAILED) {
+        perror(ERROR("mmap in SharedMemory::map"));
+        this->base = NULL;
+        this->release();
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Applies the page options to the mapping of this process, in the
+///  order they need: NUMA binding before any page is faulted in, and locking
+///  last.
+/// @return "0" on success, "-1" on error.
+template <class data_t>
+int SharedMemory<data_t>::setup(int flags, int numa_node) {
+    if (numa_node >= 0) {
+        unsigned long mask = 1UL << numa_node;
+        if (numa_node >= (int) sizeof(mask) * 8) {
+            errno = EINVAL;
+            perror(ERROR("numa_node in SharedMemory::setup"));
+            return -1;
+        }
+        if (syscall(SYS_mbind, this->base, this->length, MPOL_BIND, &mask,
+                    sizeof(mask) * 8 + 1, 0) == -1) {
+            perror(ERROR("mbind in SharedMemory::setup"));
+            return -1;
+        }
+    }
+    if ((flags & SHMEM_THP) && madvise(this->base, this->length, MADV_HUGEPAGE) == -1) {
+        perror(ERROR("madvise in SharedMemory::setup"));
+        return -1;
+    }
+    // Not MAP_POPULATE: on shared mappings it only maps the pages read only, so
+    // the first write to each one still faults.
+    if ((flags & SHMEM_POPULATE) && madvise(this->base, this->length, MADV_POPULATE_WRITE) == -1) {
+        perror(ERROR("madvise in SharedMemory::setup"));
+        return -1;
     }
-    if (this->creator && this->pid == gettid()) {
-        if (shmctl(this->shmid, IPC_RMID, NULL) == -1) {
+    if ((flags & SHMEM_LOCK) && mlock(this->base, this->length) == -1) {
+        perror(ERROR("mlock in SharedMemory::setup"));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Unmaps the memory. If you are the creator, and in the same thread or
+///  process, destroy it.
+template <class data_t>
+void SharedMemory<data_t>::release(void) {
+    bool owner = this->creator && this->pid == gettid();
+    if (this->backend == SHMEM_SYSV) {
+        if (this->base && shmdt((void *) this->base) == -1) {
+            perror(ERROR("shmdt in SharedMemory::~SharedMemory"));
+        }
+        if (owner && this->shmid != -1 && shmctl(this->shmid, IPC_RMID, NULL) == -1) {
             perror(ERROR("shmctl in SharedMemory::~SharedMemory"));
         }
+        return;
+    }
+    if (this->base && munmap((void*) this->base, this->length) == -1) {
+        perror(ERROR("munmap in SharedMemory::~SharedMemory"));
+    }
+    if (owner && this->backend == SHMEM_POSIX && shm_unlink(this->name) == -1) {
+        perror(ERROR("shm_unlink in SharedMemory::~SharedMemory"));
     }
 }
 
-/// @brief Writes multiple elements to the shared memory
+/// @brief Writes multiple elements to the shared memory. If "data_t" is
+///  trivially copyable, they are copied as a single block (see shm_copy()).
+///  With SHMEM_SEQLOCK, it waits for other writers, and readers never see the
+///  elements half written.
 /// @param elements Vector with the elements to be written.
 /// @param size Size of the vector.
 /// @param index Position from where to start writing in the shared memory.
+/// @return "0" on success, "-1" if the elements don't fit in the shared
+///  memory (errno ERANGE). Nothing is written in that case.
 template <class data_t>
-void SharedMemory<data_t>::write(data_t* elements, int size, int index) {
-    for (int i = 0; i < size; i++) {
-        this->shmaddr[index + i] = elements[i];
+int SharedMemory<data_t>::write(const data_t* elements, int size, int index) {
+    if (index < 0 || size < 0 || (size_t) index + size > this->size) {
+        errno = ERANGE;
+        perror(ERROR("out of bounds in SharedMemory::write"));
+        errno = ERANGE;     // perror() may have changed it.
+        return -1;
+    }
+    if (this->version == NULL) {
+        copy(this->shmaddr + index, elements, size, std::is_trivially_copyable<data_t>());
+        return 0;
     }
+    this->lock_version();
+    copy(this->shmaddr + index, elements, size, std::is_trivially_copyable<data_t>());
+    this->unlock_version();
+    return 0;
 }
 
 /// @brief Writes a single element to the shared memory.
@@ -106,17 +471,45 @@ void SharedMemory<data_t>::write(data_t* elements, int size, int index) {
 /// @param index Position in the shared memory.
 template <class data_t>
 void SharedMemory<data_t>::write(data_t element, int index) {
+    if (this->version != NULL) {
+        this->write(&element, 1, index);
+        return;
+    }
     this->shmaddr[index] = element;
 }
 
-/// @brief Returns a copy of the elements in the shared memory.
+/// @brief Returns a copy of the elements in the shared memory. If "data_t" is
+///  trivially copyable, they are copied as a single block (see shm_copy()).
+///  With SHMEM_SEQLOCK, the copy is retried until no writer changed the
+///  memory while it was made, so it's a consistent snapshot.
 /// @param array Place where the elements will be copied.
 /// @param size Size of the array.
 /// @param index Place from where to start reading the shared memory.
+/// @return "0" on success, "-1" if the elements are out of the shared memory
+///  (errno ERANGE). Nothing is read in that case.
 template <class data_t>
-void SharedMemory<data_t>::read(data_t* array, int size, int index) {
-    for (int i = 0; i < size; i++) {
-        array[i] = this->shmaddr[index + i];
+int SharedMemory<data_t>::read(data_t* array, int size, int index) {
+    if (index < 0 || size < 0 || (size_t) index + size > this->size) {
+        errno = ERANGE;
+        perror(ERROR("out of bounds in SharedMemory::read"));
+        errno = ERANGE;     // perror() may have changed it.
+        return -1;
+    }
+    if (this->version == NULL) {
+        copy(array, this->shmaddr + index, size, std::is_trivially_copyable<data_t>());
+        return 0;
+    }
+    for (;;) {
+        uint32_t version = this->version->load(std::memory_order_acquire);
+        if (version & 1) {
+            sched_yield();
+            continue;
+        }
+        copy(array, this->shmaddr + index, size, std::is_trivially_copyable<data_t>());
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (this->version->load(std::memory_order_relaxed) == version) {
+            return 0;
+        }
     }
 }
 
@@ -125,16 +518,49 @@ void SharedMemory<data_t>::read(data_t* array, int size, int index) {
 /// @return The copy of the value.
 template <class data_t>
 data_t SharedMemory<data_t>::read(int index) {
+    if (this->version != NULL) {
+        typename std::aligned_storage<sizeof(data_t), alignof(data_t)>::type element;
+        this->read((data_t*) &element, 1, index);
+        return *((data_t*) &element);
+    }
     return this->shmaddr[index];
 }
 
+/// @brief Returns the size of the shared memory, in elements.
+template <class data_t>
+size_t SharedMemory<data_t>::get_size(void) const {
+    return this->size;
+}
+
+/// @brief Returns the version of a SHMEM_SEQLOCK memory. It's odd while
+///  somebody writes, and grows by two with every write, so a reader can check
+///  if anything changed since it last read. "0" without SHMEM_SEQLOCK.
+template <class data_t>
+uint32_t SharedMemory<data_t>::get_version(void) const {
+    return (this->version) ? this->version->load(std::memory_order_acquire) : 0;
+}
+
 /// @brief Checks if the shared memory exists.
 /// @param path Any file path. Identifies the shm.
 /// @param id Any number. Identifies the shm.
+/// @param backend SHMEM_SYSV (default) or SHMEM_POSIX. A SHMEM_MEMFD memory
+///  can't be found by name, so it's never found.
 /// @return "true" if it exists, "false" otherwise.
 template <class data_t>
-bool SharedMemory<data_t>::exists(const char* path, int id) {
+bool SharedMemory<data_t>::exists(const char* path, int id, int backend) {
     key_t key;
+    char name[32];
+    int fd;
+    if (backend == SHMEM_POSIX) {
+        if (get_name(path, id, name) == -1 || (fd = shm_open(name, O_RDONLY, 0)) == -1) {
+            return false;
+        }
+        close(fd);
+        return true;
+    }
+    if (backend != SHMEM_SYSV) {
+        return false;
+    }
     if ( ( key = ftok(path, id) ) == -1) {
         return false;
     }
@@ -144,6 +570,57 @@ bool SharedMemory<data_t>::exists(const char* path, int id) {
     return true;
 }
 
+/// @brief Builds the name of a POSIX memory from the same key as a System V
+///  one, so that every backend is identified by "path" and "id".
+/// @param name Where the name will be stored. At least 32 bytes.
+/// @return "0" on success, "-1" on error.
+template <class data_t>
+int SharedMemory<data_t>::get_name(const char* path, int id, char* name) {
+    key_t key;
+    if ( (key = ftok(path, id)) == -1) {
+        return -1;
+    }
+    snprintf(name, 32, "/ccotti_shm_%x", (unsigned int) key);
+    return 0;
+}
+
+/// @brief Copies trivially copyable elements as a single block of bytes.
+template <class data_t>
+void SharedMemory<data_t>::copy(data_t* dst, const data_t* src, int size, std::true_type) {
+    shm_copy((void*) dst, (const void*) src, (size_t) size * sizeof(data_t));
+}
+
+/// @brief Copies other elements one by one, with their assignment operator.
+template <class data_t>
+void SharedMemory<data_t>::copy(data_t* dst, const data_t* src, int size, std::false_type) {
+    for (int i = 0; i < size; i++) {
+        dst[i] = src[i];
+    }
+}
+
+/// @brief Makes the version odd, waiting while another writer has it odd.
+template <class data_t>
+void SharedMemory<data_t>::lock_version(void) {
+    uint32_t version = this->version->load(std::memory_order_relaxed);
+    for (;;) {
+        if (version & 1) {
+            sched_yield();
+            version = this->version->load(std::memory_order_relaxed);
+        } else if (this->version->compare_exchange_weak(version, version + 1, std::memory_order_acquire,
+                                                        std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    // The elements can't be written before readers can see the odd version.
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+/// @brief Makes the version even again, publishing the written elements.
+template <class data_t>
+void SharedMemory<data_t>::unlock_version(void) {
+    this->version->store(this->version->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
 /******************************************************************************
  * Overloaded operators
 ******************************************************************************/
@@ -161,7 +638,8 @@ SharedMemory<data_t>& SharedMemory<data_t>::operator<< (data_t element) {
     return *this;
 }
 
-/// @brief Return a modifiable reference to the value at "index".
+/// @brief Return a modifiable reference to the value at "index". It isn't
+///  protected by SHMEM_SEQLOCK.
 template <class data_t>
 data_t& SharedMemory<data_t>::operator[] (int index) {
     return this->shmaddr[index];
@@ -0,0 +1,240 @@
+#ifndef SHM_ARENA_H
+#define SHM_ARENA_H
+
+#include "shared_memory.h"
+#include "futex.h"
+#include "tools.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdexcept>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Blocks up to this size (in bytes, a power of two) are taken from free lists
+// of their size class: 16, 32, 64... Larger ones are kept in a single list.
+#define SHM_ARENA_MAX_SMALL     (64 * 1024)
+// Alignment of every block.
+#define SHM_ARENA_ALIGN         16
+
+/******************************************************************************
+ * Offset pointer
+******************************************************************************/
+
+/// @brief Pointer that can be stored inside a shared memory, and used by
+///  processes that map it at different addresses. It keeps the distance from
+///  itself to the pointee, which is the same in every mapping, so the pointer
+///  and the pointee must be in the same shared memory (or the pointer be a
+///  local variable). Copying it recomputes the distance.
+template <class T>
+class ShmPtr {
+private:
+    // Distance in bytes. "1" is a null pointer: nothing can start at the
+    // second byte of the pointer itself. It's computed on integers: the
+    // compiler may assume that pointer arithmetic from "this" stays inside
+    // the ShmPtr, and optimize accesses to the pointee away.
+    ptrdiff_t offset;
+
+    void set(const void* address) {
+        this->offset = (address) ? (ptrdiff_t) ((uintptr_t) address - (uintptr_t) this) : 1;
+    }
+
+public:
+    typedef T element_type;
+    typedef T value_type;
+    typedef ptrdiff_t difference_type;
+    typedef ShmPtr<T> pointer;
+    typedef typename std::add_lvalue_reference<T>::type reference;
+    typedef std::random_access_iterator_tag iterator_category;
+    template <class U> using rebind = ShmPtr<U>;
+
+    ShmPtr(T* address=NULL) { this->set(address); }
+    ShmPtr(const ShmPtr& other) { this->set(other.get()); }
+    template <class U, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    ShmPtr(const ShmPtr<U>& other) { this->set(static_cast<T*>(other.get())); }
+
+    ShmPtr& operator=(const ShmPtr& other) { this->set(other.get()); return *this; }
+    ShmPtr& operator=(T* address) { this->set(address); return *this; }
+
+    T* get(void) const {
+        return (this->offset == 1) ? NULL : (T*) ((uintptr_t) this + this->offset);
+    }
+    reference operator*() const { return *(this->get()); }
+    T* operator->() const { return this->get(); }
+    reference operator[](ptrdiff_t index) const { return this->get()[index]; }
+    explicit operator bool() const { return this->offset != 1; }
+
+    // Pointer arithmetic, so that containers can use it as their "pointer".
+    ShmPtr& operator+=(ptrdiff_t n) { this->set(this->get() + n); return *this; }
+    ShmPtr& operator-=(ptrdiff_t n) { this->set(this->get() - n); return *this; }
+    ShmPtr& operator++() { return *this += 1; }
+    ShmPtr& operator--() { return *this -= 1; }
+    ShmPtr operator++(int) { ShmPtr old(*this); *this += 1; return old; }
+    ShmPtr operator--(int) { ShmPtr old(*this); *this -= 1; return old; }
+    ShmPtr operator+(ptrdiff_t n) const { return ShmPtr(this->get() + n); }
+    ShmPtr operator-(ptrdiff_t n) const { return ShmPtr(this->get() - n); }
+    ptrdiff_t operator-(const ShmPtr& other) const { return this->get() - other.get(); }
+
+    static ShmPtr pointer_to(reference object) { return ShmPtr(std::addressof(object)); }
+};
+
+template <class T, class U>
+bool operator==(const ShmPtr<T>& a, const ShmPtr<U>& b) { return a.get() == b.get(); }
+template <class T, class U>
+bool operator!=(const ShmPtr<T>& a, const ShmPtr<U>& b) { return a.get() != b.get(); }
+template <class T, class U>
+bool operator<(const ShmPtr<T>& a, const ShmPtr<U>& b) { return a.get() < b.get(); }
+template <class T, class U>
+bool operator>(const ShmPtr<T>& a, const ShmPtr<U>& b) { return a.get() > b.get(); }
+template <class T, class U>
+bool operator<=(const ShmPtr<T>& a, const ShmPtr<U>& b) { return a.get() <= b.get(); }
+template <class T, class U>
+bool operator>=(const ShmPtr<T>& a, const ShmPtr<U>& b) { return a.get() >= b.get(); }
+template <class T>
+bool operator==(const ShmPtr<T>& a, std::nullptr_t) { return !a; }
+template <class T>
+bool operator!=(const ShmPtr<T>& a, std::nullptr_t) { return (bool) a; }
+template <class T>
+ShmPtr<T> operator+(ptrdiff_t n, const ShmPtr<T>& ptr) { return ptr + n; }
+
+/******************************************************************************
+ * Arena
+******************************************************************************/
+
+/// @brief Heap inside a shared memory, so that variable sized and linked data
+///  (lists, trees, containers) can be built once and used in place by every
+///  process, instead of being serialized or rebuilt by each one. Link the
+///  blocks with ShmPtr, and give containers a ShmAllocator.
+///
+///  Small blocks are rounded up to a power of two, and freed ones are kept in
+///  a free list per size class, so allocating and freeing them is a pop or a
+///  push. Larger blocks are taken from a best fit list, without splitting or
+///  merging them. New blocks are cut from the end of the used space. Every
+///  operation takes a futex lock in the arena, shared by all the processes.
+class ShmArena {
+public:
+    static const int CLASSES = 13;  // 16 bytes to SHM_ARENA_MAX_SMALL.
+    struct Header {
+        std::atomic<uint32_t> magic;   // "0" until the arena is ready.
+        std::atomic<uint32_t> lock;     // 0 unlocked, 1 locked, 2 with waiters.
+        uint64_t size;                  // Bytes of the shared memory.
+        uint64_t top;                   // Offset of the unused space.
+        uint64_t used;                  // Bytes in allocated blocks.
+        uint64_t root;                  // Offset of the root object, or "0".
+        uint64_t free[CLASSES];         // Offset of the first free block, or "0".
+        uint64_t large_free;
+    };
+
+private:
+    // Prefix of every block. While a block is free, its first 8 bytes hold the
+    // offset of the next free one.
+    struct Block {
+        uint64_t size;      // Usable bytes.
+        uint64_t size_class;
+    };
+    SharedMemory<char> shm;
+    Header* header;
+
+public:
+    ShmArena(const char* path, int id, size_t size=0, int flags=SHMEM_SYSV);
+
+    void* allocate(size_t size);
+    void deallocate(void* ptr);
+    template <class T, class... Args> T* construct(Args&&... args);
+    template <class T> void destroy(T* object);
+    void set_root(void* object);
+    void* get_root(void) const;
+    size_t get_size(void) const;
+    size_t get_used(void) const;
+    bool contains(const void* ptr) const;
+    Header* get_header(void) const;
+    static bool exists(const char* path, int id, int backend=SHMEM_SYSV);
+
+    static void* allocate(Header* header, size_t size);
+    static void deallocate(Header* header, void* ptr);
+};
+
+/// @brief Allocates and constructs an object inside the arena.
+/// @return The object, or NULL if there's no room for it (errno ENOMEM).
+template <class T, class... Args>
+T* ShmArena::construct(Args&&... args) {
+    static_assert(alignof(T) <= SHM_ARENA_ALIGN, "over-aligned types aren't supported");
+    void* memory = this->allocate(sizeof(T));
+    if (memory == NULL) {
+        return NULL;
+    }
+    return new (memory) T(std::forward<Args>(args)...);
+}
+
+/// @brief Destroys and frees an object built with ShmArena::construct().
+template <class T>
+void ShmArena::destroy(T* object) {
+    if (object != NULL) {
+        object->~T();
+        this->deallocate(object);
+    }
+}
+
+/******************************************************************************
+ * STL allocator
+******************************************************************************/
+
+/// @brief Allocator for standard containers whose elements must live in a
+///  ShmArena. Its "pointer" is a ShmPtr, and it refers to the arena with one,
+///  so a container built inside the arena (see ShmArena::construct()) can be
+///  used from every process. Only containers that store their links as the
+///  allocator's "pointer" can be shared this way, like std::vector. In
+///  libstdc++, std::basic_string doesn't accept it, and node based containers
+///  (std::list, std::map) link their nodes with raw pointers, which are only
+///  valid in one process.
+template <class T>
+class ShmAllocator {
+private:
+    ShmPtr<ShmArena::Header> header;
+
+    template <class U> friend class ShmAllocator;
+
+public:
+    typedef T value_type;
+    typedef ShmPtr<T> pointer;
+    typedef ShmPtr<const T> const_pointer;
+    typedef ShmPtr<void> void_pointer;
+    typedef ShmPtr<const void> const_void_pointer;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    template <class U> struct rebind { typedef ShmAllocator<U> other; };
+
+    ShmAllocator(const ShmArena& arena): header(arena.get_header()) {}
+    template <class U>
+    ShmAllocator(const ShmAllocator<U>& other): header(other.header) {}
+
+    /// @brief Allocates room for "n" elements.
+    /// @return On error, std::bad_alloc() is thrown.
+    pointer allocate(size_t n) {
+        void* memory = ShmArena::allocate(this->header.get(), n * sizeof(T));
+        if (memory == NULL) {
+            throw(std::bad_alloc());
+        }
+        return pointer((T*) memory);
+    }
+    void deallocate(pointer ptr, size_t) {
+        ShmArena::deallocate(this->header.get(), ptr.get());
+    }
+    ShmArena::Header* get_header(void) const {
+        return this->header.get();
+    }
+};
+
+template <class T, class U>
+bool operator==(const ShmAllocator<T>& a, const ShmAllocator<U>& b) {
+    return a.get_header() == b.get_header();
+}
+template <class T, class U>
+bool operator!=(const ShmAllocator<T>& a, const ShmAllocator<U>& b) {
+    return a.get_header() != b.get_header();
+}
+
+#endif // SHM_ARENA_H
@@ -0,0 +1,311 @@
+#ifndef SHM_BROADCAST_H
+#define SHM_BROADCAST_H
+
+#include "shared_memory.h"
+#include "futex.h"
+#include "tools.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdexcept>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <sched.h>
+#include <time.h>
+
+// Times a blocked read polls the channel before sleeping on a futex.
+#define SHM_BROADCAST_SPIN  64
+// Tag of a ShmBroadcast, see shm_wait_ready().
+#define SHM_BROADCAST_MAGIC 0x54534342  // "BCST"
+
+/******************************************************************************
+ * Class definition
+******************************************************************************/
+
+/// @brief Publish/subscribe channel inside a shared memory. One process
+///  publishes each message once, into a ring of slots, and every subscriber
+///  reads it with its own cursor, so the cost of publishing doesn't depend on
+///  the amount of subscribers. The publisher never waits: a subscriber that
+///  falls more than a ring behind loses the oldest messages, and it's told so
+///  (EOVERFLOW) instead of getting torn or out of order data.
+template <class msg_t>
+class ShmBroadcast {
+private:
+    struct alignas(SHM_CACHE_LINE) Slot {
+        // "2 * position + 2" once the message at "position" is written, and
+        // odd while it's being written.
+        std::atomic<uint64_t> seq;
+        msg_t msg;
+    };
+    struct Header {
+        alignas(SHM_CACHE_LINE) std::atomic<uint64_t> write_pos;
+        // Sleeping subscribers, and futex word bumped to wake them.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> readers_waiting;
+        std::atomic<uint32_t> published;
+        // Written once by the creator. "magic" is "0" until the channel is ready.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> magic;
+        std::atomic<uint32_t> capacity;
+    };
+    SharedMemory<char> shm;
+    Header* header;
+    Slot* slots;
+    uint32_t mask;
+    uint64_t cursor;
+    uint64_t lost;
+
+    static size_t round_capacity(size_t capacity);
+
+public:
+    ShmBroadcast(const char* path, int id, size_t capacity=0);
+    static bool exists(const char* path, int id);
+
+    int publish(const msg_t& msg);
+    int try_read(msg_t& msg);
+    msg_t read(int* status=NULL, int timeout_ms=-1);
+    void seek_latest(void);
+    void seek_oldest(void);
+    int get_pending(void);
+    uint64_t get_lost(void);
+    int get_capacity(void);
+    ShmBroadcast& operator<<(const msg_t& msg);
+    ShmBroadcast& operator>>(msg_t& msg);
+};
+
+/******************************************************************************
+ * Template functions
+******************************************************************************/
+
+/// @brief Creates or connects to a channel. A new subscriber starts at the
+///  next message to be published (see ShmBroadcast::seek_oldest() to get the
+///  ones still in the ring).
+/// @tparam msg_t Type of the message. It's copied byte by byte between
+///  processes, so it must be trivially copyable.
+/// @param path Any file path. Identifies the channel, same as SharedMemory.
+/// @param id Any number. Identifies the channel.
+/// @param capacity If > 0, the channel is created with room for at least that
+///  many messages (rounded up to a power of two). It's how far behind a
+///  subscriber can be before losing messages. If "0", connects to an already
+///  existing channel (default).
+/// @return On error, std::runtime_error() is thrown. Also if the memory
+///  doesn't hold a ShmBroadcast, or its creator doesn't finish it in time.
+template <class msg_t>
+ShmBroadcast<msg_t>::ShmBroadcast(const char* path, int id, size_t capacity):
+    shm(path, id, (capacity > 0) ? sizeof(Header) + round_capacity(capacity) * sizeof(Slot) : 0),
+    lost(0) {
+    static_assert(std::is_trivially_copyable<msg_t>::value, "ShmBroadcast messages must be trivially copyable");
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "ShmBroadcast needs lock free atomics");
+    this->header = (Header*) &(this->shm[0]);
+    this->slots = (Slot*) (this->header + 1);
+    if (capacity > 0) {
+        capacity = round_capacity(capacity);
+        new (this->header) Header();
+        for (size_t i = 0; i < capacity; i++) {
+            new (&(this->slots[i].seq)) std::atomic<uint64_t>(0);
+        }
+        this->header->capacity.store(capacity, std::memory_order_relaxed);
+        this->header->magic.store(SHM_BROADCAST_MAGIC, std::memory_order_release);
+    } else if (this->shm.get_size() < sizeof(Header) ||
+               shm_wait_ready(this->header->magic, SHM_BROADCAST_MAGIC) == -1) {
+        perror(ERROR("not a channel in ShmBroadcast::ShmBroadcast"));
+        throw(std::runtime_error("magic"));
+    }
+    this->mask = this->header->capacity.load(std::memory_order_relaxed) - 1;
+    this->seek_latest();
+}
+
+/// @brief Checks if the channel exists.
+/// @return "true" if it exists, "false" otherwise.
+template <class msg_t>
+bool ShmBroadcast<msg_t>::exists(const char* path, int id) {
+    return SharedMemory<char>::exists(path, id);
+}
+
+/// @brief Publishes a message to every subscriber. It never blocks. Only one
+///  process (or thread) can publish to the channel.
+/// @param msg Message to be published.
+/// @return "0".
+template <class msg_t>
+int ShmBroadcast<msg_t>::publish(const msg_t& msg) {
+    uint64_t pos = this->header->write_pos.load(std::memory_order_relaxed);
+    Slot* slot = &(this->slots[pos & this->mask]);
+    // Subscribers that see the odd value, or that see it changed after their
+    // copy, know the copy might be torn.
+    slot->seq.store(2 * pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy((void*) &(slot->msg), &msg, sizeof(msg_t));
+    slot->seq.store(2 * pos + 2, std::memory_order_release);
+    this->header->write_pos.store(pos + 1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->header->readers_waiting.load(std::memory_order_relaxed) > 0) {
+        this->header->published.fetch_add(1, std::memory_order_relaxed);
+        Futex::wake(&(this->header->published));
+    }
+    return 0;
+}
+
+/// @brief Reads the next message for this subscriber, without blocking.
+/// @param msg Where the message will be stored.
+/// @return "1" if a message was read, "0" if there are no new messages, or
+///  "-1" if the publisher overwrote the next message before it was read. In
+///  that case errno is EOVERFLOW, and the cursor is moved to the oldest message
+///  still available (see ShmBroadcast::get_lost()).
+template <class msg_t>
+int ShmBroadcast<msg_t>::try_read(msg_t& msg) {
+    Slot* slot = &(this->slots[this->cursor & this->mask]);
+    uint64_t expected = 2 * this->cursor + 2;
+    uint64_t seq = slot->seq.load(std::memory_order_acquire);
+    if (seq < expected) {
+        return 0;   // Not written yet (or being written).
+    }
+    if (seq == expected) {
+        memcpy(&msg, (const void*) &(slot->msg), sizeof(msg_t));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->seq.load(std::memory_order_relaxed) == expected) {
+            this->cursor++;
+            return 1;
+        }
+    }
+    // Lapped by the publisher.
+    uint64_t oldest = this->header->write_pos.load(std::memory_order_acquire) - this->mask;
+    this->lost += oldest - this->cursor;
+    this->cursor = oldest;
+    errno = EOVERFLOW;
+    return -1;
+}
+
+/// @brief Reads the next message for this subscriber, waiting for it if
+///  needed.
+/// @param status If not NULL, it will be loaded with a "0" on success, with
+///  EOVERFLOW if messages were lost (see ShmBroadcast::try_read()), with
+///  ETIMEDOUT if the timeout expired, or with EINTR if interrupted by a signal.
+/// @param timeout_ms Maximum time to wait, in milliseconds. If negative, waits
+///  forever (default).
+/// @return The message read. Junk if "status" is not "0".
+template <class msg_t>
+msg_t ShmBroadcast<msg_t>::read(int* status, int timeout_ms) {
+    struct timespec deadline, now, timeout;
+    int error_state = 0, result;
+    uint32_t value;
+    msg_t msg;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    for (int spin = 0; (result = this->try_read(msg)) == 0; spin++) {
+        if (spin < SHM_BROADCAST_SPIN) {
+            continue;
+        }
+        // Announce the wait, and check again before sleeping. Either the
+        // publisher sees it, or this process sees the new message.
+        this->header->readers_waiting.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        value = this->header->published.load(std::memory_order_relaxed);
+        if ( (result = this->try_read(msg)) == 0) {
+            if (timeout_ms >= 0) {
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                timeout.tv_sec = deadline.tv_sec - now.tv_sec;
+                timeout.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+                if (timeout.tv_nsec < 0) {
+                    timeout.tv_sec--;
+                    timeout.tv_nsec += 1000000000L;
+                }
+                if (timeout.tv_sec < 0) {
+                    errno = ETIMEDOUT;
+                    result = -1;
+                } else {
+                    result = Futex::wait(&(this->header->published), value, &timeout);
+                }
+            } else {
+                result = Futex::wait(&(this->header->published), value);
+            }
+        }
+        this->header->readers_waiting.fetch_sub(1, std::memory_order_relaxed);
+        if (result != 0) {
+            break;
+        }
+    }
+    if (result == -1) {
+        error_state = errno;
+    }
+    if (status != NULL) {
+        *status = error_state;
+    }
+    return msg;
+}
+
+/// @brief Moves the cursor of this subscriber to the next message to be
+///  published, skipping everything in the ring.
+template <class msg_t>
+void ShmBroadcast<msg_t>::seek_latest(void) {
+    this->cursor = this->header->write_pos.load(std::memory_order_acquire);
+}
+
+/// @brief Moves the cursor of this subscriber to the oldest message still in
+///  the ring, to catch up with what was published before it joined.
+template <class msg_t>
+void ShmBroadcast<msg_t>::seek_oldest(void) {
+    uint64_t write_pos = this->header->write_pos.load(std::memory_order_acquire);
+    // Leave the next slot to be overwritten out.
+    this->cursor = (write_pos > this->mask) ? write_pos - this->mask : 0;
+}
+
+/// @brief Returns the amount of messages published and not yet read by this
+///  subscriber. If larger than the capacity, some of them were lost.
+template <class msg_t>
+int ShmBroadcast<msg_t>::get_pending(void) {
+    return (int) (this->header->write_pos.load(std::memory_order_acquire) - this->cursor);
+}
+
+/// @brief Returns the amount of messages this subscriber lost, because the
+///  publisher overwrote them before they were read.
+template <class msg_t>
+uint64_t ShmBroadcast<msg_t>::get_lost(void) {
+    return this->lost;
+}
+
+/// @brief Returns the maximum amount of messages in the ring.
+template <class msg_t>
+int ShmBroadcast<msg_t>::get_capacity(void) {
+    return (int) this->mask + 1;
+}
+
+/// @brief Rounds the capacity up to a power of two, so that positions can
+///  wrap around with a mask.
+template <class msg_t>
+size_t ShmBroadcast<msg_t>::round_capacity(size_t capacity) {
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+/******************************************************************************
+ * Overloaded operators
+******************************************************************************/
+
+/// @brief Publishes a message.
+template <class msg_t>
+ShmBroadcast<msg_t>& ShmBroadcast<msg_t>::operator<<(const msg_t& msg) {
+    this->publish(msg);
+    return *this;
+}
+
+/// @brief Reads the next message. Might throw "std::runtime_error", also when
+///  messages were lost.
+template <class msg_t>
+ShmBroadcast<msg_t>& ShmBroadcast<msg_t>::operator>>(msg_t& msg) {
+    int status;
+    msg = this->read(&status);
+    if (status != 0) {
+        throw(std::runtime_error("ShmBroadcast::operator>>"));
+    }
+    return *this;
+}
+
+#endif // SHM_BROADCAST_H
@@ -0,0 +1,396 @@
+#ifndef SHM_HASH_MAP_H
+#define SHM_HASH_MAP_H
+
+#include "shared_memory.h"
+#include "futex.h"
+#include "tools.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <stdexcept>
+#include <atomic>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <sched.h>
+
+// Writer locks of a ShmHashMap. Writers of keys in different stripes don't
+// wait for each other. Must be a power of two.
+#define SHM_HASH_STRIPES    64
+// Tag of a ShmHashMap, see shm_wait_ready().
+#define SHM_HASH_MAGIC      0x48534148  // "HASH"
+
+/******************************************************************************
+ * Class definition
+******************************************************************************/
+
+/// @brief Hash map inside a shared memory, for any number of processes, with
+///  a fixed capacity. It uses open addressing with linear probing, so a lookup
+///  reads consecutive buckets, and takes no lock: each bucket has a sequence
+///  number, odd while it's being written, and readers retry if it changed
+///  while they copied the bucket (a seqlock per bucket). Writers lock the
+///  stripe of their key, so two writers only wait for each other if their
+///  keys hash to the same stripe, and claim free buckets with a compare-and-
+///  swap. Erased buckets are marked, and reused by later inserts. When marks
+///  take a quarter of the buckets, the writer that erased the last one locks
+///  every stripe and moves the keys back over them, so that misses, which
+///  stop at the first empty bucket, don't end up scanning the whole table.
+///  Lookups that miss while keys are being moved are retried.
+template <class map_key_t, class map_value_t, class hash_t=std::hash<map_key_t>>
+class ShmHashMap {
+private:
+    enum State: uint32_t { EMPTY, BUSY, FULL, DELETED, MOVING, MATCH };
+    struct Bucket {
+        std::atomic<uint32_t> seq;
+        std::atomic<uint32_t> state;
+        map_key_t key;
+        map_value_t value;
+    };
+    struct Stripe {
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> lock;
+    };
+    struct Header {
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> size;
+        std::atomic<uint32_t> deleted;      // Buckets marked as DELETED.
+        // Written once by the creator. "magic" is "0" until the map is ready.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> magic;
+        std::atomic<uint32_t> buckets;
+        std::atomic<uint32_t> moves;        // Odd while keys are being moved.
+        Stripe stripes[SHM_HASH_STRIPES];
+    };
+    SharedMemory<char> shm;
+    Header* header;
+    Bucket* buckets;
+    uint32_t mask;
+
+    static size_t round_buckets(size_t capacity);
+    static uint64_t hash(const map_key_t& key);
+    State snapshot(const Bucket* bucket, const map_key_t& key, map_value_t* value) const;
+    void write_bucket(Bucket* bucket, State state, const map_key_t* key, const map_value_t* value);
+    bool lookup(const map_key_t& key, map_value_t* value) const;
+    void drop_deleted(void);
+
+public:
+    ShmHashMap(const char* path, int id, size_t capacity=0, int flags=SHMEM_SYSV);
+    static bool exists(const char* path, int id, int backend=SHMEM_SYSV);
+
+    int insert(const map_key_t& key, const map_value_t& value);
+    bool find(const map_key_t& key, map_value_t& value) const;
+    bool contains(const map_key_t& key) const;
+    int erase(const map_key_t& key);
+    size_t get_size(void) const;
+    size_t get_capacity(void) const;
+};
+
+/******************************************************************************
+ * Template functions
+******************************************************************************/
+
+/// @brief Creates or connects to a hash map.
+/// @tparam map_key_t Type of the keys. It's copied byte by byte between
+///  processes, so it must be trivially copyable, and compared with "==".
+/// @tparam map_value_t Type of the values. Must be trivially copyable.
+/// @tparam hash_t Hash of the keys. It must give the same result in every
+///  process, like std::hash of integers does (default). It's mixed again, so
+///  it doesn't need to spread the bits.
+/// @param path Any file path. Identifies the map, same as SharedMemory.
+/// @param id Any number. Identifies the map.
+/// @param capacity If > 0, the map is created with room for at least that
+///  many keys. It has twice as many buckets, rounded up to a power of two, to
+///  keep probes short. If "0", connects to an already existing map (default).
+/// @param flags SharedMemory backend and page options (see SharedMemory).
+/// @return On error, std::runtime_error() is thrown. Also if the memory
+///  doesn't hold a ShmHashMap, or its creator doesn't finish it in time.
+template <class map_key_t, class map_value_t, class hash_t>
+ShmHashMap<map_key_t, map_value_t, hash_t>::ShmHashMap(const char* path, int id, size_t capacity, int flags):
+    shm(path, id, (capacity > 0) ? sizeof(Header) + round_buckets(capacity) * sizeof(Bucket) : 0, flags) {
+    static_assert(std::is_trivially_copyable<map_key_t>::value, "ShmHashMap keys must be trivially copyable");
+    static_assert(std::is_trivially_copyable<map_value_t>::value, "ShmHashMap values must be trivially copyable");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2, "ShmHashMap needs lock free atomics");
+    this->header = (Header*) &(this->shm[0]);
+    this->buckets = (Bucket*) (this->header + 1);
+    if (capacity > 0) {
+        size_t buckets = round_buckets(capacity);
+        new (this->header) Header();
+        for (size_t i = 0; i < buckets; i++) {
+            new (&(this->buckets[i].seq)) std::atomic<uint32_t>(0);
+            new (&(this->buckets[i].state)) std::atomic<uint32_t>(EMPTY);
+        }
+        this->header->buckets.store(buckets, std::memory_order_relaxed);
+        this->header->magic.store(SHM_HASH_MAGIC, std::memory_order_release);
+    } else if (this->shm.get_size() < sizeof(Header) ||
+               shm_wait_ready(this->header->magic, SHM_HASH_MAGIC) == -1) {
+        perror(ERROR("not a map in ShmHashMap::ShmHashMap"));
+        throw(std::runtime_error("magic"));
+    }
+    this->mask = this->header->buckets.load(std::memory_order_relaxed) - 1;
+}
+
+/// @brief Checks if the map exists.
+/// @return "true" if it exists, "false" otherwise.
+template <class map_key_t, class map_value_t, class hash_t>
+bool ShmHashMap<map_key_t, map_value_t, hash_t>::exists(const char* path, int id, int backend) {
+    return SharedMemory<char>::exists(path, id, backend);
+}
+
+/// @brief Inserts a key, or updates its value if it's already in the map.
+/// @return "1" if the key was inserted, "0" if it was updated, "-1" if the
+///  map is full (errno ENOSPC).
+template <class map_key_t, class map_value_t, class hash_t>
+int ShmHashMap<map_key_t, map_value_t, hash_t>::insert(const map_key_t& key, const map_value_t& value) {
+    uint64_t key_hash = hash(key);
+    std::atomic<uint32_t>& lock = this->header->stripes[(key_hash >> 32) & (SHM_HASH_STRIPES - 1)].lock;
+    Bucket* free_bucket;
+    uint32_t expected;
+
+    Futex::lock(lock);
+    do {
+        free_bucket = NULL;
+        for (uint32_t i = key_hash & this->mask, n = 0; n <= this->mask; i = (i + 1) & this->mask, n++) {
+            State state = this->snapshot(&(this->buckets[i]), key, NULL);
+            if (state == MATCH) {
+                // Only writers of this stripe change a bucket with this key.
+                this->write_bucket(&(this->buckets[i]), FULL, NULL, &value);
+                Futex::unlock(lock);
+                return 0;
+            }
+            if (state == DELETED && free_bucket == NULL) {
+                free_bucket = &(this->buckets[i]);
+            }
+            if (state == EMPTY) {
+                free_bucket = (free_bucket) ? free_bucket : &(this->buckets[i]);
+                break;
+            }
+        }
+        if (free_bucket == NULL || this->header->size.load(std::memory_order_relaxed) >= this->get_capacity()) {
+            Futex::unlock(lock);
+            errno = ENOSPC;
+            return -1;
+        }
+        // Writers of other stripes may be claiming the same bucket. If one of
+        // them wins, look for another one.
+        expected = free_bucket->state.load(std::memory_order_relaxed);
+    } while ((expected != EMPTY && expected != DELETED) ||
+             !free_bucket->state.compare_exchange_strong(expected, BUSY, std::memory_order_acquire));
+    this->write_bucket(free_bucket, FULL, &key, &value);
+    this->header->size.fetch_add(1, std::memory_order_relaxed);
+    if (expected == DELETED) {
+        this->header->deleted.fetch_sub(1, std::memory_order_relaxed);
+    }
+    Futex::unlock(lock);
+    return 1;
+}
+
+/// @brief Looks a key up, without locking.
+/// @param value Where the value will be copied, if the key is found.
+/// @return "true" if the key is in the map, "false" otherwise.
+template <class map_key_t, class map_value_t, class hash_t>
+bool ShmHashMap<map_key_t, map_value_t, hash_t>::find(const map_key_t& key, map_value_t& value) const {
+    return this->lookup(key, &value);
+}
+
+/// @brief Checks if a key is in the map, without locking.
+template <class map_key_t, class map_value_t, class hash_t>
+bool ShmHashMap<map_key_t, map_value_t, hash_t>::contains(const map_key_t& key) const {
+    return this->lookup(key, NULL);
+}
+
+/// @brief Removes a key from the map.
+/// @return "1" if the key was removed, "0" if it wasn't in the map.
+template <class map_key_t, class map_value_t, class hash_t>
+int ShmHashMap<map_key_t, map_value_t, hash_t>::erase(const map_key_t& key) {
+    uint64_t key_hash = hash(key);
+    std::atomic<uint32_t>& lock = this->header->stripes[(key_hash >> 32) & (SHM_HASH_STRIPES - 1)].lock;
+    Futex::lock(lock);
+    for (uint32_t i = key_hash & this->mask, n = 0; n <= this->mask; i = (i + 1) & this->mask, n++) {
+        State state = this->snapshot(&(this->buckets[i]), key, NULL);
+        if (state == MATCH) {
+            this->write_bucket(&(this->buckets[i]), DELETED, NULL, NULL);
+            this->header->size.fetch_sub(1, std::memory_order_relaxed);
+            uint32_t deleted = this->header->deleted.fetch_add(1, std::memory_order_relaxed) + 1;
+            Futex::unlock(lock);
+            if (deleted > (this->mask + 1) / 4) {
+                this->drop_deleted();
+            }
+            return 1;
+        }
+        if (state == EMPTY) {
+            break;
+        }
+    }
+    Futex::unlock(lock);
+    return 0;
+}
+
+/// @brief Returns the amount of keys in the map.
+template <class map_key_t, class map_value_t, class hash_t>
+size_t ShmHashMap<map_key_t, map_value_t, hash_t>::get_size(void) const {
+    return this->header->size.load(std::memory_order_relaxed);
+}
+
+/// @brief Returns the maximum amount of keys in the map: half of its buckets.
+template <class map_key_t, class map_value_t, class hash_t>
+size_t ShmHashMap<map_key_t, map_value_t, hash_t>::get_capacity(void) const {
+    return (this->mask + 1) / 2;
+}
+
+/******************************************************************************
+ * Private functions
+******************************************************************************/
+
+/// @brief Buckets needed for "capacity" keys: twice as many, rounded up to a
+///  power of two.
+template <class map_key_t, class map_value_t, class hash_t>
+size_t ShmHashMap<map_key_t, map_value_t, hash_t>::round_buckets(size_t capacity) {
+    size_t buckets = 2;
+    while (buckets < 2 * capacity) {
+        buckets <<= 1;
+    }
+    return buckets;
+}
+
+/// @brief Hashes a key with "hash_t", and mixes the bits (splitmix64), so that
+///  the low ones pick the bucket and the high ones the stripe.
+template <class map_key_t, class map_value_t, class hash_t>
+uint64_t ShmHashMap<map_key_t, map_value_t, hash_t>::hash(const map_key_t& key) {
+    uint64_t x = (uint64_t) hash_t()(key);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/// @brief Reads a consistent state of a bucket, retrying while a writer
+///  changes it.
+/// @param value If not NULL, where the value is copied if the key matches.
+/// @return The state of the bucket, or MATCH if it holds "key".
+template <class map_key_t, class map_value_t, class hash_t>
+typename ShmHashMap<map_key_t, map_value_t, hash_t>::State
+ShmHashMap<map_key_t, map_value_t, hash_t>::snapshot(const Bucket* bucket, const map_key_t& key,
+                                                     map_value_t* value) const {
+    typename std::aligned_storage<sizeof(map_key_t), alignof(map_key_t)>::type copy;
+    for (;;) {
+        uint32_t seq = bucket->seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        State state = (State) bucket->state.load(std::memory_order_relaxed);
+        bool match = false;
+        if (state == FULL) {
+            memcpy(&copy, (const void*) &(bucket->key), sizeof(map_key_t));
+            match = *((const map_key_t*) &copy) == key;
+            if (match && value != NULL) {
+                memcpy((void*) value, (const void*) &(bucket->value), sizeof(map_value_t));
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (bucket->seq.load(std::memory_order_relaxed) == seq) {
+            return (match) ? MATCH : state;
+        }
+    }
+}
+
+/// @brief Looks a key up, without locking. A miss while a writer moves the
+///  keys (see drop_deleted()) may be wrong, so it's retried.
+/// @param value If not NULL, where the value will be copied.
+/// @return "true" if the key is in the map, "false" otherwise.
+template <class map_key_t, class map_value_t, class hash_t>
+bool ShmHashMap<map_key_t, map_value_t, hash_t>::lookup(const map_key_t& key, map_value_t* value) const {
+    uint64_t key_hash = hash(key);
+    for (;;) {
+        uint32_t moves = this->header->moves.load(std::memory_order_acquire);
+        if (moves & 1) {
+            sched_yield();
+            continue;
+        }
+        for (uint32_t i = key_hash & this->mask, n = 0; n <= this->mask; i = (i + 1) & this->mask, n++) {
+            State state = this->snapshot(&(this->buckets[i]), key, value);
+            if (state == MATCH) {
+                return true;
+            }
+            if (state == EMPTY) {
+                break;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (this->header->moves.load(std::memory_order_relaxed) == moves) {
+            return false;
+        }
+    }
+}
+
+/// @brief Turns every DELETED bucket back into an EMPTY one, with all the
+///  stripes locked. Keys are marked as MOVING, and each one is moved to the
+///  first bucket of its probe sequence that isn't taken by an already placed
+///  key (swapping places if that one is still MOVING), so probes are as short
+///  as if the erased keys had never been inserted.
+template <class map_key_t, class map_value_t, class hash_t>
+void ShmHashMap<map_key_t, map_value_t, hash_t>::drop_deleted(void) {
+    typename std::aligned_storage<sizeof(map_key_t), alignof(map_key_t)>::type key, other_key;
+    typename std::aligned_storage<sizeof(map_value_t), alignof(map_value_t)>::type value, other_value;
+    for (int s = 0; s < SHM_HASH_STRIPES; s++) {
+        Futex::lock(this->header->stripes[s].lock);
+    }
+    // Another writer may have done it while this one waited.
+    if (this->header->deleted.load(std::memory_order_relaxed) > (this->mask + 1) / 4) {
+        this->header->moves.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (uint32_t i = 0; i <= this->mask; i++) {
+            uint32_t state = this->buckets[i].state.load(std::memory_order_relaxed);
+            if (state == DELETED) {
+                this->write_bucket(&(this->buckets[i]), EMPTY, NULL, NULL);
+            } else if (state == FULL) {
+                this->write_bucket(&(this->buckets[i]), MOVING, NULL, NULL);
+            }
+        }
+        for (uint32_t i = 0; i <= this->mask; i++) {
+            while (this->buckets[i].state.load(std::memory_order_relaxed) == MOVING) {
+                memcpy((void*) &key, (const void*) &(this->buckets[i].key), sizeof(map_key_t));
+                memcpy((void*) &value, (const void*) &(this->buckets[i].value), sizeof(map_value_t));
+                uint32_t target = hash(*((const map_key_t*) &key)) & this->mask;
+                while (this->buckets[target].state.load(std::memory_order_relaxed) == FULL) {
+                    target = (target + 1) & this->mask;
+                }
+                if (target == i) {
+                    this->write_bucket(&(this->buckets[i]), FULL, NULL, NULL);
+                } else if (this->buckets[target].state.load(std::memory_order_relaxed) == EMPTY) {
+                    this->write_bucket(&(this->buckets[target]), FULL, (const map_key_t*) &key, (const map_value_t*) &value);
+                    this->write_bucket(&(this->buckets[i]), EMPTY, NULL, NULL);
+                } else {
+                    // Swap with the MOVING key there, and place that one next.
+                    memcpy((void*) &other_key, (const void*) &(this->buckets[target].key), sizeof(map_key_t));
+                    memcpy((void*) &other_value, (const void*) &(this->buckets[target].value), sizeof(map_value_t));
+                    this->write_bucket(&(this->buckets[target]), FULL, (const map_key_t*) &key, (const map_value_t*) &value);
+                    this->write_bucket(&(this->buckets[i]), MOVING, (const map_key_t*) &other_key,
+                                       (const map_value_t*) &other_value);
+                }
+            }
+        }
+        this->header->deleted.store(0, std::memory_order_relaxed);
+        this->header->moves.fetch_add(1, std::memory_order_release);
+    }
+    for (int s = SHM_HASH_STRIPES - 1; s >= 0; s--) {
+        Futex::unlock(this->header->stripes[s].lock);
+    }
+}
+
+/// @brief Writes a bucket, with its sequence number odd in the meantime.
+/// @param key If not NULL, the new key.
+/// @param value If not NULL, the new value.
+template <class map_key_t, class map_value_t, class hash_t>
+void ShmHashMap<map_key_t, map_value_t, hash_t>::write_bucket(Bucket* bucket, State state,
+                                                              const map_key_t* key, const map_value_t* value) {
+    uint32_t seq = bucket->seq.load(std::memory_order_relaxed);
+    bucket->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if (key != NULL) {
+        memcpy((void*) &(bucket->key), (const void*) key, sizeof(map_key_t));
+    }
+    if (value != NULL) {
+        memcpy((void*) &(bucket->value), (const void*) value, sizeof(map_value_t));
+    }
+    bucket->state.store(state, std::memory_order_relaxed);
+    bucket->seq.store(seq + 2, std::memory_order_release);
+}
+
+#endif // SHM_HASH_MAP_H
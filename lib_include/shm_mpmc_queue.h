@@ -0,0 +1,363 @@
+#ifndef SHM_MPMC_QUEUE_H
+#define SHM_MPMC_QUEUE_H
+
+#include "shared_memory.h"
+#include "futex.h"
+#include "tools.h"
+#include <stdint.h>
+#include <stdexcept>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <sched.h>
+#include <time.h>
+
+// Times a blocked read or write polls the queue before sleeping on a futex.
+#define SHM_MPMC_SPIN   64
+// Tag of a ShmMpmcQueue, see shm_wait_ready().
+#define SHM_MPMC_MAGIC  0x434d504d  // "MPMC"
+
+/******************************************************************************
+ * Class definition
+******************************************************************************/
+
+/// @brief Bounded queue inside a shared memory, for any number of producer
+///  and consumer processes. Each slot has a sequence number that says if it's
+///  free for the writer of a given position, or ready for its reader, so
+///  processes only contend on the position counters (one compare-and-swap per
+///  operation), never on a lock. A process only sleeps (on a futex) when the
+///  queue is full for a writer, or empty for a reader.
+template <class msg_t>
+class ShmMpmcQueue {
+private:
+    struct alignas(SHM_CACHE_LINE) Slot {
+        std::atomic<uint32_t> seq;
+        msg_t msg;
+    };
+    struct Header {
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> enqueue_pos;
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> dequeue_pos;
+        // Sleeping writers, and futex word bumped to wake them after a read.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> producers_waiting;
+        std::atomic<uint32_t> reads;
+        // Sleeping readers, and futex word bumped to wake them after a write.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> consumers_waiting;
+        std::atomic<uint32_t> writes;
+        // Written once by the creator. "magic" is "0" until the queue is ready.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> magic;
+        std::atomic<uint32_t> capacity;
+    };
+    SharedMemory<char> shm;
+    Header* header;
+    Slot* slots;
+    uint32_t mask;
+
+    static size_t round_capacity(size_t capacity);
+    static void set_deadline(struct timespec* deadline, int timeout_ms);
+    int sleep(std::atomic<uint32_t>& waiting, std::atomic<uint32_t>& word, bool writer,
+        const msg_t* in, msg_t* out, const struct timespec* deadline);
+
+public:
+    ShmMpmcQueue(const char* path, int id, size_t capacity=0);
+    static bool exists(const char* path, int id);
+
+    int write(const msg_t& msg, int timeout_ms=-1);
+    bool try_write(const msg_t& msg);
+    msg_t read(int* status=NULL, int timeout_ms=-1);
+    bool try_read(msg_t& msg);
+    int get_msg_qtty(void);
+    int get_capacity(void);
+    bool is_empty(void);
+    bool has_msg(void);
+    ShmMpmcQueue& operator<<(const msg_t& msg);
+    ShmMpmcQueue& operator>>(msg_t& msg);
+};
+
+/******************************************************************************
+ * Template functions
+******************************************************************************/
+
+/// @brief Creates or connects to a queue.
+/// @tparam msg_t Type of the message. It's copied byte by byte between
+///  processes, so it must be trivially copyable. Each slot takes at least a
+///  cache line, to avoid false sharing between neighbour slots.
+/// @param path Any file path. Identifies the queue, same as SharedMemory.
+/// @param id Any number. Identifies the queue.
+/// @param capacity If > 0, the queue is created with room for at least that
+///  many messages (rounded up to a power of two). If "0", connects to an
+///  already existing queue (default).
+/// @return On error, std::runtime_error() is thrown. Also if the memory
+///  doesn't hold a ShmMpmcQueue, or its creator doesn't finish it in time.
+template <class msg_t>
+ShmMpmcQueue<msg_t>::ShmMpmcQueue(const char* path, int id, size_t capacity):
+    shm(path, id, (capacity > 0) ? sizeof(Header) + round_capacity(capacity) * sizeof(Slot) : 0) {
+    static_assert(std::is_trivially_copyable<msg_t>::value, "ShmMpmcQueue messages must be trivially copyable");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2, "ShmMpmcQueue needs lock free atomics");
+    this->header = (Header*) &(this->shm[0]);
+    this->slots = (Slot*) (this->header + 1);
+    if (capacity > 0) {
+        capacity = round_capacity(capacity);
+        new (this->header) Header();
+        for (size_t i = 0; i < capacity; i++) {
+            new (&(this->slots[i].seq)) std::atomic<uint32_t>(i);
+        }
+        this->header->capacity.store(capacity, std::memory_order_relaxed);
+        this->header->magic.store(SHM_MPMC_MAGIC, std::memory_order_release);
+    } else if (this->shm.get_size() < sizeof(Header) ||
+               shm_wait_ready(this->header->magic, SHM_MPMC_MAGIC) == -1) {
+        perror(ERROR("not a queue in ShmMpmcQueue::ShmMpmcQueue"));
+        throw(std::runtime_error("magic"));
+    }
+    this->mask = this->header->capacity.load(std::memory_order_relaxed) - 1;
+}
+
+/// @brief Checks if the queue exists.
+/// @return "true" if it exists, "false" otherwise.
+template <class msg_t>
+bool ShmMpmcQueue<msg_t>::exists(const char* path, int id) {
+    return SharedMemory<char>::exists(path, id);
+}
+
+/// @brief Writes a message, waiting while the queue is full.
+/// @param msg Message to be written.
+/// @param timeout_ms Maximum time to wait, in milliseconds. If negative, waits
+///  forever (default).
+/// @return "0" on success, "-1" on error, with "errno" set to ETIMEDOUT if the
+///  timeout expired, or to EINTR if interrupted by a signal.
+template <class msg_t>
+int ShmMpmcQueue<msg_t>::write(const msg_t& msg, int timeout_ms) {
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        set_deadline(&deadline, timeout_ms);
+    }
+    for (int spin = 0; !this->try_write(msg); spin++) {
+        if (spin < SHM_MPMC_SPIN) {
+            continue;
+        }
+        switch (this->sleep(this->header->producers_waiting, this->header->reads, true,
+                &msg, NULL, (timeout_ms >= 0) ? &deadline : NULL)) {
+            case 1:
+                return 0;
+            case -1:
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Writes a message if there is room for it, without blocking.
+/// @return "true" if it was written, "false" if the queue is full.
+template <class msg_t>
+bool ShmMpmcQueue<msg_t>::try_write(const msg_t& msg) {
+    uint32_t pos = this->header->enqueue_pos.load(std::memory_order_relaxed);
+    Slot* slot;
+    int32_t diff;
+    while (true) {
+        slot = &(this->slots[pos & this->mask]);
+        diff = (int32_t) (slot->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            // Free for this position, try to claim it.
+            if (this->header->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // Still not read since the last lap: full.
+        } else {
+            pos = this->header->enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->msg = msg;
+    slot->seq.store(pos + 1, std::memory_order_release);
+    // Either the sleeping reader sees the new slot, or this sees the reader.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->header->consumers_waiting.load(std::memory_order_relaxed) > 0) {
+        this->header->writes.fetch_add(1, std::memory_order_relaxed);
+        Futex::wake(&(this->header->writes), 1);
+    }
+    return true;
+}
+
+/// @brief Reads the first message, waiting while the queue is empty.
+/// @param status If not NULL, it will be loaded with a "0" on success, with
+///  ETIMEDOUT if the timeout expired, or with EINTR if interrupted by a signal.
+/// @param timeout_ms Maximum time to wait, in milliseconds. If negative, waits
+///  forever (default).
+/// @return The message read. Junk if "status" is not "0".
+template <class msg_t>
+msg_t ShmMpmcQueue<msg_t>::read(int* status, int timeout_ms) {
+    struct timespec deadline;
+    int error_state = 0;
+    msg_t msg;
+    if (timeout_ms >= 0) {
+        set_deadline(&deadline, timeout_ms);
+    }
+    for (int spin = 0; !this->try_read(msg); spin++) {
+        if (spin < SHM_MPMC_SPIN) {
+            continue;
+        }
+        int result = this->sleep(this->header->consumers_waiting, this->header->writes, false,
+            NULL, &msg, (timeout_ms >= 0) ? &deadline : NULL);
+        if (result == 1) {
+            break;
+        } else if (result == -1) {
+            error_state = errno;
+            break;
+        }
+    }
+    if (status != NULL) {
+        *status = error_state;
+    }
+    return msg;
+}
+
+/// @brief Reads the first message if there is any, without blocking.
+/// @param msg Where the message will be stored.
+/// @return "true" if a message was read, "false" if the queue is empty.
+template <class msg_t>
+bool ShmMpmcQueue<msg_t>::try_read(msg_t& msg) {
+    uint32_t pos = this->header->dequeue_pos.load(std::memory_order_relaxed);
+    Slot* slot;
+    int32_t diff;
+    while (true) {
+        slot = &(this->slots[pos & this->mask]);
+        diff = (int32_t) (slot->seq.load(std::memory_order_acquire) - (pos + 1));
+        if (diff == 0) {
+            // Written for this position, try to claim it.
+            if (this->header->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // Still not written: empty.
+        } else {
+            pos = this->header->dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    msg = slot->msg;
+    // Free for the writer of the same slot in the next lap.
+    slot->seq.store(pos + this->mask + 1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->header->producers_waiting.load(std::memory_order_relaxed) > 0) {
+        this->header->reads.fetch_add(1, std::memory_order_relaxed);
+        Futex::wake(&(this->header->reads), 1);
+    }
+    return true;
+}
+
+/// @brief Returns the amount of messages in the queue. With other processes
+///  using the queue, it's only an estimate.
+template <class msg_t>
+int ShmMpmcQueue<msg_t>::get_msg_qtty(void) {
+    int32_t qtty = (int32_t) (this->header->enqueue_pos.load(std::memory_order_acquire) -
+        this->header->dequeue_pos.load(std::memory_order_acquire));
+    return (qtty < 0) ? 0 : qtty;
+}
+
+/// @brief Returns the maximum amount of messages in the queue.
+template <class msg_t>
+int ShmMpmcQueue<msg_t>::get_capacity(void) {
+    return (int) this->mask + 1;
+}
+
+/// @brief Returns "true" if the queue is empty, "false" otherwise.
+template <class msg_t>
+bool ShmMpmcQueue<msg_t>::is_empty(void) {
+    return (this->get_msg_qtty() == 0);
+}
+
+/// @brief Returns "true" if there is at least one message in the queue,
+///  "false" otherwise.
+template <class msg_t>
+bool ShmMpmcQueue<msg_t>::has_msg(void) {
+    return (this->get_msg_qtty() > 0);
+}
+
+/// @brief Sleeps until the other side makes progress. The wait is announced
+///  in "waiting" before trying once more, so that either the other side sees
+///  it and bumps "word", or this try succeeds.
+/// @param waiting Counter of sleeping writers (or readers).
+/// @param word Futex word bumped by the other side when "waiting" isn't "0".
+/// @param writer "true" to retry a write of "in", "false" a read into "out".
+/// @param deadline Absolute CLOCK_MONOTONIC time to give up, or NULL.
+/// @return "1" if the last try succeeded, "0" when woken up (try again), or
+///  "-1" on error (ETIMEDOUT or EINTR).
+template <class msg_t>
+int ShmMpmcQueue<msg_t>::sleep(std::atomic<uint32_t>& waiting, std::atomic<uint32_t>& word, bool writer,
+    const msg_t* in, msg_t* out, const struct timespec* deadline) {
+    struct timespec now, timeout;
+    uint32_t value;
+    int result = 0;
+    waiting.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    value = word.load(std::memory_order_relaxed);
+    if (writer ? this->try_write(*in) : this->try_read(*out)) {
+        result = 1;
+    } else if (deadline != NULL) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        timeout.tv_sec = deadline->tv_sec - now.tv_sec;
+        timeout.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+        if (timeout.tv_nsec < 0) {
+            timeout.tv_sec--;
+            timeout.tv_nsec += 1000000000L;
+        }
+        if (timeout.tv_sec < 0) {
+            errno = ETIMEDOUT;
+            result = -1;
+        } else if (Futex::wait(&word, value, &timeout) == -1) {
+            result = -1;
+        }
+    } else if (Futex::wait(&word, value) == -1) {
+        result = -1;
+    }
+    waiting.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+}
+
+/// @brief Rounds the capacity up to a power of two, so that positions can
+///  wrap around with a mask.
+template <class msg_t>
+size_t ShmMpmcQueue<msg_t>::round_capacity(size_t capacity) {
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+/// @brief Loads "deadline" with the CLOCK_MONOTONIC time "timeout_ms"
+///  milliseconds from now.
+template <class msg_t>
+void ShmMpmcQueue<msg_t>::set_deadline(struct timespec* deadline, int timeout_ms) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/******************************************************************************
+ * Overloaded operators
+******************************************************************************/
+
+/// @brief Writes a message. Might throw "std::runtime_error".
+template <class msg_t>
+ShmMpmcQueue<msg_t>& ShmMpmcQueue<msg_t>::operator<<(const msg_t& msg) {
+    if (this->write(msg) == -1) {
+        throw(std::runtime_error("ShmMpmcQueue::operator<<"));
+    }
+    return *this;
+}
+
+/// @brief Reads the first message. Might throw "std::runtime_error".
+template <class msg_t>
+ShmMpmcQueue<msg_t>& ShmMpmcQueue<msg_t>::operator>>(msg_t& msg) {
+    int status;
+    msg = this->read(&status);
+    if (status != 0) {
+        throw(std::runtime_error("ShmMpmcQueue::operator>>"));
+    }
+    return *this;
+}
+
+#endif // SHM_MPMC_QUEUE_H
@@ -0,0 +1,399 @@
+#ifndef SHM_RCU_H
+#define SHM_RCU_H
+
+#include "shared_memory.h"
+#include "futex.h"
+#include "tools.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdexcept>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <sched.h>
+#include <time.h>
+
+// Default amount of processes (or threads) that can read a ShmRcu at once.
+#define SHM_RCU_READERS     64
+// Tag of a ShmRcu, see shm_wait_ready().
+#define SHM_RCU_MAGIC       0x20554352  // "RCU "
+
+/******************************************************************************
+ * Class definition
+******************************************************************************/
+
+/// @brief Array inside a shared memory, published as whole versions: the
+///  writer fills a copy that no reader is using, and then switches readers to
+///  it at once, so readers always see a complete version, never wait, and
+///  never copy it. Like RCU (read-copy-update) with "N" copies.
+///
+///  Every published version gets a generation number. A reader records the
+///  generation it started in, in its own slot, before picking the current
+///  copy, and clears it when done. A copy replaced at generation "g + 1" is
+///  only reused once no slot has a generation "<= g": no reader can still
+///  hold it. A slot is kept until the object is destroyed. Slots of readers
+///  that are gone (they died, or never destroyed the object) are reclaimed:
+///  by the writer if they died while reading, and by a new reader when no
+///  slot is free. Only one writer at a time (they lock each other out).
+///
+///  Each process or thread reads through its own object: the slot belongs to
+///  the object, so threads that share one would share the slot.
+template <class data_t>
+class ShmRcu {
+private:
+    struct alignas(SHM_CACHE_LINE) Reader {
+        std::atomic<pid_t> tid;             // "0" if free, "-1" if reclaimed.
+        std::atomic<uint64_t> generation;   // "0" if not reading.
+    };
+    struct Header {
+        alignas(SHM_CACHE_LINE) std::atomic<uint64_t> generation;
+        std::atomic<uint32_t> current;      // Copy with the last generation.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> writer_lock;
+        // Written once by the creator. "magic" is "0" until it's ready.
+        std::atomic<uint32_t> magic;
+        std::atomic<uint32_t> buffers;
+        uint32_t readers;
+        uint64_t size;                      // Elements of each copy.
+        uint64_t stride;                    // Bytes between copies.
+    };
+    SharedMemory<char> shm;
+    Header* header;
+    Reader* readers;
+    std::atomic<uint64_t>* generations;     // Generation of each copy.
+    char* buffers;
+    Reader* slot;                           // This reader's slot, or NULL.
+    pid_t slot_tid;
+    int target;                             // Copy being written, or "-1".
+
+    static size_t get_stride(size_t size);
+    static size_t get_length(size_t size, int buffers, int readers);
+    data_t* get_buffer(int index) const;
+    int get_slot(void);
+    bool is_free(int index);
+
+public:
+    ShmRcu(const char* path, int id, size_t size=0, int buffers=2, int readers=SHM_RCU_READERS);
+    ~ShmRcu();
+    static bool exists(const char* path, int id);
+
+    const data_t* read_lock(void);
+    void read_unlock(void);
+    int read(data_t* array, int size, int index=0);
+    data_t* write_begin(bool copy=true, int timeout_ms=-1);
+    int publish(void);
+    void abort(void);
+    int write(const data_t* elements, int size, int index=0, int timeout_ms=-1);
+    uint64_t get_generation(void) const;
+    size_t get_size(void) const;
+};
+
+/******************************************************************************
+ * Template functions
+******************************************************************************/
+
+/// @brief Creates or connects to a published array.
+/// @tparam data_t Type of the elements. They are copied byte by byte between
+///  copies, so it must be trivially copyable.
+/// @param path Any file path. Identifies it, same as SharedMemory.
+/// @param id Any number. Identifies it.
+/// @param size If > 0, it's created with copies of "size" elements, all
+///  zeroes at first. If "0", connects to an existing one (default).
+/// @param buffers Copies of the array, at least 2 (default). With more, the
+///  writer can publish again while slow readers still use older versions.
+/// @param readers Maximum processes (or threads) reading at once. Each one
+///  needs its own object.
+/// @return On error, std::runtime_error() is thrown. Also if the memory
+///  doesn't hold a ShmRcu, or its creator doesn't finish it in time.
+template <class data_t>
+ShmRcu<data_t>::ShmRcu(const char* path, int id, size_t size, int buffers, int readers):
+    shm(path, id, (size > 0) ? get_length(size, buffers, readers) : 0), slot(NULL), slot_tid(0), target(-1) {
+    static_assert(std::is_trivially_copyable<data_t>::value, "ShmRcu elements must be trivially copyable");
+    this->header = (Header*) &(this->shm[0]);
+    if (size > 0) {
+        if (buffers < 2 || readers < 1) {
+            errno = EINVAL;
+            perror(ERROR("buffers or readers in ShmRcu::ShmRcu"));
+            throw(std::runtime_error("buffers"));
+        }
+        new (this->header) Header();
+        this->header->readers = readers;
+        this->header->size = size;
+        this->header->stride = get_stride(size);
+        this->header->generation.store(1, std::memory_order_relaxed);
+    } else {
+        if (this->shm.get_size() < sizeof(Header) ||
+            shm_wait_ready(this->header->magic, SHM_RCU_MAGIC) == -1) {
+            perror(ERROR("not a ShmRcu in ShmRcu::ShmRcu"));
+            throw(std::runtime_error("magic"));
+        }
+        buffers = this->header->buffers.load(std::memory_order_relaxed);
+        readers = this->header->readers;
+    }
+    this->readers = (Reader*) (this->header + 1);
+    this->generations = (std::atomic<uint64_t>*) (this->readers + readers);
+    this->buffers = (char*) this->header +
+        get_length(0, buffers, readers) - get_stride(0) * buffers;
+    if (size > 0) {
+        for (int i = 0; i < readers; i++) {
+            new (&(this->readers[i])) Reader();
+        }
+        for (int i = 0; i < buffers; i++) {
+            new (&(this->generations[i])) std::atomic<uint64_t>(0);
+        }
+        this->generations[0].store(1, std::memory_order_relaxed);
+        this->header->buffers.store(buffers, std::memory_order_relaxed);
+        this->header->magic.store(SHM_RCU_MAGIC, std::memory_order_release);
+    }
+}
+
+/// @brief Frees this reader's slot, and drops an unpublished write.
+template <class data_t>
+ShmRcu<data_t>::~ShmRcu() {
+    if (this->slot != NULL && this->slot_tid == gettid()) {
+        this->slot->generation.store(0, std::memory_order_release);
+        this->slot->tid.store(0, std::memory_order_release);
+    }
+    this->abort();
+}
+
+/// @brief Checks if it exists.
+/// @return "true" if it exists, "false" otherwise.
+template <class data_t>
+bool ShmRcu<data_t>::exists(const char* path, int id) {
+    return SharedMemory<char>::exists(path, id);
+}
+
+/// @brief Starts reading the last published version. It stays the same, even
+///  if newer ones are published, until ShmRcu::read_unlock(). Doesn't wait.
+/// @return The elements of the version, or NULL if every reader slot is taken
+///  (errno EAGAIN).
+template <class data_t>
+const data_t* ShmRcu<data_t>::read_lock(void) {
+    if (this->get_slot() == -1) {
+        return NULL;
+    }
+    // The writer publishes, and then checks the slots. This reader sets its
+    // slot, and then looks for the current copy. Sequentially consistent, so
+    // either the writer sees the slot, or the reader sees the new copy.
+    this->slot->generation.store(this->header->generation.load(std::memory_order_acquire),
+                                 std::memory_order_seq_cst);
+    return this->get_buffer(this->header->current.load(std::memory_order_seq_cst));
+}
+
+/// @brief Ends a read started with ShmRcu::read_lock(). The version can't be
+///  used afterwards.
+template <class data_t>
+void ShmRcu<data_t>::read_unlock(void) {
+    if (this->slot != NULL) {
+        this->slot->generation.store(0, std::memory_order_release);
+    }
+}
+
+/// @brief Copies elements of the last published version.
+/// @return "0" on success, "-1" on error (ERANGE if they are out of the
+///  array, EAGAIN if every reader slot is taken).
+template <class data_t>
+int ShmRcu<data_t>::read(data_t* array, int size, int index) {
+    const data_t* version;
+    if (index < 0 || size < 0 || (uint64_t) index + size > this->header->size) {
+        errno = ERANGE;
+        return -1;
+    }
+    if ( (version = this->read_lock()) == NULL) {
+        return -1;
+    }
+    memcpy((void*) array, (const void*) (version + index), size * sizeof(data_t));
+    this->read_unlock();
+    return 0;
+}
+
+/// @brief Starts writing a new version, in a copy no reader uses. Readers keep
+///  seeing the last published one until ShmRcu::publish().
+/// @param copy If "true", the copy starts as the last published version, so
+///  only the changes need to be written. If "false", it has stale contents.
+/// @param timeout_ms Maximum time to wait for readers to leave the copy, in
+///  milliseconds. If negative, waits forever (default).
+/// @return The elements to write, or NULL on error (ETIMEDOUT).
+template <class data_t>
+data_t* ShmRcu<data_t>::write_begin(bool copy, int timeout_ms) {
+    int buffers = this->header->buffers.load(std::memory_order_relaxed);
+    uint32_t current;
+    struct timespec start, now;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    }
+    this->abort();
+    Futex::lock(this->header->writer_lock);
+    current = this->header->current.load(std::memory_order_relaxed);
+    // The oldest copy is the one readers are least likely to still use.
+    this->target = (current + 1) % buffers;
+    for (int i = 0; i < buffers; i++) {
+        if (i != (int) current && this->generations[i].load(std::memory_order_relaxed) <
+            this->generations[this->target].load(std::memory_order_relaxed)) {
+            this->target = i;
+        }
+    }
+    while (!this->is_free(this->target)) {
+        if (timeout_ms >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 >= timeout_ms) {
+                this->abort();
+                errno = ETIMEDOUT;
+                return NULL;
+            }
+        }
+        sched_yield();
+    }
+    if (copy) {
+        memcpy((void*) this->get_buffer(this->target), (const void*) this->get_buffer(current),
+               this->header->size * sizeof(data_t));
+    }
+    return this->get_buffer(this->target);
+}
+
+/// @brief Publishes the version written since ShmRcu::write_begin(). Readers
+///  that start from now on see it.
+/// @return "0" on success, "-1" if no write was started (errno EINVAL).
+template <class data_t>
+int ShmRcu<data_t>::publish(void) {
+    uint64_t generation;
+    if (this->target == -1) {
+        errno = EINVAL;
+        return -1;
+    }
+    generation = this->header->generation.load(std::memory_order_relaxed) + 1;
+    this->generations[this->target].store(generation, std::memory_order_relaxed);
+    this->header->current.store(this->target, std::memory_order_seq_cst);
+    this->header->generation.store(generation, std::memory_order_seq_cst);
+    this->target = -1;
+    Futex::unlock(this->header->writer_lock);
+    return 0;
+}
+
+/// @brief Drops the version written since ShmRcu::write_begin(), if any.
+template <class data_t>
+void ShmRcu<data_t>::abort(void) {
+    if (this->target != -1) {
+        this->target = -1;
+        Futex::unlock(this->header->writer_lock);
+    }
+}
+
+/// @brief Publishes a new version, equal to the last one except for "size"
+///  elements from "index".
+/// @return "0" on success, "-1" on error (ERANGE if they are out of the
+///  array, ETIMEDOUT).
+template <class data_t>
+int ShmRcu<data_t>::write(const data_t* elements, int size, int index, int timeout_ms) {
+    data_t* version;
+    if (index < 0 || size < 0 || (uint64_t) index + size > this->header->size) {
+        errno = ERANGE;
+        return -1;
+    }
+    if ( (version = this->write_begin(true, timeout_ms)) == NULL) {
+        return -1;
+    }
+    memcpy((void*) (version + index), (const void*) elements, size * sizeof(data_t));
+    return this->publish();
+}
+
+/// @brief Returns the generation of the last published version. It starts at
+///  "1", and grows by one with every ShmRcu::publish().
+template <class data_t>
+uint64_t ShmRcu<data_t>::get_generation(void) const {
+    return this->header->generation.load(std::memory_order_acquire);
+}
+
+/// @brief Returns the amount of elements of each version.
+template <class data_t>
+size_t ShmRcu<data_t>::get_size(void) const {
+    return this->header->size;
+}
+
+/******************************************************************************
+ * Private functions
+******************************************************************************/
+
+/// @brief Bytes taken by each copy of "size" elements, rounded up to a cache
+///  line.
+template <class data_t>
+size_t ShmRcu<data_t>::get_stride(size_t size) {
+    return (size * sizeof(data_t) + SHM_CACHE_LINE - 1) / SHM_CACHE_LINE * SHM_CACHE_LINE;
+}
+
+/// @brief Bytes of the shared memory: header, reader slots, generation of
+///  each copy, and the copies.
+template <class data_t>
+size_t ShmRcu<data_t>::get_length(size_t size, int buffers, int readers) {
+    size_t generations = buffers * sizeof(std::atomic<uint64_t>);
+    generations = (generations + SHM_CACHE_LINE - 1) / SHM_CACHE_LINE * SHM_CACHE_LINE;
+    return sizeof(Header) + readers * sizeof(Reader) + generations + buffers * get_stride(size);
+}
+
+/// @brief Returns the elements of a copy.
+template <class data_t>
+data_t* ShmRcu<data_t>::get_buffer(int index) const {
+    return (data_t*) (this->buffers + index * this->header->stride);
+}
+
+/// @brief Takes a reader slot for this process or thread, if it doesn't have
+///  one yet. A forked child takes its own. If every slot is taken, the first
+///  one whose process or thread is gone is reclaimed.
+/// @return "0" on success, "-1" if all of them are in use (errno EAGAIN).
+template <class data_t>
+int ShmRcu<data_t>::get_slot(void) {
+    pid_t tid = gettid();
+    if (this->slot != NULL && this->slot_tid == tid) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < this->header->readers; i++) {
+        pid_t free_slot = 0;
+        if (this->readers[i].tid.compare_exchange_strong(free_slot, tid, std::memory_order_acquire)) {
+            this->slot = &(this->readers[i]);
+            this->slot_tid = tid;
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < this->header->readers; i++) {
+        pid_t owner = this->readers[i].tid.load(std::memory_order_relaxed);
+        if (owner > 0 && kill(owner, 0) == -1 && errno == ESRCH &&
+            this->readers[i].tid.compare_exchange_strong(owner, tid, std::memory_order_acquire)) {
+            // It may have died while reading.
+            this->readers[i].generation.store(0, std::memory_order_relaxed);
+            this->slot = &(this->readers[i]);
+            this->slot_tid = tid;
+            return 0;
+        }
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+/// @brief Checks if no reader can be using a copy: every reader that could
+///  have picked it (whose generation is older than the copy's replacement)
+///  finished. Slots of readers that died are freed on the way.
+template <class data_t>
+bool ShmRcu<data_t>::is_free(int index) {
+    uint64_t replaced = this->generations[index].load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < this->header->readers; i++) {
+        uint64_t generation = this->readers[i].generation.load(std::memory_order_seq_cst);
+        if (generation == 0 || generation > replaced) {
+            continue;
+        }
+        // Readers reclaim dead slots too: mark it first, so that the one
+        // that takes it isn't cleared here.
+        pid_t tid = this->readers[i].tid.load(std::memory_order_relaxed);
+        if (tid > 0 && kill(tid, 0) == -1 && errno == ESRCH &&
+            this->readers[i].tid.compare_exchange_strong(tid, -1, std::memory_order_acquire)) {
+            this->readers[i].generation.store(0, std::memory_order_relaxed);
+            this->readers[i].tid.store(0, std::memory_order_release);
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+#endif // SHM_RCU_H
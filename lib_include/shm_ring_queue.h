@@ -0,0 +1,266 @@
+#ifndef SHM_RING_QUEUE_H
+#define SHM_RING_QUEUE_H
+
+#include "shared_memory.h"
+#include "futex.h"
+#include "tools.h"
+#include <stdint.h>
+#include <stdexcept>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <sched.h>
+
+// Times a blocked read or write polls the queue before sleeping on a futex.
+#define SHM_RING_SPIN   128
+// Tag of a ShmRingQueue, see shm_wait_ready().
+#define SHM_RING_MAGIC  0x474e4952  // "RING"
+
+/******************************************************************************
+ * Class definition
+******************************************************************************/
+
+/// @brief Single producer, single consumer queue inside a shared memory. It
+///  has the same interface as MsgQueue, but messages are copied straight into
+///  a ring of slots, without syscalls. A process only sleeps (on a futex) when
+///  the queue is empty for a reader, or full for a writer.
+template <class msg_t>
+class ShmRingQueue {
+private:
+    struct Header {
+        // Written by the producer.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> tail;
+        std::atomic<uint32_t> consumer_waiting;
+        // Written by the consumer.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> head;
+        std::atomic<uint32_t> producer_waiting;
+        // Written once by the creator. "magic" is "0" until the queue is ready.
+        alignas(SHM_CACHE_LINE) std::atomic<uint32_t> magic;
+        std::atomic<uint32_t> capacity;
+    };
+    SharedMemory<char> shm;
+    Header* header;
+    msg_t* slots;
+    uint32_t mask;
+    // Last index of the other side seen by this process, to avoid reading
+    // its cache line on every operation.
+    uint32_t cached_head, cached_tail;
+
+    static size_t round_capacity(size_t capacity);
+
+public:
+    ShmRingQueue(const char* path, int id, size_t capacity=0);
+    static bool exists(const char* path, int id);
+
+    int write(const msg_t& msg);
+    bool try_write(const msg_t& msg);
+    msg_t read(int* status=NULL);
+    bool try_read(msg_t& msg);
+    int get_msg_qtty(void);
+    int get_capacity(void);
+    bool is_empty(void);
+    bool has_msg(void);
+    ShmRingQueue& operator<<(const msg_t& msg);
+    ShmRingQueue& operator>>(msg_t& msg);
+};
+
+/******************************************************************************
+ * Template functions
+******************************************************************************/
+
+/// @brief Creates or connects to a queue.
+/// @tparam msg_t Type of the message. It's copied byte by byte between
+///  processes, so it must be trivially copyable (no pointers to the own
+///  process memory, no virtual functions, etc).
+/// @param path Any file path. Identifies the queue, same as SharedMemory.
+/// @param id Any number. Identifies the queue.
+/// @param capacity If > 0, the queue is created with room for at least that
+///  many messages (rounded up to a power of two). If "0", connects to an
+///  already existing queue (default).
+/// @return On error, std::runtime_error() is thrown. Also if the memory
+///  doesn't hold a queue, or its creator doesn't finish it in time (see
+///  shm_wait_ready()).
+template <class msg_t>
+ShmRingQueue<msg_t>::ShmRingQueue(const char* path, int id, size_t capacity):
+    shm(path, id, (capacity > 0) ? sizeof(Header) + round_capacity(capacity) * sizeof(msg_t) : 0) {
+    static_assert(std::is_trivially_copyable<msg_t>::value, "ShmRingQueue messages must be trivially copyable");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2, "ShmRingQueue needs lock free atomics");
+    this->header = (Header*) &(this->shm[0]);
+    this->slots = (msg_t*) (this->header + 1);
+    if (capacity > 0) {
+        new (this->header) Header();
+        this->header->capacity.store(round_capacity(capacity), std::memory_order_relaxed);
+        this->header->magic.store(SHM_RING_MAGIC, std::memory_order_release);
+    } else if (this->shm.get_size() < sizeof(Header) ||
+               shm_wait_ready(this->header->magic, SHM_RING_MAGIC) == -1) {
+        perror(ERROR("not a queue in ShmRingQueue::ShmRingQueue"));
+        throw(std::runtime_error("magic"));
+    }
+    this->mask = this->header->capacity.load(std::memory_order_relaxed) - 1;
+    this->cached_head = this->header->head.load(std::memory_order_acquire);
+    this->cached_tail = this->header->tail.load(std::memory_order_acquire);
+}
+
+/// @brief Checks if the queue exists.
+/// @return "true" if it exists, "false" otherwise.
+template <class msg_t>
+bool ShmRingQueue<msg_t>::exists(const char* path, int id) {
+    return SharedMemory<char>::exists(path, id);
+}
+
+/// @brief Writes a message, waiting while the queue is full. Only one
+///  process (or thread) can write to the queue.
+/// @param msg Message to be written.
+/// @return "0" on success, "-1" if interrupted by a signal while waiting.
+template <class msg_t>
+int ShmRingQueue<msg_t>::write(const msg_t& msg) {
+    uint32_t head;
+    int spin = 0;
+    while (!this->try_write(msg)) {
+        if (spin++ < SHM_RING_SPIN) {
+            continue;
+        }
+        // Announce the wait, and check again before sleeping. Either the
+        // consumer sees the flag, or this process sees the new head.
+        this->header->producer_waiting.store(1, std::memory_order_seq_cst);
+        head = this->header->tail.load(std::memory_order_relaxed) - this->mask - 1;
+        if (this->header->head.load(std::memory_order_seq_cst) == head &&
+            Futex::wait(&(this->header->head), head) == -1 && errno == EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Writes a message if there is room for it, without blocking.
+/// @return "true" if it was written, "false" if the queue is full.
+template <class msg_t>
+bool ShmRingQueue<msg_t>::try_write(const msg_t& msg) {
+    uint32_t tail = this->header->tail.load(std::memory_order_relaxed);
+    if (tail - this->cached_head > this->mask) {
+        this->cached_head = this->header->head.load(std::memory_order_acquire);
+        if (tail - this->cached_head > this->mask) {
+            return false;
+        }
+    }
+    this->slots[tail & this->mask] = msg;
+    this->header->tail.store(tail + 1, std::memory_order_seq_cst);
+    if (this->header->consumer_waiting.load(std::memory_order_seq_cst)) {
+        this->header->consumer_waiting.store(0, std::memory_order_relaxed);
+        Futex::wake(&(this->header->tail));
+    }
+    return true;
+}
+
+/// @brief Reads the first message, waiting while the queue is empty. Only one
+///  process (or thread) can read from the queue.
+/// @param status If not NULL, it will be loaded with a "0" on success, or with
+///  EINTR if interrupted by a signal while waiting.
+/// @return The message read. Junk if "status" is not "0".
+template <class msg_t>
+msg_t ShmRingQueue<msg_t>::read(int* status) {
+    msg_t msg;
+    uint32_t head;
+    int spin = 0;
+    int error_state = 0;
+    while (!this->try_read(msg)) {
+        if (spin++ < SHM_RING_SPIN) {
+            continue;
+        }
+        this->header->consumer_waiting.store(1, std::memory_order_seq_cst);
+        head = this->header->head.load(std::memory_order_relaxed);
+        if (this->header->tail.load(std::memory_order_seq_cst) == head &&
+            Futex::wait(&(this->header->tail), head) == -1 && errno == EINTR) {
+            error_state = EINTR;
+            break;
+        }
+    }
+    if (status != NULL) {
+        *status = error_state;
+    }
+    return msg;
+}
+
+/// @brief Reads the first message if there is any, without blocking.
+/// @param msg Where the message will be stored.
+/// @return "true" if a message was read, "false" if the queue is empty.
+template <class msg_t>
+bool ShmRingQueue<msg_t>::try_read(msg_t& msg) {
+    uint32_t head = this->header->head.load(std::memory_order_relaxed);
+    if (head == this->cached_tail) {
+        this->cached_tail = this->header->tail.load(std::memory_order_acquire);
+        if (head == this->cached_tail) {
+            return false;
+        }
+    }
+    msg = this->slots[head & this->mask];
+    this->header->head.store(head + 1, std::memory_order_seq_cst);
+    if (this->header->producer_waiting.load(std::memory_order_seq_cst)) {
+        this->header->producer_waiting.store(0, std::memory_order_relaxed);
+        Futex::wake(&(this->header->head));
+    }
+    return true;
+}
+
+/// @brief Returns the amount of messages in the queue.
+template <class msg_t>
+int ShmRingQueue<msg_t>::get_msg_qtty(void) {
+    return (int) (this->header->tail.load(std::memory_order_acquire) -
+        this->header->head.load(std::memory_order_acquire));
+}
+
+/// @brief Returns the maximum amount of messages in the queue.
+template <class msg_t>
+int ShmRingQueue<msg_t>::get_capacity(void) {
+    return (int) this->mask + 1;
+}
+
+/// @brief Returns "true" if the queue is empty, "false" otherwise.
+template <class msg_t>
+bool ShmRingQueue<msg_t>::is_empty(void) {
+    return (this->get_msg_qtty() == 0);
+}
+
+/// @brief Returns "true" if there is at least one message in the queue,
+///  "false" otherwise.
+template <class msg_t>
+bool ShmRingQueue<msg_t>::has_msg(void) {
+    return (this->get_msg_qtty() > 0);
+}
+
+/// @brief Rounds the capacity up to a power of two, so that indices can
+///  wrap around with a mask.
+template <class msg_t>
+size_t ShmRingQueue<msg_t>::round_capacity(size_t capacity) {
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+/******************************************************************************
+ * Overloaded operators
+******************************************************************************/
+
+/// @brief Writes a message. Might throw "std::runtime_error".
+template <class msg_t>
+ShmRingQueue<msg_t>& ShmRingQueue<msg_t>::operator<<(const msg_t& msg) {
+    if (this->write(msg) == -1) {
+        throw(std::runtime_error("ShmRingQueue::operator<<"));
+    }
+    return *this;
+}
+
+/// @brief Reads the first message. Might throw "std::runtime_error".
+template <class msg_t>
+ShmRingQueue<msg_t>& ShmRingQueue<msg_t>::operator>>(msg_t& msg) {
+    int status;
+    msg = this->read(&status);
+    if (status != 0) {
+        throw(std::runtime_error("ShmRingQueue::operator>>"));
+    }
+    return *this;
+}
+
+#endif // SHM_RING_QUEUE_H
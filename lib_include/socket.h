@@ -3,6 +3,10 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <poll.h>
+#include <signal.h>
 #include <netdb.h>
 #include <string.h>
 #include <stdio.h>
@@ -11,9 +15,34 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <linux/errqueue.h>
+#include <deque>
+#include <memory>
+
+// Datagrams moved per syscall by Socket::write_batch() and Socket::read_batch().
+#define SOCKET_BATCH_MAX    64
+// Bytes moved per splice() call by Socket::proxy().
+#define SOCKET_SPLICE_SIZE  65536
+
+/// @brief Called when a buffer sent with Socket::write_zerocopy() can be
+///  reused. "copied" is "true" if the kernel had to copy it anyway.
+typedef void (*zerocopy_callback)(const void* buf, int len, bool copied, void* arg);
 
 class Socket {
 private:
+    /// @brief Buffer lent to the kernel by Socket::write_zerocopy().
+    struct ZeroCopyBuffer {
+        const void* buf;
+        int len;
+        uint32_t first_id, last_id;
+        uint32_t remaining;     // Notification ids not completed yet.
+        bool copied;
+        zerocopy_callback callback;
+        void* arg;
+    };
     int sockfd;
     char my_ip [INET6_ADDRSTRLEN], peer_ip [INET6_ADDRSTRLEN];
     int my_port, peer_port;
@@ -21,18 +50,37 @@ private:
     int get_port_from_sockfd(int sockfd);
     int get_ip_from_sockaddr(char* ip, struct sockaddr* sa);
     int get_port_from_sockaddr(struct sockaddr* sa);
+    static void block_sigpipe(sigset_t* mask, sigset_t* old_mask);
+    static void restore_sigpipe(sigset_t* mask, sigset_t* old_mask);
+    int complete_zerocopy(uint32_t lo, uint32_t hi, bool copied);
+    // Zero-copy sends waiting for their completion notification. Only
+    // allocated by Socket::set_zerocopy(), so other sockets don't pay for it.
+    std::unique_ptr<std::deque<ZeroCopyBuffer>> zc_pending;
+    uint32_t zc_next_id = 0;
 
 public:
-    Socket(const char* ip, const char* port, int family=AF_UNSPEC, int socktype=SOCK_STREAM, bool server=false);
+    Socket(const char* ip, const char* port, int family=AF_UNSPEC, int socktype=SOCK_STREAM, bool server=false, bool reuseport=false);
     Socket(const Socket& socket);
+    Socket& operator=(const Socket& socket);
     Socket();
     int init (int sockfd, struct sockaddr* addr);
     static bool is_listening(const char* ip, const char* port, int family=AF_UNSPEC, int socktype=SOCK_STREAM);
     void close(void);
     ~Socket();
+    int set_nonblocking(bool enable=true);
 
     int write(void* msg, int len, int flags=0);
     int read(void* msg, int len, int flags=0);
+    int writev(const struct iovec* iov, int iovcnt, int flags=0);
+    int readv(const struct iovec* iov, int iovcnt, int flags=0);
+    int write_batch(const struct iovec* datagrams, int count, const struct sockaddr_storage* addrs=NULL, int flags=0);
+    int read_batch(struct iovec* datagrams, int count, struct sockaddr_storage* addrs=NULL, int flags=0);
+    ssize_t send_file(int fd, off_t offset, size_t len);
+    static ssize_t proxy(Socket& a, Socket& b);
+    int set_zerocopy(bool enable=true);
+    int write_zerocopy(const void* msg, int len, zerocopy_callback callback=NULL, void* arg=NULL);
+    int reap_zerocopy(int timeout_ms=0);
+    int get_zerocopy_pending(void) const;
 
     int get_sockfd(void) const;
     void get_peer_ip(char* ip) const;
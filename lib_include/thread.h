@@ -2,6 +2,7 @@
 #define THREAD_H
 
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include "tools.h"
 #include "sig.h"
@@ -18,6 +19,7 @@ public:
   int detach(void);
   int create (void* (*run)(void*), void* args=NULL, bool detached=false);
   int send_signal(int signal);
+  int set_affinity(int cpu);
 };
 
 #endif //THREAD_H
\ No newline at end of file
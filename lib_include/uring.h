@@ -0,0 +1,68 @@
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <stdint.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "tools.h"
+#include <stdexcept>
+#include <unistd.h>
+#include <errno.h>
+
+// Buffer group used for the provided buffers (see Uring::set_buffers()).
+#define URING_BUFFER_GROUP 0
+
+/// @brief Minimal "io_uring" engine, without depending on "liburing".
+///  Operations are queued with Uring::accept(), Uring::recv() and
+///  Uring::send(), and they are all submitted together with a single call to
+///  Uring::submit(), which also waits for completions. Completions are
+///  collected with Uring::get_completions(). Received data is stored in a
+///  ring of buffers provided to the kernel (see Uring::set_buffers()).
+class Uring {
+private:
+    int ring_fd;
+    unsigned to_submit;
+    // Submission queue.
+    void* sq_ring;
+    size_t sq_ring_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    // Completion queue.
+    void* cq_ring;
+    size_t cq_ring_size;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe* cqes;
+    // Provided buffers. The ring tail overlays the "resv" field of the first
+    // entry ("struct io_uring_buf_ring" can't be used from C++).
+    struct io_uring_buf* buf_ring;
+    size_t buf_ring_size;
+    char* buffers;
+    unsigned buf_count, buf_size;
+
+    struct io_uring_sqe* get_sqe(void);
+
+public:
+    Uring(unsigned entries=256);
+    ~Uring();
+    static bool is_supported(void);
+
+    int set_buffers(unsigned count, unsigned size);
+    char* get_buffer(unsigned short id);
+    void recycle_buffer(unsigned short id);
+
+    int accept(int sockfd, uint64_t data, bool multishot=true);
+    int recv(int sockfd, uint64_t data, bool multishot=true);
+    int send(int sockfd, const void* buf, unsigned len, uint64_t data);
+    int submit(unsigned wait_nr=0, const sigset_t* mask=NULL);
+    int get_completions(struct io_uring_cqe* cqes, int max);
+};
+
+#endif // URING_H
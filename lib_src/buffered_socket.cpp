@@ -0,0 +1,351 @@
+#include "buffered_socket.h"
+
+/******************************************************************************
+ * Constructors and initialization
+******************************************************************************/
+
+/// @brief Adds buffering to an already connected stream socket.
+/// @param socket Connected socket. It must outlive this object.
+/// @param buffer_size Capacity of each ring buffer (send and receive). It's
+///  also the largest view that can be obtained with BufferedSocket::peek().
+/// @param flush_size Buffered bytes that trigger a flush. If "0", the send
+///  buffer is only flushed when full.
+/// @param flush_us Age, in microseconds, of the oldest buffered byte that
+///  triggers a flush. It's checked on every write. If negative, disabled.
+/// @return On error, std::runtime_error() is thrown (a "buffer_size" of "0").
+BufferedSocket::BufferedSocket(Socket& socket, size_t buffer_size, size_t flush_size, long flush_us):
+    socket(socket), rx(buffer_size), tx(buffer_size),
+    flush_size( (flush_size == 0 || flush_size > buffer_size) ? buffer_size : flush_size),
+    flush_us(flush_us) {
+    if (buffer_size == 0) {
+        errno = EINVAL;
+        perror(ERROR("buffer_size in BufferedSocket::BufferedSocket"));
+        throw(std::runtime_error("buffer_size"));
+    }
+}
+
+/// @brief Sends any data left in the send buffer.
+BufferedSocket::~BufferedSocket() {
+    if (this->tx.len > 0) {
+        this->flush();
+    }
+}
+
+/******************************************************************************
+ * Writing
+******************************************************************************/
+
+/// @brief Appends data to the send buffer. It's flushed if the size or the
+///  time threshold is reached. Data larger than the buffer is sent directly,
+///  after flushing what was buffered before it.
+/// @param data Data to send.
+/// @param len Length of the data.
+/// @return "len" on success, "-1" on error.
+int BufferedSocket::write(const void* data, int len) {
+    struct timespec now;
+    if (len <= 0) {
+        return 0;
+    }
+    if ((size_t) len > this->tx.size() - this->tx.len && this->flush() == -1) {
+        return -1;
+    }
+    if ((size_t) len > this->tx.size()) {
+        return this->socket.write((void*) data, len);
+    }
+    if (this->tx.len == 0 && this->flush_us >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &(this->first_write));
+    }
+    this->tx.push(data, len);
+    if (this->tx.len >= this->flush_size) {
+        return (this->flush() == -1) ? -1 : len;
+    }
+    if (this->flush_us >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((now.tv_sec - this->first_write.tv_sec) * 1000000L +
+            (now.tv_nsec - this->first_write.tv_nsec) / 1000 >= this->flush_us) {
+            return (this->flush() == -1) ? -1 : len;
+        }
+    }
+    return len;
+}
+
+/// @brief Sends everything in the send buffer, with a single syscall unless
+///  the socket accepts only part of it.
+/// @return "0" on success, "-1" on error. If the socket is non blocking and
+///  it would block, the rest is kept in the buffer and errno is EAGAIN.
+int BufferedSocket::flush(void) {
+    struct iovec iov[2];
+    int bytes_sent;
+    if (this->tx.len == 0) {
+        return 0;
+    }
+    if ( (bytes_sent = this->socket.writev(iov, this->tx.used_iov(iov))) == -1) {
+        return -1;
+    }
+    this->tx.consume(bytes_sent);
+    if (this->tx.len > 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return 0;
+}
+
+/******************************************************************************
+ * Reading
+******************************************************************************/
+
+/// @brief Reads whatever is buffered, up to "len" bytes. The socket is only
+///  read if the receive buffer is empty.
+/// @param data Where the data will be stored.
+/// @param len Size of "data".
+/// @return Number of bytes read, "0" if the peer closed the connection, or
+///  "-1" on error.
+int BufferedSocket::read(void* data, int len) {
+    int bytes_read;
+    if (this->rx.len == 0 && (bytes_read = this->fill()) <= 0) {
+        return bytes_read;
+    }
+    bytes_read = std::min((size_t) len, this->rx.len);
+    this->rx.pop(data, bytes_read);
+    return bytes_read;
+}
+
+/// @brief Reads exactly "len" bytes, waiting for them if needed.
+/// @param data Where the data will be stored.
+/// @param len Number of bytes to read.
+/// @return "len" on success, "0" if the peer closed the connection before
+///  "len" bytes arrived, or "-1" on error.
+int BufferedSocket::read_exact(void* data, int len) {
+    int total = 0, bytes_read;
+    while (total < len) {
+        if ( (bytes_read = this->read((char*) data + total, len - total)) <= 0) {
+            return bytes_read;
+        }
+        total += bytes_read;
+    }
+    return total;
+}
+
+/// @brief Reads up to and including the first occurrence of "delimiter".
+/// @param delimiter Character that ends the data, for example '\n' or '\0'.
+/// @param data Where the data will be stored.
+/// @param max_len Size of "data". If the data is larger, nothing is consumed,
+///  and "-1" is returned with errno set to EMSGSIZE.
+/// @return Number of bytes read, including the delimiter, "0" if the peer
+///  closed the connection, or "-1" on error.
+int BufferedSocket::read_until(char delimiter, void* data, int max_len) {
+    const char* view;
+    int len;
+    if ( (len = this->peek_until(delimiter, &view)) <= 0) {
+        return len;
+    }
+    if (len > max_len) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    memcpy(data, view, len);
+    this->rx.consume(len);
+    return len;
+}
+
+/// @brief Gives access to the next "len" bytes without copying them out of
+///  the receive buffer. They must be released with BufferedSocket::consume().
+/// @param view Where the pointer to the data will be stored. It's valid until
+///  the next call to any read method.
+/// @param len Number of bytes. It can't be larger than the buffer size.
+/// @return "len" on success, "0" if the peer closed the connection before
+///  "len" bytes arrived, or "-1" on error.
+int BufferedSocket::peek(const char** view, int len) {
+    int bytes_read;
+    if ((size_t) len > this->rx.size()) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    while (this->rx.len < (size_t) len) {
+        if ( (bytes_read = this->fill()) <= 0) {
+            return bytes_read;
+        }
+    }
+    *view = this->rx.linearize(len);
+    return len;
+}
+
+/// @brief Same as BufferedSocket::peek(), but the view goes up to and
+///  including the first occurrence of "delimiter".
+/// @param delimiter Character that ends the data.
+/// @param view Where the pointer to the data will be stored.
+/// @return Length of the view, "0" if the peer closed the connection, or "-1"
+///  on error (ENOBUFS if the buffer is full and has no delimiter).
+int BufferedSocket::peek_until(char delimiter, const char** view) {
+    size_t searched = 0;
+    int bytes_read;
+    while (true) {
+        for (; searched < this->rx.len; searched++) {
+            if (this->rx.data[(this->rx.head + searched) % this->rx.size()] == delimiter) {
+                *view = this->rx.linearize(searched + 1);
+                return searched + 1;
+            }
+        }
+        if (this->rx.len == this->rx.size()) {
+            errno = ENOBUFS;
+            return -1;
+        }
+        if ( (bytes_read = this->fill()) <= 0) {
+            return bytes_read;
+        }
+    }
+}
+
+/// @brief Releases data obtained through a view.
+/// @param len Number of bytes to drop from the receive buffer.
+void BufferedSocket::consume(int len) {
+    this->rx.consume(std::min((size_t) len, this->rx.len));
+}
+
+/// @brief Number of bytes that can be read without a syscall.
+int BufferedSocket::available(void) const {
+    return this->rx.len;
+}
+
+/******************************************************************************
+ * Getters
+******************************************************************************/
+
+/// @brief Returns the underlying socket.
+Socket& BufferedSocket::get_socket(void) {
+    return this->socket;
+}
+
+/******************************************************************************
+ *  Overloaded operators
+******************************************************************************/
+
+BufferedSocket& BufferedSocket::operator<< (int a) {
+    if (this->write(&a, sizeof(int)) == -1) {
+        throw(std::runtime_error(""));
+    }
+    return *this;
+}
+
+BufferedSocket& BufferedSocket::operator<< (const char* a) {
+    if (this->write(a, strlen(a) + 1) == -1) {
+        throw(std::runtime_error(""));
+    }
+    return *this;
+}
+
+BufferedSocket& BufferedSocket::operator<< (char a) {
+    if (this->write(&a, sizeof(char)) == -1) {
+        throw(std::runtime_error(""));
+    }
+    return *this;
+}
+
+BufferedSocket& BufferedSocket::operator>> (int &a) {
+    if (this->read_exact(&a, sizeof(int)) <= 0) {
+        throw(std::runtime_error(""));
+    }
+    return *this;
+}
+
+BufferedSocket& BufferedSocket::operator>> (char &a) {
+    if (this->read_exact(&a, sizeof(char)) <= 0) {
+        throw(std::runtime_error(""));
+    }
+    return *this;
+}
+
+/******************************************************************************
+ * Private methods
+******************************************************************************/
+
+/// @brief Reads from the socket into the free space of the receive buffer,
+///  with a single syscall. Pending writes are flushed first.
+/// @return Number of bytes read, "0" if the peer closed the connection, or
+///  "-1" on error.
+int BufferedSocket::fill(void) {
+    struct iovec iov[2];
+    int iovcnt, bytes_read;
+    if (this->tx.len > 0 && this->flush() == -1) {
+        return -1;
+    }
+    if ( (iovcnt = this->rx.free_iov(iov)) == 0) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    if ( (bytes_read = this->socket.readv(iov, iovcnt)) > 0) {
+        this->rx.len += bytes_read;
+    }
+    return bytes_read;
+}
+
+/// @brief Describes the used part of the ring (at most two chunks).
+/// @return Number of iovecs filled.
+int BufferedSocket::Ring::used_iov(struct iovec* iov) {
+    size_t first = std::min(this->len, this->size() - this->head);
+    if (this->len == 0) {
+        return 0;
+    }
+    iov[0].iov_base = this->data.data() + this->head;
+    iov[0].iov_len = first;
+    if (this->len == first) {
+        return 1;
+    }
+    iov[1].iov_base = this->data.data();
+    iov[1].iov_len = this->len - first;
+    return 2;
+}
+
+/// @brief Describes the free part of the ring (at most two chunks).
+/// @return Number of iovecs filled.
+int BufferedSocket::Ring::free_iov(struct iovec* iov) {
+    size_t tail = (this->head + this->len) % this->size();
+    size_t room = this->size() - this->len;
+    size_t first = std::min(room, this->size() - tail);
+    if (room == 0) {
+        return 0;
+    }
+    iov[0].iov_base = this->data.data() + tail;
+    iov[0].iov_len = first;
+    if (room == first) {
+        return 1;
+    }
+    iov[1].iov_base = this->data.data();
+    iov[1].iov_len = room - first;
+    return 2;
+}
+
+/// @brief Appends data. There must be room for it.
+void BufferedSocket::Ring::push(const void* src, size_t len) {
+    size_t tail = (this->head + this->len) % this->size();
+    size_t first = std::min(len, this->size() - tail);
+    memcpy(this->data.data() + tail, src, first);
+    memcpy(this->data.data(), (const char*) src + first, len - first);
+    this->len += len;
+}
+
+/// @brief Removes data from the front. There must be at least "len" bytes.
+void BufferedSocket::Ring::pop(void* dst, size_t len) {
+    size_t first = std::min(len, this->size() - this->head);
+    memcpy(dst, this->data.data() + this->head, first);
+    memcpy((char*) dst + first, this->data.data(), len - first);
+    this->consume(len);
+}
+
+/// @brief Makes the first "len" bytes contiguous, rotating the ring if they
+///  wrap around its end.
+/// @return Pointer to the first byte.
+const char* BufferedSocket::Ring::linearize(size_t len) {
+    if (this->head + len > this->size()) {
+        std::rotate(this->data.begin(), this->data.begin() + this->head, this->data.end());
+        this->head = 0;
+    }
+    return this->data.data() + this->head;
+}
+
+/// @brief Drops "len" bytes from the front.
+void BufferedSocket::Ring::consume(size_t len) {
+    this->len -= len;
+    // Start over when empty, so that data is less likely to wrap around.
+    this->head = (this->len == 0) ? 0 : (this->head + len) % this->size();
+}
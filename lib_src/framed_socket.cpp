@@ -0,0 +1,233 @@
+#include "framed_socket.h"
+
+/******************************************************************************
+ * Constructors and initialization
+******************************************************************************/
+
+/// @brief Adds message framing to an already connected stream socket.
+/// @param socket Connected socket. It must outlive this object.
+/// @param buffer_size Size of the send and receive buffers. Frames larger than
+///  this are still supported (the receive buffer grows as needed, up to
+///  FRAME_MAX_SIZE), but they won't be batched with other frames.
+FramedSocket::FramedSocket(Socket& socket, size_t buffer_size):
+    socket(socket), rx(buffer_size), rx_start(0), rx_end(0),
+    tx(buffer_size), tx_len(0) {}
+
+/// @brief Sends any frame left in the send buffer.
+FramedSocket::~FramedSocket() {
+    if (this->tx_len > 0) {
+        this->flush();
+    }
+}
+
+/******************************************************************************
+ * Reading and writing
+******************************************************************************/
+
+/// @brief Queues a frame to be sent. The send buffer is flushed when it's
+///  full, or after this frame if "more" is "false".
+/// @param data Payload of the frame.
+/// @param len Length of the payload. It must be greater than "0" and not
+///  greater than FRAME_MAX_SIZE.
+/// @param more If "true", the frame is kept in the send buffer, so that it can
+///  be sent together with the next ones. Call FramedSocket::flush(), or write
+///  the last frame with "more" as "false", to send all of them.
+/// @return Length of the payload on success, "-1" on error. If the socket is
+///  non blocking, the part of the frame that couldn't be sent is kept for the
+///  next FramedSocket::flush(). If the buffer couldn't be flushed to make
+///  room for the frame, "-1" is returned with errno EAGAIN, and the frame
+///  isn't queued.
+int FramedSocket::write_frame(const void* data, int len, bool more) {
+    char header[FRAME_HEADER_MAX];
+    int header_len;
+    if (len <= 0 || len > FRAME_MAX_SIZE) {
+        errno = EMSGSIZE;
+        perror(ERROR("invalid frame length in FramedSocket::write_frame"));
+        return -1;
+    }
+    header_len = FramedSocket::encode_varint((uint32_t) len, header);
+    if (this->tx_len + header_len + len > this->tx.size() && this->flush() == -1) {
+        return -1;
+    }
+    if (this->tx_len + header_len + len > this->tx.size()) {
+        // Frame larger than the buffer, send the header and the payload
+        // straight from the user's memory. On a non blocking socket, what
+        // doesn't fit is kept in the send buffer (grown for it), as flush()
+        // does, so that the stream stays whole.
+        struct iovec iov[2] = {{header, (size_t) header_len}, {(void*) data, (size_t) len}};
+        int bytes_sent = this->socket.writev(iov, 2);
+        if (bytes_sent == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            bytes_sent = 0;
+        }
+        if (bytes_sent < header_len + len) {
+            size_t tail = header_len + len - bytes_sent;
+            if (tail > this->tx.size()) {
+                this->tx.resize(tail);
+            }
+            if (bytes_sent < header_len) {
+                memcpy(this->tx.data(), header + bytes_sent, header_len - bytes_sent);
+                memcpy(this->tx.data() + header_len - bytes_sent, data, len);
+            } else {
+                memcpy(this->tx.data(), (const char*) data + bytes_sent - header_len, tail);
+            }
+            this->tx_len = tail;
+        }
+        return len;
+    }
+    memcpy(this->tx.data() + this->tx_len, header, header_len);
+    this->tx_len += header_len;
+    memcpy(this->tx.data() + this->tx_len, data, len);
+    this->tx_len += len;
+    if (!more && this->flush() == -1) {
+        return -1;
+    }
+    return len;
+}
+
+/// @brief Sends all the frames queued in the send buffer with a single call
+///  to Socket::write().
+/// @return "0" on success, "-1" on error. If the socket is non blocking and
+///  only part of the buffer could be sent, the rest is kept for the next call.
+int FramedSocket::flush(void) {
+    int bytes_sent;
+    if (this->tx_len == 0) {
+        return 0;
+    }
+    if ( (bytes_sent = this->socket.write(this->tx.data(), this->tx_len)) == -1) {
+        return -1;
+    }
+    if ((size_t) bytes_sent < this->tx_len) {
+        memmove(this->tx.data(), this->tx.data() + bytes_sent, this->tx_len - bytes_sent);
+        this->tx_len -= bytes_sent;
+        errno = EAGAIN;
+        return -1;
+    }
+    this->tx_len = 0;
+    return 0;
+}
+
+/// @brief Reads the next frame. If it's already in the receive buffer, no
+///  syscall is made. Otherwise, the socket is read once per call to
+///  Socket::read(), getting as many frames as were received.
+/// @param data Where the payload will be stored.
+/// @param max_len Size of "data". If the frame is larger, it's discarded and
+///  "-1" is returned with errno set to EMSGSIZE.
+/// @return Length of the payload, "0" if the peer closed the connection, or
+///  "-1" on error (EPROTO for a malformed or truncated frame).
+int FramedSocket::read_frame(void* data, int max_len) {
+    uint32_t frame_len;
+    int header_len, bytes_read;
+    while (true) {
+        if ( (header_len = this->decode_header(&frame_len)) == -1) {
+            errno = EPROTO;
+            perror(ERROR("malformed frame in FramedSocket::read_frame"));
+            return -1;
+        }
+        if (header_len > 0 && this->rx_end - this->rx_start >= header_len + frame_len) {
+            this->rx_start += header_len;
+            if (frame_len > (uint32_t) max_len) {
+                this->rx_start += frame_len;
+                errno = EMSGSIZE;
+                return -1;
+            }
+            memcpy(data, this->rx.data() + this->rx_start, frame_len);
+            this->rx_start += frame_len;
+            return (int) frame_len;
+        }
+        // Incomplete frame: move it to the start of the buffer and make sure
+        // there is room for all of it before reading again.
+        if (this->rx_start > 0) {
+            memmove(this->rx.data(), this->rx.data() + this->rx_start, this->rx_end - this->rx_start);
+            this->rx_end -= this->rx_start;
+            this->rx_start = 0;
+        }
+        if (header_len > 0 && header_len + frame_len > this->rx.size()) {
+            this->rx.resize(header_len + frame_len);
+        }
+        if ( (bytes_read = this->socket.read(this->rx.data() + this->rx_end, this->rx.size() - this->rx_end)) <= 0) {
+            if (bytes_read == 0 && this->rx_end > 0) {
+                errno = EPROTO;
+                return -1;
+            }
+            return bytes_read;
+        }
+        this->rx_end += bytes_read;
+    }
+}
+
+/// @brief Checks if a whole frame is waiting in the receive buffer, so that
+///  the next call to FramedSocket::read_frame() won't block.
+/// @return "true" if there is a complete frame, "false" otherwise.
+bool FramedSocket::has_frame(void) {
+    uint32_t frame_len;
+    int header_len = this->decode_header(&frame_len);
+    return header_len > 0 && this->rx_end - this->rx_start >= header_len + frame_len;
+}
+
+/******************************************************************************
+ * Getters
+******************************************************************************/
+
+/// @brief Returns the underlying socket.
+Socket& FramedSocket::get_socket(void) {
+    return this->socket;
+}
+
+/******************************************************************************
+ * Varint encoding
+******************************************************************************/
+
+/// @brief Encodes a number as a varint: 7 bits per byte, least significant
+///  first, with the highest bit set on every byte except the last.
+/// @param value Number to encode.
+/// @param buf Where the varint will be stored. It must have room for
+///  FRAME_HEADER_MAX bytes.
+/// @return Number of bytes used.
+int FramedSocket::encode_varint(uint32_t value, char* buf) {
+    int i = 0;
+    while (value >= 0x80) {
+        buf[i++] = (char) ((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buf[i++] = (char) value;
+    return i;
+}
+
+/// @brief Decodes a varint written by FramedSocket::encode_varint().
+/// @param buf Start of the varint.
+/// @param len Number of bytes available in "buf".
+/// @param value Where the decoded number will be stored.
+/// @return Number of bytes used, "0" if more bytes are needed, or "-1" if
+///  the varint is longer than FRAME_HEADER_MAX.
+int FramedSocket::decode_varint(const char* buf, int len, uint32_t* value) {
+    uint32_t result = 0;
+    int i;
+    for (i = 0; i < len && i < FRAME_HEADER_MAX; i++) {
+        result |= (uint32_t) (buf[i] & 0x7F) << (7 * i);
+        if ((buf[i] & 0x80) == 0) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return (i == FRAME_HEADER_MAX) ? -1 : 0;
+}
+
+/******************************************************************************
+ * Private methods
+******************************************************************************/
+
+/// @brief Decodes the length prefix of the next frame in the receive buffer.
+/// @param frame_len Where the payload length will be stored.
+/// @return Length of the prefix, "0" if it wasn't fully received, or "-1" if
+///  it's malformed or exceeds FRAME_MAX_SIZE.
+int FramedSocket::decode_header(uint32_t* frame_len) {
+    int header_len = FramedSocket::decode_varint(this->rx.data() + this->rx_start,
+        this->rx_end - this->rx_start, frame_len);
+    if (header_len > 0 && *frame_len > FRAME_MAX_SIZE) {
+        return -1;
+    }
+    return header_len;
+}
@@ -0,0 +1,62 @@
+#include "futex.h"
+
+/// @brief Sleeps while the 32 bit word at "addr" is equal to "expected".
+/// @param addr Address of the futex word. Must be aligned to 4 bytes.
+/// @param expected Value the word must have to go to sleep. If it already
+///  changed, returns right away, so no wake up can be lost between checking
+///  the word and calling this function.
+/// @param timeout Maximum time to sleep, relative (NULL to wait forever).
+/// @return "0" when woken up, or if the word didn't have the expected value.
+///  "-1" on error, with "errno" set to ETIMEDOUT if the timeout expired, or to
+///  EINTR if a signal was received.
+int Futex::wait(void* addr, uint32_t expected, const struct timespec* timeout) {
+    if (syscall(SYS_futex, addr, FUTEX_WAIT, expected, timeout, NULL, 0) == -1) {
+        if (errno == EAGAIN) {
+            return 0;
+        }
+        if (errno != ETIMEDOUT && errno != EINTR) {
+            perror(ERROR("futex in Futex::wait"));
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Wakes up processes or threads sleeping on the futex word at "addr".
+/// @param addr Address of the futex word.
+/// @param count Maximum amount of waiters to wake up (all by default).
+/// @return Number of waiters woken up, or "-1" on error.
+int Futex::wake(void* addr, int count) {
+    long woken;
+    if ( (woken = syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0)) == -1) {
+        perror(ERROR("futex in Futex::wake"));
+        return -1;
+    }
+    return (int) woken;
+}
+
+/// @brief Takes a lock made of a single futex word, that can live in shared
+///  memory: "0" unlocked, "1" locked, "2" locked with waiters. Waiters sleep
+///  on the word, so only the contended case makes syscalls.
+/// @param word The lock. It must be initialized to "0".
+void Futex::lock(std::atomic<uint32_t>& word) {
+    uint32_t state = 0;
+    if (word.compare_exchange_strong(state, 1, std::memory_order_acquire)) {
+        return;
+    }
+    if (state != 2) {
+        state = word.exchange(2, std::memory_order_acquire);
+    }
+    while (state != 0) {
+        wait(&word, 2);
+        state = word.exchange(2, std::memory_order_acquire);
+    }
+}
+
+/// @brief Releases a lock taken with Futex::lock(), waking up a waiter if
+///  there's one.
+void Futex::unlock(std::atomic<uint32_t>& word) {
+    if (word.exchange(0, std::memory_order_release) == 2) {
+        wake(&word, 1);
+    }
+}
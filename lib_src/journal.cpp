@@ -0,0 +1,563 @@
+#include "journal.h"
+
+/// @brief Makes the creation or removal of segment files durable.
+static void sync_dir(const std::string& dir) {
+    int dir_fd;
+    if ( (dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY)) == -1) {
+        perror(ERROR("open in Journal::sync_dir"));
+        return;
+    }
+    if (fsync(dir_fd) == -1) {
+        perror(ERROR("fsync in Journal::sync_dir"));
+    }
+    close(dir_fd);
+}
+
+/// @brief Maps the file where the writer publishes the synced offset.
+/// @return The mapping, or NULL on error.
+static uint64_t* map_synced(const std::string& dir, bool writer) {
+    std::string path = Journal::synced_path(dir);
+    struct stat info;
+    void* synced;
+    int fd;
+    if ( (fd = open(path.c_str(), (writer) ? O_RDWR | O_CREAT : O_RDONLY, 0666)) == -1) {
+        return NULL;
+    }
+    if ((writer && ftruncate(fd, sizeof(uint64_t)) == -1) || fstat(fd, &info) == -1 ||
+        info.st_size < (off_t) sizeof(uint64_t)) {
+        close(fd);
+        return NULL;
+    }
+    synced = mmap(NULL, sizeof(uint64_t), (writer) ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return (synced == MAP_FAILED) ? NULL : (uint64_t*) synced;
+}
+
+/******************************************************************************
+ * Journal: constructors and initialization
+******************************************************************************/
+
+/// @brief Opens a journal for appending, creating it if needed. If it already
+///  exists, appending continues after the last complete record: a record that
+///  was being written when the previous writer died is discarded. Fails if
+///  another Journal, in this or another process, has the directory open.
+/// @param dir Directory of the journal. It's created if it doesn't exist.
+/// @param segment_size Size of each segment file, rounded up to the page size.
+///  A record can't be larger than a segment.
+/// @param sync_every Records appended between syncs. If "0", disabled.
+/// @param sync_us Maximum age, in microseconds, of an unsynced record before
+///  a sync. It's checked on every append. If negative, disabled. With both
+///  thresholds disabled, records are only synced with Journal::sync(), when
+///  changing segments, and on destruction.
+/// @return On error, std::runtime_error() is thrown.
+Journal::Journal(const char* dir, size_t segment_size, int sync_every, long sync_us):
+    dir(dir), sync_every(sync_every), sync_us(sync_us), lock_fd(-1), synced(NULL), fd(-1),
+    segment(NULL), unsynced(0) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    uint64_t last;
+    this->segment_size = (segment_size + page_size - 1) / page_size * page_size;
+    if (mkdir(dir, 0777) == -1 && errno != EEXIST) {
+        perror(ERROR("mkdir in Journal::Journal"));
+        throw(std::runtime_error("mkdir"));
+    }
+    if ( (this->lock_fd = open(dir, O_RDONLY | O_DIRECTORY)) == -1) {
+        perror(ERROR("open in Journal::Journal"));
+        throw(std::runtime_error("open"));
+    }
+    if (flock(this->lock_fd, LOCK_EX | LOCK_NB) == -1) {
+        perror(ERROR("another writer has the journal, flock in Journal::Journal"));
+        close(this->lock_fd);
+        throw(std::runtime_error("flock"));
+    }
+    if ( (this->synced = map_synced(this->dir, true)) == NULL) {
+        perror(ERROR("map_synced in Journal::Journal"));
+        close(this->lock_fd);
+        throw(std::runtime_error("synced"));
+    }
+    if (find_segment(this->dir, UINT64_MAX, &last) == 0) {
+        if (this->open_segment(last, false) == -1 || this->recover() == -1) {
+            this->close_segment();
+            munmap(this->synced, sizeof(uint64_t));
+            close(this->lock_fd);
+            throw(std::runtime_error("open_segment"));
+        }
+    } else if (this->open_segment(0, true) == -1) {
+        munmap(this->synced, sizeof(uint64_t));
+        close(this->lock_fd);
+        throw(std::runtime_error("open_segment"));
+    } else {
+        this->publish_synced();
+    }
+}
+
+/// @brief Syncs every appended record, and closes the journal. Its files are
+///  kept.
+Journal::~Journal() {
+    this->sync();
+    this->close_segment();
+    munmap(this->synced, sizeof(uint64_t));
+    close(this->lock_fd);
+}
+
+/******************************************************************************
+ * Journal: writing
+******************************************************************************/
+
+/// @brief Appends a record. It's durable, and visible to readers, once synced.
+/// @param data Payload of the record.
+/// @param len Length of the payload. It can't be "0".
+/// @return "0" on success, "-1" on error (EMSGSIZE if the record doesn't fit
+///  in a segment).
+int Journal::append(const void* data, size_t len) {
+    struct timespec now;
+    Header* header;
+    if (len == 0 || len >= SKIP || record_size(len) > this->segment_size) {
+        errno = (len == 0) ? EINVAL : EMSGSIZE;
+        return -1;
+    }
+    if (this->write_pos + record_size(len) > this->current_size) {
+        // Readers jump to the next segment when they find the mark.
+        if (this->write_pos + sizeof(Header) <= this->current_size) {
+            header = (Header*) (this->segment + this->write_pos);
+            __atomic_store_n(&(header->len), SKIP, __ATOMIC_RELEASE);
+            this->write_pos = this->current_size;
+        }
+        uint64_t next = this->base + this->current_size;
+        if (this->sync() == -1) {
+            return -1;
+        }
+        this->close_segment();
+        if (this->open_segment(next, true) == -1) {
+            return -1;
+        }
+    }
+    header = (Header*) (this->segment + this->write_pos);
+    memcpy(header + 1, data, len);
+    header->checksum = checksum(data, len);
+    // The length goes last: a reader that sees it sees the whole record.
+    __atomic_store_n(&(header->len), (uint32_t) len, __ATOMIC_RELEASE);
+    this->write_pos += record_size(len);
+    if (this->unsynced++ == 0 && this->sync_us >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &(this->first_unsynced));
+    }
+    if (this->sync_every > 0 && this->unsynced >= this->sync_every) {
+        return this->sync();
+    }
+    if (this->sync_us >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((now.tv_sec - this->first_unsynced.tv_sec) * 1000000L +
+            (now.tv_nsec - this->first_unsynced.tv_nsec) / 1000 >= this->sync_us) {
+            return this->sync();
+        }
+    }
+    return 0;
+}
+
+/// @brief Writes every appended record to the disk, with a single msync().
+/// @return "0" on success, "-1" on error.
+int Journal::sync(void) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t start = this->synced_pos / page_size * page_size;
+    if (this->segment == NULL || this->write_pos == this->synced_pos) {
+        return 0;
+    }
+    if (msync(this->segment + start, this->write_pos - start, MS_SYNC) == -1) {
+        perror(ERROR("msync in Journal::sync"));
+        return -1;
+    }
+    this->synced_pos = this->write_pos;
+    this->unsynced = 0;
+    this->publish_synced();
+    return 0;
+}
+
+/// @brief Deletes the segments whose records are all before "offset", for
+///  example the lowest offset committed by every reader. The current segment
+///  is never deleted.
+/// @return Amount of segments deleted, or "-1" on error.
+int Journal::trim(uint64_t offset) {
+    struct dirent* entry;
+    struct stat info;
+    int removed = 0;
+    DIR* dir_stream;
+    if ( (dir_stream = opendir(this->dir.c_str())) == NULL) {
+        perror(ERROR("opendir in Journal::trim"));
+        return -1;
+    }
+    while ( (entry = readdir(dir_stream)) != NULL) {
+        uint64_t segment_base;
+        char suffix[16];
+        if (sscanf(entry->d_name, "%" SCNu64 "%15s", &segment_base, suffix) != 2 ||
+            strcmp(suffix, ".journal") != 0 || segment_base == this->base) {
+            continue;
+        }
+        std::string path = segment_path(this->dir, segment_base);
+        if (stat(path.c_str(), &info) == 0 && segment_base + info.st_size <= offset) {
+            if (unlink(path.c_str()) == -1) {
+                perror(ERROR("unlink in Journal::trim"));
+            } else {
+                removed++;
+            }
+        }
+    }
+    closedir(dir_stream);
+    if (removed > 0) {
+        sync_dir(this->dir);
+    }
+    return removed;
+}
+
+/// @brief Returns the offset the next record will have.
+uint64_t Journal::get_offset(void) const {
+    return this->base + this->write_pos;
+}
+
+/******************************************************************************
+ * Journal: shared definitions
+******************************************************************************/
+
+/// @brief Path of the file with the synced offset.
+std::string Journal::synced_path(const std::string& dir) {
+    return dir + "/synced";
+}
+
+/// @brief FNV-1a hash of the payload, seeded with its length.
+uint32_t Journal::checksum(const void* data, size_t len) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    uint32_t hash = 2166136261u ^ (uint32_t) len;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/// @brief Space taken by a record with a payload of "len" bytes.
+size_t Journal::record_size(size_t len) {
+    return (sizeof(Header) + len + 7) & ~((size_t) 7);
+}
+
+/// @brief Path of the segment file that starts at offset "base".
+std::string Journal::segment_path(const std::string& dir, uint64_t base) {
+    char name[32];
+    snprintf(name, sizeof(name), "/%020" PRIu64 ".journal", base);
+    return dir + name;
+}
+
+/// @brief Finds the segment that holds "offset".
+/// @param base Where the offset of the segment will be stored: the last one
+///  starting at or before "offset", or the first one if all of them start
+///  after it (because older ones were trimmed).
+/// @return "0" on success, "-1" if there are no segments.
+int Journal::find_segment(const std::string& dir, uint64_t offset, uint64_t* base) {
+    struct dirent* entry;
+    bool found_before = false, found_after = false;
+    uint64_t before = 0, after = UINT64_MAX;
+    DIR* dir_stream;
+    if ( (dir_stream = opendir(dir.c_str())) == NULL) {
+        return -1;
+    }
+    while ( (entry = readdir(dir_stream)) != NULL) {
+        uint64_t segment_base;
+        char suffix[16];
+        if (sscanf(entry->d_name, "%" SCNu64 "%15s", &segment_base, suffix) != 2 ||
+            strcmp(suffix, ".journal") != 0) {
+            continue;
+        }
+        if (segment_base <= offset && (!found_before || segment_base > before)) {
+            before = segment_base;
+            found_before = true;
+        } else if (segment_base > offset && segment_base < after) {
+            after = segment_base;
+            found_after = true;
+        }
+    }
+    closedir(dir_stream);
+    if (!found_before && !found_after) {
+        errno = ENOENT;
+        return -1;
+    }
+    *base = (found_before) ? before : after;
+    return 0;
+}
+
+/******************************************************************************
+ * Journal: private methods
+******************************************************************************/
+
+/// @brief Maps the segment that starts at offset "base".
+/// @param create If "true", the segment file is created with "segment_size".
+/// @return "0" on success, "-1" on error.
+int Journal::open_segment(uint64_t base, bool create) {
+    std::string path = segment_path(this->dir, base);
+    std::string tmp_path = path + ".tmp";
+    struct stat info;
+    // New segments get their size before their name, so readers never map
+    // an empty file.
+    if ( (this->fd = open(create ? tmp_path.c_str() : path.c_str(), O_RDWR | (create ? O_CREAT | O_TRUNC : 0), 0666)) == -1) {
+        perror(ERROR("open in Journal::open_segment"));
+        return -1;
+    }
+    if (create) {
+        if (ftruncate(this->fd, this->segment_size) == -1 || rename(tmp_path.c_str(), path.c_str()) == -1) {
+            perror(ERROR("ftruncate or rename in Journal::open_segment"));
+            close(this->fd);
+            unlink(tmp_path.c_str());
+            return -1;
+        }
+        sync_dir(this->dir);
+        this->current_size = this->segment_size;
+    } else {
+        if (fstat(this->fd, &info) == -1) {
+            perror(ERROR("fstat in Journal::open_segment"));
+            close(this->fd);
+            return -1;
+        }
+        this->current_size = info.st_size;
+    }
+    this->segment = (char*) mmap(NULL, this->current_size, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (this->segment == MAP_FAILED) {
+        perror(ERROR("mmap in Journal::open_segment"));
+        this->segment = NULL;
+        close(this->fd);
+        return -1;
+    }
+    this->base = base;
+    this->write_pos = 0;
+    this->synced_pos = 0;
+    return 0;
+}
+
+/// @brief Unmaps the current segment.
+void Journal::close_segment(void) {
+    if (this->segment != NULL) {
+        munmap(this->segment, this->current_size);
+        close(this->fd);
+        this->segment = NULL;
+    }
+}
+
+/// @brief Finds the end of the last segment, after reopening a journal. The
+///  first record that is incomplete or corrupted (a crash while writing it, or
+///  before it was synced) is erased, along with everything after it. The rest
+///  is synced, and published to readers.
+/// @return "0" on success, "-1" on error.
+int Journal::recover(void) {
+    size_t pos = 0;
+    while (pos + sizeof(Header) <= this->current_size) {
+        Header* header = (Header*) (this->segment + pos);
+        if (header->len == 0) {
+            break;
+        }
+        if (header->len == SKIP) {
+            // The writer died before creating the next segment. Its records
+            // may still be only in the page cache.
+            uint64_t next = this->base + this->current_size;
+            if (msync(this->segment, this->current_size, MS_SYNC) == -1) {
+                perror(ERROR("msync in Journal::recover"));
+                return -1;
+            }
+            this->close_segment();
+            if (this->open_segment(next, true) == -1) {
+                return -1;
+            }
+            this->publish_synced();
+            return 0;
+        }
+        if (pos + record_size(header->len) > this->current_size ||
+            header->checksum != checksum(header + 1, header->len)) {
+            memset(this->segment + pos, 0, this->current_size - pos);
+            break;
+        }
+        pos += record_size(header->len);
+    }
+    // Records the writer appended but didn't sync before dying are still in
+    // the page cache, and pass the checksum: make them durable before readers
+    // can see them.
+    if (msync(this->segment, this->current_size, MS_SYNC) == -1) {
+        perror(ERROR("msync in Journal::recover"));
+        return -1;
+    }
+    this->write_pos = pos;
+    this->synced_pos = pos;
+    this->publish_synced();
+    return 0;
+}
+
+/// @brief Lets readers see the records up to the synced position.
+void Journal::publish_synced(void) {
+    __atomic_store_n(this->synced, this->base + this->synced_pos, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * JournalReader
+******************************************************************************/
+
+/// @brief Opens a consumer of a journal. It starts at its last committed
+///  offset, or at the oldest record if it never committed one.
+/// @param dir Directory of the journal.
+/// @param name Identifies the consumer, so that each one has its own offset.
+/// @return On error, std::runtime_error() is thrown.
+JournalReader::JournalReader(const char* dir, const char* name):
+    dir(dir), name(name), synced(NULL), fd(-1), segment(NULL), segment_size(0), base(0), read_pos(0) {
+    std::string path = this->dir + "/" + this->name + ".offset";
+    uint64_t offset = 0;
+    if ( (this->offset_fd = open(path.c_str(), O_RDWR | O_CREAT, 0666)) == -1) {
+        perror(ERROR("open in JournalReader::JournalReader"));
+        throw(std::runtime_error("open"));
+    }
+    if (pread(this->offset_fd, &offset, sizeof(offset), 0) != sizeof(offset)) {
+        offset = 0;
+    }
+    this->seek(offset);
+}
+
+/// @brief Closes the consumer. The offset isn't committed.
+JournalReader::~JournalReader() {
+    this->close_segment();
+    if (this->synced != NULL) {
+        munmap(this->synced, sizeof(uint64_t));
+    }
+    close(this->offset_fd);
+}
+
+/// @brief Reads the next record, without waiting for it. Records that aren't
+///  synced yet aren't read.
+/// @param data Where the payload will be stored.
+/// @param max_len Size of "data". If the record is larger, it isn't consumed,
+///  and "-1" is returned with errno set to EMSGSIZE.
+/// @return Length of the payload, "0" if there are no new records, or "-1" on
+///  error (EBADMSG if the record is corrupted).
+ssize_t JournalReader::read(void* data, size_t max_len) {
+    Journal::Header* header = NULL;
+    uint32_t len;
+    if (this->segment == NULL && (this->seek(this->get_offset()) == -1 || this->segment == NULL)) {
+        return 0;   // The writer didn't create the journal yet.
+    }
+    while (true) {
+        if (this->read_pos + sizeof(Journal::Header) > this->segment_size) {
+            len = Journal::SKIP;
+        } else {
+            header = (Journal::Header*) (this->segment + this->read_pos);
+            len = __atomic_load_n(&(header->len), __ATOMIC_ACQUIRE);
+        }
+        if (len == 0) {
+            return 0;
+        }
+        if (len != Journal::SKIP) {
+            break;
+        }
+        uint64_t next = this->base + this->segment_size;
+        if (access(Journal::segment_path(this->dir, next).c_str(), F_OK) == -1) {
+            return 0;   // The writer is about to create it.
+        }
+        this->close_segment();
+        if (this->open_segment(next) == -1) {
+            return -1;
+        }
+    }
+    if (this->read_pos + Journal::record_size(len) > this->segment_size) {
+        errno = EBADMSG;
+        return -1;
+    }
+    if (this->get_offset() + Journal::record_size(len) > this->get_synced()) {
+        return 0;
+    }
+    if (len > max_len) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    memcpy(data, header + 1, len);
+    if (header->checksum != Journal::checksum(data, len)) {
+        errno = EBADMSG;
+        return -1;
+    }
+    this->read_pos += Journal::record_size(len);
+    return len;
+}
+
+/// @brief Saves the current offset, so that a new JournalReader with the same
+///  name starts from here.
+/// @return "0" on success, "-1" on error.
+int JournalReader::commit(void) {
+    uint64_t offset = this->get_offset();
+    if (pwrite(this->offset_fd, &offset, sizeof(offset), 0) != sizeof(offset)) {
+        perror(ERROR("pwrite in JournalReader::commit"));
+        return -1;
+    }
+    if (fdatasync(this->offset_fd) == -1) {
+        perror(ERROR("fdatasync in JournalReader::commit"));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Moves to the record at "offset", which must be the offset of a
+///  record (as returned by JournalReader::get_offset() or Journal::get_offset()).
+///  If its segment was trimmed, moves to the oldest record.
+/// @return "0" on success, "-1" on error.
+int JournalReader::seek(uint64_t offset) {
+    uint64_t segment_base;
+    this->close_segment();
+    if (Journal::find_segment(this->dir, offset, &segment_base) == -1) {
+        this->base = offset;
+        this->read_pos = 0;
+        return 0;
+    }
+    if (this->open_segment(segment_base) == -1) {
+        return -1;
+    }
+    if (offset > segment_base && offset - segment_base <= this->segment_size) {
+        this->read_pos = offset - segment_base;
+    }
+    return 0;
+}
+
+/// @brief Returns the offset of the next record to be read.
+uint64_t JournalReader::get_offset(void) const {
+    return this->base + this->read_pos;
+}
+
+/// @brief Returns the offset up to which the writer synced the records, or
+///  "0" if the journal wasn't created yet.
+uint64_t JournalReader::get_synced(void) {
+    if (this->synced == NULL && (this->synced = map_synced(this->dir, false)) == NULL) {
+        return 0;
+    }
+    return __atomic_load_n(this->synced, __ATOMIC_ACQUIRE);
+}
+
+/// @brief Maps the segment that starts at offset "base", read only.
+/// @return "0" on success, "-1" on error.
+int JournalReader::open_segment(uint64_t base) {
+    std::string path = Journal::segment_path(this->dir, base);
+    struct stat info;
+    if ( (this->fd = open(path.c_str(), O_RDONLY)) == -1) {
+        perror(ERROR("open in JournalReader::open_segment"));
+        return -1;
+    }
+    if (fstat(this->fd, &info) == -1) {
+        perror(ERROR("fstat in JournalReader::open_segment"));
+        close(this->fd);
+        return -1;
+    }
+    this->segment_size = info.st_size;
+    this->segment = (char*) mmap(NULL, this->segment_size, PROT_READ, MAP_SHARED, this->fd, 0);
+    if (this->segment == MAP_FAILED) {
+        perror(ERROR("mmap in JournalReader::open_segment"));
+        this->segment = NULL;
+        close(this->fd);
+        return -1;
+    }
+    this->base = base;
+    this->read_pos = 0;
+    return 0;
+}
+
+/// @brief Unmaps the current segment.
+void JournalReader::close_segment(void) {
+    if (this->segment != NULL) {
+        munmap(this->segment, this->segment_size);
+        close(this->fd);
+        this->segment = NULL;
+    }
+}
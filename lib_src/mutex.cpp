@@ -1,4 +1,5 @@
 #include "mutex.h"
+#include <string.h>
 
 /// @brief Creates a new Mutex.
 Mutex::Mutex() {
@@ -38,3 +39,163 @@ int Mutex::trylock(void) {
     }
     return 0;
 }
+
+/******************************************************************************
+ * Shared mutex
+******************************************************************************/
+
+/// @brief Creates a mutex that can be used by different processes, if it's
+///  built inside a shared memory. Only one process must build it.
+/// @return On error, std::runtime_error() is thrown.
+SharedMutex::SharedMutex() {
+    pthread_mutexattr_t attr;
+    int error;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    error = pthread_mutex_init(&(this->mutex), &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (error != 0) {
+        errno = error;
+        perror(ERROR("pthread_mutex_init in SharedMutex::SharedMutex"));
+        throw(std::runtime_error("pthread_mutex_init"));
+    }
+}
+
+/// @brief Destroys the mutex. Only one process must destroy it, when no other
+///  one uses it anymore.
+SharedMutex::~SharedMutex() {
+    pthread_mutex_destroy(&(this->mutex));
+}
+
+/// @brief Reserves the mutex in a blocking manner.
+/// @return "0" on success, "1" if it was taken from an owner that died while
+///  holding it (the data it protects may have been left half modified), "-1"
+///  on error.
+int SharedMutex::lock(void) {
+    return this->recover(pthread_mutex_lock(&(this->mutex)), "pthread_mutex_lock in SharedMutex::lock");
+}
+
+/// @brief Tries to reserve the mutex in a non-blocking manner.
+/// @return Same as SharedMutex::lock(). "-1" with errno EBUSY if it was
+///  already reserved.
+int SharedMutex::trylock(void) {
+    int error = pthread_mutex_trylock(&(this->mutex));
+    if (error == EBUSY) {
+        errno = EBUSY;
+        return -1;
+    }
+    return this->recover(error, "pthread_mutex_trylock in SharedMutex::trylock");
+}
+
+/// @brief Frees the mutex.
+/// @return "0" on success, "-1" on error.
+int SharedMutex::unlock(void) {
+    int error;
+    if ( (error = pthread_mutex_unlock(&(this->mutex))) != 0) {
+        errno = error;
+        perror(ERROR("pthread_mutex_unlock in SharedMutex::unlock"));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Handles the result of taking the mutex. If its owner died, it's
+///  marked as consistent again, so it keeps working after it's unlocked.
+/// @return "0", "1" if the owner died, or "-1" on error.
+int SharedMutex::recover(int error, const char* method) {
+    if (error == EOWNERDEAD) {
+        if ( (error = pthread_mutex_consistent(&(this->mutex))) == 0) {
+            return 1;
+        }
+        method = "pthread_mutex_consistent in SharedMutex";
+    }
+    if (error != 0) {
+        fprintf(stderr, ERROR("%s: %s\n"), method, strerror(error));
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+/******************************************************************************
+ * Shared condition variable
+******************************************************************************/
+
+/// @brief Creates a condition variable that can be used by different
+///  processes, if it's built inside a shared memory. Only one process must
+///  build it.
+/// @return On error, std::runtime_error() is thrown.
+SharedCond::SharedCond() {
+    pthread_condattr_t attr;
+    int error;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    error = pthread_cond_init(&(this->cond), &attr);
+    pthread_condattr_destroy(&attr);
+    if (error != 0) {
+        errno = error;
+        perror(ERROR("pthread_cond_init in SharedCond::SharedCond"));
+        throw(std::runtime_error("pthread_cond_init"));
+    }
+}
+
+/// @brief Destroys the condition variable. Only one process must destroy it,
+///  when no other one uses it anymore.
+SharedCond::~SharedCond() {
+    pthread_cond_destroy(&(this->cond));
+}
+
+/// @brief Releases the mutex, that must be reserved, and sleeps until it's
+///  signaled. The mutex is reserved again before returning. Spurious wake ups
+///  can happen, so check the condition in a loop.
+/// @param timeout_ms Maximum time to sleep, in milliseconds. If negative,
+///  sleeps forever (default).
+/// @return Same as SharedMutex::lock(). "-1" with errno ETIMEDOUT if the
+///  timeout expired (the mutex is reserved anyway).
+int SharedCond::wait(SharedMutex& mutex, int timeout_ms) {
+    struct timespec deadline;
+    int error;
+    if (timeout_ms < 0) {
+        error = pthread_cond_wait(&(this->cond), &(mutex.mutex));
+    } else {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        error = pthread_cond_timedwait(&(this->cond), &(mutex.mutex), &deadline);
+        if (error == ETIMEDOUT) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
+    return mutex.recover(error, "pthread_cond_wait in SharedCond::wait");
+}
+
+/// @brief Wakes up one of the processes waiting, if any.
+/// @return "0" on success, "-1" on error.
+int SharedCond::signal(void) {
+    int error;
+    if ( (error = pthread_cond_signal(&(this->cond))) != 0) {
+        errno = error;
+        perror(ERROR("pthread_cond_signal in SharedCond::signal"));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Wakes up every process waiting.
+/// @return "0" on success, "-1" on error.
+int SharedCond::broadcast(void) {
+    int error;
+    if ( (error = pthread_cond_broadcast(&(this->cond))) != 0) {
+        errno = error;
+        perror(ERROR("pthread_cond_broadcast in SharedCond::broadcast"));
+        return -1;
+    }
+    return 0;
+}
@@ -1,12 +1,19 @@
 #include "server.h"
 
-bool Server::exit;
+// Operation types in io_uring mode, stored in the lower bits of "user_data".
+#define URING_ACCEPT    0
+#define URING_RECV      1
+#define URING_SEND      2
+#define URING_TYPE_MASK 3
+
+std::atomic<bool> Server::exit(false);
 
 /// @brief Creates a server. Uses same parameters as Socket::Socket().
 /// @return Might throw std::runtime_error on error.
 Server::Server(const char* ip, const char* port, int family, int socktype):
-    socket(ip, port, family, socktype, true) {
+    socket(ip, port, family, socktype, true), family(family), socktype(socktype) {
     Server::exit = false;
+    this->uring = NULL;
     Signal::ignore(SIGCHLD);  // Ignoring childs is necessary to avoid zombies.
     Signal::set_handler(SIGINT, &Server::leave);
 }
@@ -55,6 +62,905 @@ void Server::start(int backlog) {
     this->on_quit();
 }
 
+/// @brief Starts the server in reactor mode, blocks operation. Instead of
+///  forking for every client, all connections are multiplexed in this same
+///  process with "epoll", and sockets are set as non-blocking. When a client
+///  has data available, "on_readable()" is called, and when it can be written
+///  (see Server::set_writable()), "on_writable()" is called. Both callbacks
+///  must not block. The server will keep running until a SIGINT is received.
+/// @param backlog Number of clients that can be put "on hold".
+void Server::start_reactor(int backlog) {
+    struct epoll_event ev;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    Socket* client;
+    sigset_t mask;
+    int n;
+
+    this->backlog = backlog;
+    if (listen(this->socket.get_sockfd(), this->backlog) != 0) {
+        perror(ERROR("Couldn't start the server with listen"));
+        return;
+    }
+    if (this->socket.set_nonblocking() != 0) {
+        return;
+    }
+    if ( (this->epfd = epoll_create1(0)) == -1) {
+        perror(ERROR("epoll_create1 in Server::start_reactor"));
+        return;
+    }
+    ev.events = EPOLLIN;
+    ev.data.ptr = &(this->socket);
+    if (epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->socket.get_sockfd(), &ev) == -1) {
+        perror(ERROR("epoll_ctl in Server::start_reactor"));
+        ::close(this->epfd);
+        return;
+    }
+    // SIGINT is only unblocked while waiting, so it can't be missed if it is
+    // received while attending events.
+    Signal::block(SIGINT);
+    pthread_sigmask(SIG_SETMASK, NULL, &mask);
+    sigdelset(&mask, SIGINT);
+    this->on_start();
+    while (!Server::exit) {
+        if ( (n = epoll_pwait(this->epfd, events, SERVER_MAX_EVENTS, -1, &mask)) == -1) {
+            if (errno != EINTR) {
+                perror(ERROR("epoll_pwait in Server::start_reactor"));
+            }
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            client = (Socket*) events[i].data.ptr;
+            if (client == &(this->socket)) {
+                this->accept_clients();
+                continue;
+            }
+            // It might have been closed by a callback in this same iteration.
+            if (this->clients.count(client) == 0) {
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                this->close_client(*client);
+                continue;
+            }
+            if ((events[i].events & EPOLLIN) && this->on_readable(*client) != 0) {
+                this->close_client(*client);
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) && this->flush_client(*client) != 0) {
+                this->close_client(*client);
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) && this->writable.count(client) &&
+                this->on_writable(*client) != 0) {
+                this->close_client(*client);
+            }
+        }
+        for (size_t i = 0; i < this->closed_clients.size(); i++) {
+            delete this->closed_clients[i];
+        }
+        this->closed_clients.clear();
+    }
+    while (!this->clients.empty()) {
+        this->close_client(**(this->clients.begin()));
+    }
+    for (size_t i = 0; i < this->closed_clients.size(); i++) {
+        delete this->closed_clients[i];
+    }
+    this->closed_clients.clear();
+    Signal::unblock(SIGINT);
+    ::close(this->epfd);
+    this->socket.close();
+    this->on_quit();
+}
+
+/// @brief Reactor mode. Enables or disables calls to "on_writable()" for a
+///  client. Should only be enabled while there is pending data to be sent,
+///  otherwise "on_writable()" will be called on every iteration.
+/// @param socket Client socket, as received in the callbacks.
+/// @param enable "true" to be notified when the socket is writable.
+/// @return "0" on success, "-1" on error.
+int Server::set_writable(Socket& socket, bool enable) {
+    if (enable) {
+        this->writable.insert(&socket);
+    } else {
+        this->writable.erase(&socket);
+    }
+    return this->update_events(socket);
+}
+
+/// @brief Reactor mode. Waits for a client to be writable if "on_writable()"
+///  was enabled, or if data queued by Server::send_async() is left.
+/// @return "0" on success, "-1" on error.
+int Server::update_events(Socket& socket) {
+    struct epoll_event ev;
+    bool out = this->writable.count(&socket) || this->send_queue.count(&socket);
+    ev.events = EPOLLIN | ((out) ? EPOLLOUT : 0);
+    ev.data.ptr = &socket;
+    if (epoll_ctl(this->epfd, EPOLL_CTL_MOD, socket.get_sockfd(), &ev) == -1) {
+        perror(ERROR("epoll_ctl in Server::set_writable"));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Reactor mode. Writes as much data queued by Server::send_async() as
+///  the socket takes, without waiting.
+/// @return "0" on success (even if some data is left), "-1" on error.
+int Server::flush_client(Socket& socket) {
+    std::map<Socket*, std::string>::iterator queued = this->send_queue.find(&socket);
+    size_t sent = 0;
+    int n;
+    if (queued == this->send_queue.end()) {
+        return 0;
+    }
+    std::string& data = queued->second;
+    while (sent < data.size()) {
+        if ( (n = socket.write(&(data[sent]), data.size() - sent)) == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            break;
+        }
+        sent += n;
+    }
+    data.erase(0, sent);
+    if (data.empty()) {
+        this->send_queue.erase(queued);
+        return this->update_events(socket);
+    }
+    return 0;
+}
+
+/// @brief Reactor mode. Closes a client connection. The socket must not be
+///  used after this call.
+/// @param socket Client socket, as received in the callbacks.
+void Server::close_client(Socket& socket) {
+    if (this->clients.erase(&socket) == 0) {
+        return;
+    }
+    if (this->uring != NULL) {
+        // Ends the pending operations. It is freed when all of them complete.
+        shutdown(socket.get_sockfd(), SHUT_RDWR);
+        return;
+    }
+    epoll_ctl(this->epfd, EPOLL_CTL_DEL, socket.get_sockfd(), NULL);
+    this->send_queue.erase(&socket);
+    this->writable.erase(&socket);
+    // The file descriptor is closed by the destructor, after all the events
+    // of this iteration were attended, so that it can't be reused meanwhile.
+    shutdown(socket.get_sockfd(), SHUT_RDWR);
+    this->closed_clients.push_back(&socket);
+}
+
+/// @brief Reactor mode. Default handler for clients with data to be read.
+///  Reads all the available data, up to SERVER_BUFFER_SIZE bytes, and passes
+///  it to "on_data()".
+/// @param socket Client socket.
+/// @return "0" to keep the connection, "-1" to close it.
+int Server::on_readable(Socket& socket) {
+    char buffer[SERVER_BUFFER_SIZE];
+    int len;
+    if ( (len = socket.read(buffer, sizeof(buffer))) == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return 0;
+    }
+    if (len <= 0) {
+        return -1;
+    }
+    return this->on_data(socket, buffer, len);
+}
+
+/// @brief io_uring and reactor modes. Sends data to a client without waiting
+///  for it to be sent. In io_uring mode, the data is copied and the "send()"
+///  is submitted together with all the other operations of the same iteration.
+///  In reactor mode, it is written right away, and whatever the socket doesn't
+///  take is copied and sent when it becomes writable, in order. In the other
+///  modes, sockets are blocking, so it waits until everything is written.
+/// @param socket Client socket, as received in the callbacks.
+/// @param data Data to be sent. Can be reused after returning.
+/// @param len Length of the data in bytes.
+/// @return "0" on success, "-1" on error.
+int Server::send_async(Socket& socket, const void* data, int len) {
+    UringSend* op;
+    struct pollfd pfd;
+    int sent = 0;
+    int n;
+
+    if (this->uring == NULL && this->clients.count(&socket) != 0) {
+        std::map<Socket*, std::string>::iterator queued = this->send_queue.find(&socket);
+        if (queued != this->send_queue.end()) {
+            queued->second.append((const char*) data, len);
+            return 0;
+        }
+        while (sent < len) {
+            if ( (n = socket.write((char*) data + sent, len - sent)) == -1) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    return -1;
+                }
+                this->send_queue[&socket].assign((const char*) data + sent, len - sent);
+                return this->update_events(socket);
+            }
+            sent += n;
+        }
+        return 0;
+    }
+    if (this->uring == NULL) {
+        while (sent < len) {
+            if ( (n = socket.write((char*) data + sent, len - sent)) == -1) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    return -1;
+                }
+                pfd.fd = socket.get_sockfd();
+                pfd.events = POLLOUT;
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            sent += n;
+        }
+        return 0;
+    }
+    if (this->clients.count(&socket) == 0) {
+        return -1;
+    }
+    op = new UringSend;
+    op->conn = (UringConn*) &socket;
+    op->data = (char*) malloc(len);
+    op->len = len;
+    op->sent = 0;
+    memcpy(op->data, data, len);
+    if (this->uring->send(socket.get_sockfd(), op->data, len, (uint64_t) (uintptr_t) op | URING_SEND) != 0) {
+        free(op->data);
+        delete op;
+        return -1;
+    }
+    op->conn->pending++;
+    return 0;
+}
+
+/// @brief Reactor mode. Accepts all pending connections, and adds them to the
+///  "epoll" interest list.
+void Server::accept_clients(void) {
+    int client_sockfd;
+    struct sockaddr_storage client_addr;
+    socklen_t addrlen;
+    struct epoll_event ev;
+    Socket* client;
+
+    while (true) {
+        addrlen = sizeof(struct sockaddr_storage);
+        if ( (client_sockfd = accept4(this->socket.get_sockfd(), (struct sockaddr*) &client_addr, &addrlen, SOCK_NONBLOCK) ) == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror(WARNING("Couldn't accept a connection from a client"));
+            }
+            return;
+        }
+        client = new Socket();
+        if (client->init(client_sockfd, (struct sockaddr*) &client_addr) == -1) {
+            delete client;
+            continue;
+        }
+        ev.events = EPOLLIN;
+        ev.data.ptr = client;
+        if (epoll_ctl(this->epfd, EPOLL_CTL_ADD, client_sockfd, &ev) == -1) {
+            perror(ERROR("epoll_ctl in Server::accept_clients"));
+            delete client;
+            continue;
+        }
+        this->clients.insert(client);
+        this->on_new_client();
+    }
+}
+
+/// @brief Starts the server in pool mode, blocks operation. Accepted clients
+///  are put in a bounded queue, and a fixed pool of threads takes them from
+///  there and calls "on_accept()". Unlike Server::start(), "on_accept()" runs
+///  on a thread of this same process, so it must be thread safe. The server
+///  will keep running until a SIGINT is received, and then waits for every
+///  worker to finish with its current client.
+/// @param workers Amount of threads in the pool.
+/// @param queue_depth Maximum amount of accepted clients waiting for a worker.
+/// @param policy What to do when the queue is full (see Server::PoolPolicy).
+/// @param backlog Number of clients that can be put "on hold".
+void Server::start_pool(int workers, int queue_depth, int policy, int backlog) {
+    int client_sockfd;
+    struct sockaddr_storage client_addr;
+    Thread* threads;
+    int created = 0;
+
+    this->backlog = backlog;
+    if (listen(this->socket.get_sockfd(), this->backlog) != 0) {
+        perror(ERROR("Couldn't start the server with listen"));
+        return;
+    }
+    this->pool_queue = new PoolEntry[queue_depth];
+    this->pool_depth = queue_depth;
+    this->pool_head = 0;
+    this->pool_count = 0;
+    this->pool_exit = false;
+    pthread_mutex_init(&(this->pool_mutex), NULL);
+    pthread_cond_init(&(this->pool_not_empty), NULL);
+    pthread_cond_init(&(this->pool_not_full), NULL);
+
+    // Workers inherit the signal mask, so SIGINT is only attended by this
+    // thread, and only while waiting for clients (see Server::accept_client()).
+    threads = new Thread[workers];
+    Signal::block(SIGINT);
+    for (int i = 0; i < workers; i++) {
+        if (threads[i].create(Server::pool_run, this) != 0) {
+            break;
+        }
+        created++;
+    }
+
+    this->on_start();
+    while (!Server::exit && created > 0) {
+        if ( (client_sockfd = this->accept_client(this->socket.get_sockfd(), &client_addr)) == -1) {
+            continue;
+        }
+        this->on_new_client();
+        if (this->pool_push(client_sockfd, &client_addr, policy) == 0) {
+            continue;
+        }
+        if (policy == POOL_BUSY) {
+            Socket client_socket;
+            if (client_socket.init(client_sockfd, (struct sockaddr*) &client_addr) == 0) {
+                this->on_busy(client_socket);
+            }
+            shutdown(client_sockfd, SHUT_RDWR);
+        } else {
+            ::close(client_sockfd);
+        }
+    }
+
+    pthread_mutex_lock(&(this->pool_mutex));
+    this->pool_exit = true;
+    pthread_cond_broadcast(&(this->pool_not_empty));
+    pthread_mutex_unlock(&(this->pool_mutex));
+    for (int i = 0; i < created; i++) {
+        threads[i].join();
+    }
+    for (int i = 0; i < this->pool_count; i++) {
+        ::close(this->pool_queue[(this->pool_head + i) % this->pool_depth].sockfd);
+    }
+    delete[] threads;
+    delete[] this->pool_queue;
+    pthread_cond_destroy(&(this->pool_not_full));
+    pthread_cond_destroy(&(this->pool_not_empty));
+    pthread_mutex_destroy(&(this->pool_mutex));
+    Signal::unblock(SIGINT);
+    this->socket.close();
+    this->on_quit();
+}
+
+/// @brief Waits for a new client in a blocking manner, and accepts it. SIGINT
+///  must be blocked by the caller. It is only unblocked while waiting, so a
+///  SIGINT received right before blocking can't be missed.
+/// @param sockfd Listening socket file descriptor.
+/// @param addr Where the client address will be stored.
+/// @param wakeup_fd If not "-1", SIGINT is kept blocked, and the wait ends
+///  when this file descriptor becomes readable instead.
+/// @return The client socket file descriptor, or "-1" on error, if a signal
+///  was received, or if "wakeup_fd" is readable.
+int Server::accept_client(int sockfd, struct sockaddr_storage* addr, int wakeup_fd) {
+    struct pollfd pfd[2];
+    sigset_t mask;
+    socklen_t addrlen = sizeof(struct sockaddr_storage);
+    int client_sockfd;
+
+    pthread_sigmask(SIG_SETMASK, NULL, &mask);
+    if (wakeup_fd == -1) {
+        sigdelset(&mask, SIGINT);
+    }
+    pfd[0].fd = sockfd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = wakeup_fd;
+    pfd[1].events = POLLIN;
+    pfd[1].revents = 0;
+    if (ppoll(pfd, (wakeup_fd == -1) ? 1 : 2, NULL, &mask) == -1) {
+        if (errno != EINTR) {
+            perror(ERROR("ppoll in Server::accept_client"));
+        }
+        return -1;
+    }
+    if (pfd[1].revents != 0) {
+        return -1;
+    }
+    if ( (client_sockfd = accept(sockfd, (struct sockaddr*) addr, &addrlen)) == -1) {
+        if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror(WARNING("Couldn't accept a connection from a client"));
+        }
+        return -1;
+    }
+    return client_sockfd;
+}
+
+/// @brief Pool mode. Puts a new client in the queue.
+/// @param sockfd Client socket file descriptor, as returned by "accept()".
+/// @param addr Client address, as returned by "accept()".
+/// @param policy What to do if the queue is full (see Server::PoolPolicy).
+/// @return "0" if the client was queued, "-1" if it was rejected.
+int Server::pool_push(int sockfd, struct sockaddr_storage* addr, int policy) {
+    struct timespec timeout;
+    int tail;
+
+    pthread_mutex_lock(&(this->pool_mutex));
+    while (this->pool_count == this->pool_depth && policy == POOL_BLOCK && !Server::exit) {
+        // A timed wait, so that a SIGINT is noticed even if all workers are busy.
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_nsec += 100000000;
+        if (timeout.tv_nsec >= 1000000000) {
+            timeout.tv_sec++;
+            timeout.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&(this->pool_not_full), &(this->pool_mutex), &timeout);
+    }
+    if (this->pool_count == this->pool_depth) {
+        pthread_mutex_unlock(&(this->pool_mutex));
+        return -1;
+    }
+    tail = (this->pool_head + this->pool_count) % this->pool_depth;
+    this->pool_queue[tail].sockfd = sockfd;
+    this->pool_queue[tail].addr = *addr;
+    this->pool_count++;
+    pthread_cond_signal(&(this->pool_not_empty));
+    pthread_mutex_unlock(&(this->pool_mutex));
+    return 0;
+}
+
+/// @brief Pool mode. Function run by every worker. Takes clients from the
+///  queue and calls "on_accept()" until the server exits.
+/// @param arg Pointer to the server.
+void* Server::pool_run(void* arg) {
+    Server* server = (Server*) arg;
+    PoolEntry entry;
+
+    while (true) {
+        pthread_mutex_lock(&(server->pool_mutex));
+        while (server->pool_count == 0 && !server->pool_exit) {
+            pthread_cond_wait(&(server->pool_not_empty), &(server->pool_mutex));
+        }
+        if (server->pool_count == 0) {
+            pthread_mutex_unlock(&(server->pool_mutex));
+            break;
+        }
+        entry = server->pool_queue[server->pool_head];
+        server->pool_head = (server->pool_head + 1) % server->pool_depth;
+        server->pool_count--;
+        pthread_cond_signal(&(server->pool_not_full));
+        pthread_mutex_unlock(&(server->pool_mutex));
+
+        Socket client_socket;
+        if (client_socket.init(entry.sockfd, (struct sockaddr*) &(entry.addr)) == -1) {
+            continue;
+        }
+        server->on_accept(client_socket);
+        // The file descriptor is closed by the destructor. Closing it twice
+        // could close a connection accepted meanwhile with the same number.
+        shutdown(entry.sockfd, SHUT_RDWR);
+    }
+    return NULL;
+}
+
+/// @brief Starts the server in sharded mode, blocks operation. One listening
+///  socket is opened for each shard on the same IP and port with
+///  "SO_REUSEPORT", so the kernel balances new connections between them. Each
+///  shard runs its own accept loop on a thread, and calls "on_accept()" on that
+///  same thread, so a shard attends one client at a time and "on_accept()" must
+///  be thread safe. The server will keep running until a SIGINT is received,
+///  and then waits for every shard to finish with its current client.
+/// @param shards Amount of shards. If "0", one per online CPU.
+/// @param pin If "true", every shard is pinned to a different CPU.
+/// @param backlog Number of clients that can be put "on hold", per shard.
+void Server::start_sharded(int shards, bool pin, int backlog) {
+    char ip[INET6_ADDRSTRLEN], port[8];
+    int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int wakeup_fd;
+    Shard* shard;
+    Thread* threads;
+    int opened = 1;
+    int created = 0;
+    int yes = 1;
+
+    if (shards <= 0) {
+        shards = cpus;
+    }
+    this->backlog = backlog;
+    if ( (wakeup_fd = eventfd(0, 0)) == -1) {
+        perror(ERROR("eventfd in Server::start_sharded"));
+        return;
+    }
+    this->socket.get_my_ip(ip);
+    snprintf(port, sizeof(port), "%d", this->socket.get_my_port());
+    shard = new Shard[shards];
+    for (int i = 0; i < shards; i++) {
+        shard[i].server = this;
+        shard[i].wakeup_fd = wakeup_fd;
+        shard[i].socket = NULL;
+    }
+    shard[0].socket = &(this->socket);
+    // Only now the port is shared: until then, binding it again must fail.
+    if (setsockopt(this->socket.get_sockfd(), SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == -1) {
+        perror(ERROR("setsockopt in Server::start_sharded"));
+        shards = 1;
+    }
+    try {
+        for (opened = 1; opened < shards; opened++) {
+            shard[opened].socket = new Socket(ip, port, this->family, this->socktype, true, true);
+        }
+    } catch (std::runtime_error& e) {
+        fprintf(stderr, ERROR("Couldn't open the socket of every shard\n"));
+    }
+    for (int i = 0; i < opened; i++) {
+        if (listen(shard[i].socket->get_sockfd(), this->backlog) != 0) {
+            perror(ERROR("Couldn't start the server with listen"));
+            opened = 0;
+            break;
+        }
+    }
+
+    // Shards inherit the signal mask, so SIGINT is only attended by this thread.
+    threads = new Thread[shards];
+    Signal::block(SIGINT);
+    for (int i = 0; i < shards && opened == shards; i++) {
+        if (threads[i].create(Server::shard_run, &(shard[i])) != 0) {
+            break;
+        }
+        if (pin) {
+            threads[i].set_affinity(i % cpus);
+        }
+        created++;
+    }
+
+    this->on_start();
+    while (!Server::exit && created > 0) {
+        Signal::wait(SIGINT);
+    }
+    eventfd_write(wakeup_fd, 1);
+    for (int i = 0; i < created; i++) {
+        threads[i].join();
+    }
+    Signal::unblock(SIGINT);
+    for (int i = 1; i < shards; i++) {
+        delete shard[i].socket;
+    }
+    delete[] threads;
+    delete[] shard;
+    ::close(wakeup_fd);
+    this->socket.close();
+    this->on_quit();
+}
+
+/// @brief Sharded mode. Function run by every shard. Accepts clients on its
+///  own socket and calls "on_accept()", until the server exits.
+/// @param arg Pointer to the Server::Shard.
+void* Server::shard_run(void* arg) {
+    Shard* shard = (Shard*) arg;
+    struct sockaddr_storage client_addr;
+    int client_sockfd;
+
+    while (!Server::exit) {
+        if ( (client_sockfd = shard->server->accept_client(shard->socket->get_sockfd(), &client_addr, shard->wakeup_fd)) == -1) {
+            continue;
+        }
+        Socket client_socket;
+        if (client_socket.init(client_sockfd, (struct sockaddr*) &client_addr) == -1) {
+            continue;
+        }
+        shard->server->on_new_client();
+        shard->server->on_accept(client_socket);
+        // The file descriptor is closed by the destructor. Closing it twice
+        // could close a connection accepted meanwhile with the same number.
+        shutdown(client_sockfd, SHUT_RDWR);
+    }
+    return NULL;
+}
+
+/// @brief Starts the server in pre-fork mode, blocks operation. A fixed amount
+///  of worker processes is forked right away, and all of them accept clients
+///  from the same listening socket. Each worker calls "on_accept()" for many
+///  clients during its lifetime, so the fork is out of the path of every
+///  connection. If a worker dies, it is replaced by a new one. Workers that
+///  couldn't be forked are retried, waiting longer after every failure. The
+///  server will keep running until a SIGINT is received, and then waits for
+///  every worker to finish with its current client. It doesn't start if no
+///  worker can be forked.
+/// @param workers Amount of worker processes.
+/// @param backlog Number of clients that can be put "on hold".
+void Server::start_prefork(int workers, int backlog) {
+    pid_t* pids;
+    pid_t pid;
+    sigset_t mask;
+    struct timespec timeout;
+    long retry_ms = 10;
+    bool missing, started = false;
+
+    this->backlog = backlog;
+    if (listen(this->socket.get_sockfd(), this->backlog) != 0) {
+        perror(ERROR("Couldn't start the server with listen"));
+        return;
+    }
+    // All workers are woken up when a client arrives, but only one accepts it.
+    // Accepted sockets don't inherit O_NONBLOCK.
+    if (this->socket.set_nonblocking() != 0) {
+        return;
+    }
+    // Workers are waited for to replace them, so SIGCHLD can't be ignored.
+    // Both signals are only attended while waiting, with "sigsuspend()".
+    Signal::block(SIGINT);
+    Signal::block(SIGCHLD);
+    Signal::set_handler(SIGCHLD, &Server::child_exited);
+    pthread_sigmask(SIG_SETMASK, NULL, &mask);
+    sigdelset(&mask, SIGINT);
+    sigdelset(&mask, SIGCHLD);
+
+    pids = new pid_t[workers];
+    for (int i = 0; i < workers; i++) {
+        pids[i] = this->prefork_spawn();
+        started = started || pids[i] > 0;
+    }
+    if (!started) {
+        fprintf(stderr, ERROR("no worker could be created in Server::start_prefork\n"));
+        delete[] pids;
+        Signal::ignore(SIGCHLD);
+        Signal::unblock(SIGCHLD);
+        Signal::unblock(SIGINT);
+        return;
+    }
+    this->on_start();
+    while (!Server::exit) {
+        while ( (pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+            for (int i = 0; i < workers; i++) {
+                if (pids[i] == pid) {
+                    pids[i] = -1;
+                }
+            }
+        }
+        // Replace the dead workers, and retry the ones that couldn't be forked.
+        missing = false;
+        for (int i = 0; i < workers && !Server::exit; i++) {
+            if (pids[i] == -1 && (pids[i] = this->prefork_spawn()) == -1) {
+                missing = true;
+            }
+        }
+        if (Server::exit) {
+            break;
+        }
+        if (!missing) {
+            retry_ms = 10;
+            sigsuspend(&mask);
+        } else {
+            // Like sigsuspend(), but it also returns after "retry_ms".
+            timeout.tv_sec = retry_ms / 1000;
+            timeout.tv_nsec = (retry_ms % 1000) * 1000000L;
+            ppoll(NULL, 0, &timeout, &mask);
+            retry_ms = (2 * retry_ms > SERVER_RESPAWN_MAX_MS) ? SERVER_RESPAWN_MAX_MS : 2 * retry_ms;
+        }
+    }
+
+    for (int i = 0; i < workers; i++) {
+        if (pids[i] > 0) {
+            Signal::kill(pids[i], SIGINT);
+        }
+    }
+    for (int i = 0; i < workers; i++) {
+        if (pids[i] > 0) {
+            waitpid(pids[i], NULL, 0);
+        }
+    }
+    delete[] pids;
+    Signal::ignore(SIGCHLD);
+    Signal::unblock(SIGCHLD);
+    Signal::unblock(SIGINT);
+    this->socket.close();
+    this->on_quit();
+}
+
+/// @brief Pre-fork mode. Forks a worker, that accepts clients and calls
+///  "on_accept()" until the server exits.
+/// @return The worker PID, or "-1" on error.
+pid_t Server::prefork_spawn(void) {
+    struct sockaddr_storage client_addr;
+    int client_sockfd;
+    pid_t pid;
+
+    if ( (pid = fork()) == -1) {
+        perror(ERROR("fork in Server::start_prefork. Failed to create worker"));
+        return -1;
+    } else if (pid > 0) {
+        return pid;
+    }
+    Signal::ignore(SIGCHLD);
+    Signal::unblock(SIGCHLD);
+    while (!Server::exit) {
+        if ( (client_sockfd = this->accept_client(this->socket.get_sockfd(), &client_addr)) == -1) {
+            continue;
+        }
+        Socket client_socket;
+        if (client_socket.init(client_sockfd, (struct sockaddr*) &client_addr) == -1) {
+            continue;
+        }
+        this->on_new_client();
+        this->on_accept(client_socket);
+        client_socket.close();
+    }
+    ::exit(0);
+}
+
+/// @brief Starts the server in io_uring mode, blocks operation. All clients
+///  are attended in this same process, as in Server::start_reactor(), but
+///  instead of waiting for readiness and making one system call per operation,
+///  clients are accepted and read with "multishot" operations, and received
+///  data is stored in buffers provided to the kernel. All operations of an
+///  iteration, including Server::send_async(), are submitted with a single
+///  system call, that also waits for the next completions. Received data is
+///  passed to "on_data()". If "io_uring" is not available, it falls back to
+///  Server::start_reactor(). The server will keep running until a SIGINT is
+///  received.
+/// @param backlog Number of clients that can be put "on hold".
+void Server::start_uring(int backlog) {
+    struct io_uring_cqe cqes[SERVER_MAX_EVENTS];
+    std::vector<Socket*> open_clients;
+    sigset_t mask;
+    int n;
+
+    if (Uring::is_supported()) {
+        try {
+            this->uring = new Uring(SERVER_MAX_EVENTS);
+            if (this->uring->set_buffers(SERVER_URING_BUFFERS, SERVER_BUFFER_SIZE) != 0) {
+                delete this->uring;
+                this->uring = NULL;
+            }
+        } catch (std::runtime_error& e) {
+            this->uring = NULL;
+        }
+    }
+    if (this->uring == NULL) {
+        fprintf(stderr, WARNING("io_uring is not available, using epoll instead\n"));
+        this->start_reactor(backlog);
+        return;
+    }
+
+    this->backlog = backlog;
+    this->uring_multishot = true;
+    this->uring_conns = 0;
+    if (listen(this->socket.get_sockfd(), this->backlog) != 0) {
+        perror(ERROR("Couldn't start the server with listen"));
+        delete this->uring;
+        this->uring = NULL;
+        return;
+    }
+    this->uring->accept(this->socket.get_sockfd(), URING_ACCEPT);
+    // SIGINT is only unblocked while waiting for completions.
+    Signal::block(SIGINT);
+    pthread_sigmask(SIG_SETMASK, NULL, &mask);
+    sigdelset(&mask, SIGINT);
+    this->on_start();
+    while (!Server::exit) {
+        if (this->uring->submit(1, &mask) == -1) {
+            continue;
+        }
+        n = this->uring->get_completions(cqes, SERVER_MAX_EVENTS);
+        for (int i = 0; i < n; i++) {
+            this->uring_complete(&cqes[i]);
+        }
+    }
+    // Clients are freed when their pending operations complete.
+    open_clients.assign(this->clients.begin(), this->clients.end());
+    for (size_t i = 0; i < open_clients.size(); i++) {
+        this->close_client(*open_clients[i]);
+    }
+    while (this->uring_conns > 0) {
+        if (this->uring->submit(1, &mask) == -1) {
+            continue;
+        }
+        n = this->uring->get_completions(cqes, SERVER_MAX_EVENTS);
+        for (int i = 0; i < n; i++) {
+            this->uring_complete(&cqes[i]);
+        }
+    }
+    delete this->uring;
+    this->uring = NULL;
+    Signal::unblock(SIGINT);
+    this->socket.close();
+    this->on_quit();
+}
+
+/// @brief io_uring mode. Attends a completion.
+/// @param cqe Completion, with the operation type in the lower bits of
+///  "user_data", and a pointer to the operation data in the rest.
+void Server::uring_complete(struct io_uring_cqe* cqe) {
+    int type = cqe->user_data & URING_TYPE_MASK;
+    void* ptr = (void*) (uintptr_t) (cqe->user_data & ~((uint64_t) URING_TYPE_MASK));
+    bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+    struct sockaddr_storage client_addr;
+    socklen_t addrlen = sizeof(struct sockaddr_storage);
+    unsigned short buffer_id;
+    UringConn* conn = NULL;
+    UringSend* op;
+    bool open;
+
+    if (type == URING_ACCEPT) {
+        if (!more && !Server::exit) {
+            this->uring->accept(this->socket.get_sockfd(), URING_ACCEPT);
+        }
+        if (cqe->res < 0) {
+            fprintf(stderr, WARNING("Couldn't accept a connection from a client: %s\n"), strerror(-cqe->res));
+            return;
+        }
+        if (Server::exit) {
+            ::close(cqe->res);
+            return;
+        }
+        conn = new UringConn;
+        conn->pending = 0;
+        if (getpeername(cqe->res, (struct sockaddr*) &client_addr, &addrlen) == -1 ||
+                conn->socket.init(cqe->res, (struct sockaddr*) &client_addr) == -1) {
+            ::close(cqe->res);
+            delete conn;
+            return;
+        }
+        this->uring_conns++;
+        this->clients.insert(&(conn->socket));
+        this->on_new_client();
+        this->uring_recv(conn);
+    } else if (type == URING_RECV) {
+        conn = (UringConn*) ptr;
+        open = this->clients.count(&(conn->socket)) > 0;
+        if (!more) {
+            conn->pending--;
+        }
+        if (cqe->res > 0) {
+            buffer_id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            if (open && this->on_data(conn->socket, this->uring->get_buffer(buffer_id), cqe->res) != 0) {
+                this->close_client(conn->socket);
+                open = false;
+            }
+            this->uring->recycle_buffer(buffer_id);
+            if (open && !more) {
+                this->uring_recv(conn);
+            }
+        } else if (open && cqe->res == -ENOBUFS) {
+            // All buffers were in use. They were recycled meanwhile.
+            this->uring_recv(conn);
+        } else if (open && cqe->res == -EINVAL && this->uring_multishot) {
+            // Multishot "recv()" needs Linux 6.0.
+            this->uring_multishot = false;
+            this->uring_recv(conn);
+        } else if (open) {
+            this->close_client(conn->socket);
+        }
+    } else if (type == URING_SEND) {
+        op = (UringSend*) ptr;
+        conn = op->conn;
+        conn->pending--;
+        open = this->clients.count(&(conn->socket)) > 0;
+        if (open && cqe->res > 0 && op->sent + cqe->res < op->len) {
+            op->sent += cqe->res;
+            if (this->uring->send(conn->socket.get_sockfd(), op->data + op->sent, op->len - op->sent, cqe->user_data) == 0) {
+                conn->pending++;
+                return;
+            }
+            this->close_client(conn->socket);
+        } else if (open && cqe->res < 0) {
+            this->close_client(conn->socket);
+        }
+        free(op->data);
+        delete op;
+    }
+    if (conn != NULL && conn->pending == 0 && this->clients.count(&(conn->socket)) == 0) {
+        delete conn;
+        this->uring_conns--;
+    }
+}
+
+/// @brief io_uring mode. Queues a "recv()" for a client.
+void Server::uring_recv(UringConn* conn) {
+    if (this->uring->recv(conn->socket.get_sockfd(), (uint64_t) (uintptr_t) conn | URING_RECV, this->uring_multishot) != 0) {
+        this->close_client(conn->socket);
+        return;
+    }
+    conn->pending++;
+}
+
 /// @brief Returns the socket
 Socket& Server::get_socket(void) {
     return this->socket;
@@ -64,3 +970,7 @@ Socket& Server::get_socket(void) {
 void Server::leave(int) {
     Server::exit = true;
 }
+
+/// @brief Handler for SIGCHLD signal in pre-fork mode. Does nothing, the dead
+///  workers are waited for in Server::start_prefork().
+void Server::child_exited(int) {}
@@ -0,0 +1,173 @@
+#include "shm_arena.h"
+
+#define SHM_ARENA_MAGIC     0x41524e41  // "ARNA"
+
+/// @brief Size class of a block of "size" bytes, or CLASSES if it's large.
+static int get_class(size_t size) {
+    int size_class = 0;
+    if (size > SHM_ARENA_MAX_SMALL) {
+        return ShmArena::CLASSES;
+    }
+    while (((size_t) SHM_ARENA_ALIGN << size_class) < size) {
+        size_class++;
+    }
+    return size_class;
+}
+
+/******************************************************************************
+ * Constructors and initialization
+******************************************************************************/
+
+/// @brief Creates or connects to an arena.
+/// @param path Any file path. Identifies the arena.
+/// @param id Any number. Identifies the arena.
+/// @param size If "> 0", create the arena, with a shared memory of "size"
+///  bytes (including a small header). If "0", connect to an existing one.
+/// @param flags SharedMemory backend and page options (see SharedMemory). All
+///  processes must use the same backend. With SHMEM_MEMFD, the arena is only
+///  shared with children forked afterwards.
+/// @return On error, std::runtime_error() is thrown. Also if the memory
+///  doesn't hold an arena, or its creator doesn't finish it in time.
+ShmArena::ShmArena(const char* path, int id, size_t size, int flags):
+    shm(path, id, (size) ? ((size > sizeof(Header)) ? size : sizeof(Header) + SHM_ARENA_ALIGN) : 0, flags) {
+    this->header = (Header*) &(this->shm[0]);
+    if (size) {
+        memset((void*) this->header, 0, sizeof(Header));
+        this->header->size = this->shm.get_size();
+        this->header->top = (sizeof(Header) + SHM_ARENA_ALIGN - 1) & ~((uint64_t) SHM_ARENA_ALIGN - 1);
+        this->header->magic.store(SHM_ARENA_MAGIC, std::memory_order_release);
+    } else if (this->shm.get_size() < sizeof(Header) ||
+               shm_wait_ready(this->header->magic, SHM_ARENA_MAGIC) == -1) {
+        perror(ERROR("not an arena in ShmArena::ShmArena"));
+        throw(std::runtime_error("magic"));
+    }
+}
+
+/// @brief Checks if the arena exists.
+/// @param backend SHMEM_SYSV (default) or SHMEM_POSIX.
+bool ShmArena::exists(const char* path, int id, int backend) {
+    return SharedMemory<char>::exists(path, id, backend);
+}
+
+/******************************************************************************
+ * Allocation
+******************************************************************************/
+
+/// @brief Allocates a block of at least "size" bytes, aligned to SHM_ARENA_ALIGN.
+/// @return The block, or NULL if there's no room for it (errno ENOMEM).
+void* ShmArena::allocate(size_t size) {
+    return allocate(this->header, size);
+}
+
+/// @brief Frees a block returned by ShmArena::allocate(), in any process.
+void ShmArena::deallocate(void* ptr) {
+    deallocate(this->header, ptr);
+}
+
+/// @brief Allocates a block in the arena of "header". Used by ShmAllocator,
+///  which only knows the header.
+void* ShmArena::allocate(Header* header, size_t size) {
+    char* base = (char*) header;
+    int size_class = get_class(size ? size : 1);
+    uint64_t* best = NULL;
+    Block* block = NULL;
+
+    // Larger than the whole arena: also keeps the rounding from overflowing.
+    if (size > header->size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (size_class < CLASSES) {
+        size = (size_t) SHM_ARENA_ALIGN << size_class;
+    } else {
+        size = (size + SHM_ARENA_ALIGN - 1) & ~((size_t) SHM_ARENA_ALIGN - 1);
+    }
+    Futex::lock(header->lock);
+    if (size_class < CLASSES && header->free[size_class]) {
+        block = (Block*) (base + header->free[size_class]);
+        header->free[size_class] = *(uint64_t*) (block + 1);
+    } else if (size_class == CLASSES) {
+        // Best fit: the smallest free large block that's big enough.
+        for (uint64_t* next = &(header->large_free); *next;
+             next = (uint64_t*) ((Block*) (base + *next) + 1)) {
+            Block* candidate = (Block*) (base + *next);
+            if (candidate->size >= size && (best == NULL || candidate->size < ((Block*) (base + *best))->size)) {
+                best = next;
+            }
+        }
+        if (best != NULL) {
+            block = (Block*) (base + *best);
+            *best = *(uint64_t*) (block + 1);
+        }
+    }
+    if (block == NULL) {
+        if (header->top + sizeof(Block) + size > header->size) {
+            Futex::unlock(header->lock);
+            errno = ENOMEM;
+            return NULL;
+        }
+        block = (Block*) (base + header->top);
+        block->size = size;
+        block->size_class = size_class;
+        header->top += sizeof(Block) + size;
+    }
+    header->used += block->size;
+    Futex::unlock(header->lock);
+    return (void*) (block + 1);
+}
+
+/// @brief Frees a block in the arena of "header". NULL is ignored.
+void ShmArena::deallocate(Header* header, void* ptr) {
+    char* base = (char*) header;
+    Block* block = (Block*) ptr - 1;
+    uint64_t* list;
+    if (ptr == NULL) {
+        return;
+    }
+    list = (block->size_class < CLASSES) ? &(header->free[block->size_class]) : &(header->large_free);
+    Futex::lock(header->lock);
+    *(uint64_t*) ptr = *list;
+    *list = (char*) block - base;
+    header->used -= block->size;
+    Futex::unlock(header->lock);
+}
+
+/******************************************************************************
+ * Root object and information
+******************************************************************************/
+
+/// @brief Stores the object other processes start from, usually a container
+///  or the head of a linked structure built in the arena.
+/// @param object An object inside the arena, or NULL.
+void ShmArena::set_root(void* object) {
+    uint64_t offset = (object) ? (char*) object - (char*) this->header : 0;
+    __atomic_store_n(&(this->header->root), offset, __ATOMIC_RELEASE);
+}
+
+/// @brief Returns the root object, in this process' mapping, or NULL if it
+///  wasn't set.
+void* ShmArena::get_root(void) const {
+    uint64_t offset = __atomic_load_n(&(this->header->root), __ATOMIC_ACQUIRE);
+    return (offset) ? (char*) this->header + offset : NULL;
+}
+
+/// @brief Returns the size of the arena, in bytes.
+size_t ShmArena::get_size(void) const {
+    return this->header->size;
+}
+
+/// @brief Returns the bytes in allocated blocks, after rounding their size.
+size_t ShmArena::get_used(void) const {
+    return __atomic_load_n(&(this->header->used), __ATOMIC_RELAXED);
+}
+
+/// @brief Checks if "ptr" points inside the arena, in this process' mapping.
+bool ShmArena::contains(const void* ptr) const {
+    const char* base = (const char*) this->header;
+    return (const char*) ptr >= base && (const char*) ptr < base + this->header->size;
+}
+
+/// @brief Returns the header of the arena, in this process' mapping.
+ShmArena::Header* ShmArena::get_header(void) const {
+    return this->header;
+}
@@ -18,8 +18,11 @@
 ///  * SOCK_DGRAM;  For UDP.
 /// @param server If "true", this socket will be opened to be used as a server.
 ///  If "false", it will be used to connect to other socket.
+/// @param reuseport Only for servers. If "true", other sockets with this same
+///  option can be bound to the same IP and port, and the kernel will balance
+///  the incoming connections between them (default "false").
 /// @return Might throw std::runtime_error on error.
-Socket::Socket(const char* ip, const char* port, int family, int socktype, bool server) {
+Socket::Socket(const char* ip, const char* port, int family, int socktype, bool server, bool reuseport) {
     struct addrinfo hints;
     struct addrinfo* res, *p;
     int yes=1;
@@ -43,6 +46,11 @@ Socket::Socket(const char* ip, const char* port, int family, int socktype, bool
                 ::close(this->sockfd);
                 continue;
             }
+            if (reuseport && setsockopt(this->sockfd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes) ) == -1) {
+                perror(WARNING("setsockopt in Socket::Socket. Trying to share port"));
+                ::close(this->sockfd);
+                continue;
+            }
             if (bind(this->sockfd, p->ai_addr, p->ai_addrlen) == -1) {
                 perror(WARNING("bind in Socket::Socket"));
                 ::close(this->sockfd);
@@ -84,6 +92,22 @@ Socket::Socket(const Socket &socket) {
     this->peer_port = socket.get_peer_port();
 }
 
+/// @brief Copy assignment. Same as the copy constructor: the file descriptor
+///  is shared, but not the zero-copy sends waiting for completion, which are
+///  dropped from this object.
+Socket& Socket::operator=(const Socket& socket) {
+    if (this != &socket) {
+        this->sockfd = socket.get_sockfd();
+        socket.get_my_ip(this->my_ip);
+        this->my_port = socket.get_my_port();
+        socket.get_peer_ip(this->peer_ip);
+        this->peer_port = socket.get_peer_port();
+        this->zc_pending.reset();
+        this->zc_next_id = 0;
+    }
+    return *this;
+}
+
 /// @brief Empty constructor. Must call Socket::init(). Used after a successful
 ///  call to "accept".
 Socket::Socket() {}
@@ -158,6 +182,24 @@ void Socket::close(void) {
     }
 }
 
+/// @brief Sets the socket as non-blocking. Reads and writes that can't be
+///  completed right away will return "-1" with "errno" set to "EAGAIN".
+/// @param enable "true" to set non-blocking mode, "false" to set blocking.
+/// @return "0" on success, "-1" on error.
+int Socket::set_nonblocking(bool enable) {
+    int flags;
+    if ( (flags = fcntl(this->sockfd, F_GETFL, 0)) == -1) {
+        perror(ERROR("fcntl in Socket::set_nonblocking"));
+        return -1;
+    }
+    flags = (enable) ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    if (fcntl(this->sockfd, F_SETFL, flags) == -1) {
+        perror(ERROR("fcntl in Socket::set_nonblocking"));
+        return -1;
+    }
+    return 0;
+}
+
 /******************************************************************************
  * Read and write functions
 ******************************************************************************/
@@ -167,13 +209,21 @@ void Socket::close(void) {
 /// @param len Length of the message in bytes.
 /// @param flags See "man send" for all possible flags ("0" by default).
 /// @return Amount of bytes sent, or "-1" on error. If the socket was closed
-///  by the peer, it will raise the signal "SIGPIPE".
+///  by the peer, it will raise the signal "SIGPIPE". On a non-blocking socket,
+///  it might return less than "len" bytes, or "-1" with "errno" set to "EAGAIN"
+///  if nothing could be sent.
 int Socket::write(void* msg, int len, int flags) {
     int bytes_sent = 0;
     int aux;
     do {
         // Don't generate SIGPIPE, return with -1 if peer was closed
-        if ( (aux = send(this->sockfd, msg, len, flags | MSG_NOSIGNAL) ) == -1) {
+        if ( (aux = send(this->sockfd, (char*) msg + bytes_sent, len - bytes_sent, flags | MSG_NOSIGNAL) ) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (bytes_sent == 0) {
+                    bytes_sent = -1;
+                }
+                break;
+            }
             perror(ERROR("send in Socket::write"));
             bytes_sent = aux;
             break;
@@ -188,11 +238,12 @@ int Socket::write(void* msg, int len, int flags) {
 /// @param len Length of the buffer "msg".
 /// @param flags See "man recv" ("0" by default).
 /// @return The amount of bytes received. "0" if the connection was closed
-///  correctly from the other end, or "-1" on error.
+///  correctly from the other end, or "-1" on error. On a non-blocking socket,
+///  "-1" with "errno" set to "EAGAIN" means that there is no data available.
 int Socket::read(void* msg, int len, int flags) {
     int bytes_read = 0;
     bytes_read = recv(this->sockfd, msg, len, flags);
-    if ( bytes_read == -1 ) {
+    if ( bytes_read == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
         perror(ERROR("recv in Socket::read"));
     } // else if (bytes_read == 0) {
     //     fprintf(stderr, INFO("The other socket was closed gracefully, or a zero length message was sent.\n"));
@@ -200,6 +251,422 @@ int Socket::read(void* msg, int len, int flags) {
     return bytes_read;
 }
 
+/// @brief Writes to the socket from several buffers, as if they were a single
+///  contiguous one (gather). Nothing is copied in user space.
+/// @param iov Buffers to send, in order.
+/// @param iovcnt Number of buffers. At most IOV_MAX.
+/// @param flags See "man send" for all possible flags ("0" by default).
+/// @return Amount of bytes sent, or "-1" on error. Same as Socket::write(),
+///  on a non-blocking socket it might send less than the total length.
+int Socket::writev(const struct iovec* iov, int iovcnt, int flags) {
+    struct msghdr msg;
+    int bytes_sent = 0;
+    int aux, i = 0;
+    size_t len;
+    while (i < iovcnt) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (struct iovec*) iov + i;
+        msg.msg_iovlen = iovcnt - i;
+        if ( (aux = sendmsg(this->sockfd, &msg, flags | MSG_NOSIGNAL)) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return (bytes_sent == 0) ? -1 : bytes_sent;
+            }
+            perror(ERROR("sendmsg in Socket::writev"));
+            return -1;
+        }
+        bytes_sent += aux;
+        // Skip the buffers fully sent, and finish the one sent partially.
+        for (len = aux; i < iovcnt && len >= iov[i].iov_len; i++) {
+            len -= iov[i].iov_len;
+        }
+        if (i < iovcnt && len > 0) {
+            if ( (aux = this->write((char*) iov[i].iov_base + len, iov[i].iov_len - len, flags)) == -1) {
+                return bytes_sent;
+            }
+            bytes_sent += aux;
+            if ((size_t) aux < iov[i].iov_len - len) {
+                return bytes_sent;
+            }
+            i++;
+        }
+    }
+    return bytes_sent;
+}
+
+/// @brief Reads from the socket into several buffers, filling them in order
+///  (scatter), with a single syscall.
+/// @param iov Buffers where the data will be stored.
+/// @param iovcnt Number of buffers. At most IOV_MAX.
+/// @param flags See "man recv" for all possible flags ("0" by default).
+/// @return Amount of bytes read, "0" if the peer closed the connection, or
+///  "-1" on error.
+int Socket::readv(const struct iovec* iov, int iovcnt, int flags) {
+    struct msghdr msg;
+    int bytes_read;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec*) iov;
+    msg.msg_iovlen = iovcnt;
+    if ( (bytes_read = recvmsg(this->sockfd, &msg, flags)) == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror(ERROR("recvmsg in Socket::readv"));
+    }
+    return bytes_read;
+}
+
+/// @brief Sends many datagrams (SOCK_DGRAM), up to SOCKET_BATCH_MAX per
+///  syscall.
+/// @param datagrams One buffer per datagram.
+/// @param count Number of datagrams.
+/// @param addrs Destination of each datagram, as returned by
+///  Socket::read_batch(). If NULL, they are sent to the connected peer.
+/// @param flags See "man send" for all possible flags ("0" by default).
+/// @return Number of datagrams sent, or "-1" on error. On a non-blocking
+///  socket, it might be less than "count".
+int Socket::write_batch(const struct iovec* datagrams, int count, const struct sockaddr_storage* addrs, int flags) {
+    struct mmsghdr msgs[SOCKET_BATCH_MAX];
+    int sent = 0;
+    int batch, aux, i;
+    while (sent < count) {
+        batch = (count - sent < SOCKET_BATCH_MAX) ? count - sent : SOCKET_BATCH_MAX;
+        memset(msgs, 0, batch * sizeof(struct mmsghdr));
+        for (i = 0; i < batch; i++) {
+            msgs[i].msg_hdr.msg_iov = (struct iovec*) &datagrams[sent + i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            if (addrs != NULL) {
+                msgs[i].msg_hdr.msg_name = (void*) &addrs[sent + i];
+                msgs[i].msg_hdr.msg_namelen = (addrs[sent + i].ss_family == AF_INET) ?
+                    sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+            }
+        }
+        if ( (aux = sendmmsg(this->sockfd, msgs, batch, flags | MSG_NOSIGNAL)) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return (sent == 0) ? -1 : sent;
+            }
+            perror(ERROR("sendmmsg in Socket::write_batch"));
+            return -1;
+        }
+        sent += aux;
+    }
+    return sent;
+}
+
+/// @brief Receives many datagrams (SOCK_DGRAM) with a single syscall. It
+///  waits for the first one, and then takes all the ones already queued.
+/// @param datagrams One buffer per datagram. The "iov_len" of each one is
+///  updated with the size of the datagram received in it.
+/// @param count Number of buffers. At most SOCKET_BATCH_MAX are used.
+/// @param addrs If not NULL, where the sender of each datagram is stored.
+/// @param flags See "man recv" for all possible flags ("0" by default).
+/// @return Number of datagrams received, or "-1" on error.
+int Socket::read_batch(struct iovec* datagrams, int count, struct sockaddr_storage* addrs, int flags) {
+    struct mmsghdr msgs[SOCKET_BATCH_MAX];
+    int received, i;
+    if (count > SOCKET_BATCH_MAX) {
+        count = SOCKET_BATCH_MAX;
+    }
+    memset(msgs, 0, count * sizeof(struct mmsghdr));
+    for (i = 0; i < count; i++) {
+        msgs[i].msg_hdr.msg_iov = &datagrams[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (addrs != NULL) {
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        }
+    }
+    if ( (received = recvmmsg(this->sockfd, msgs, count, flags | MSG_WAITFORONE, NULL)) == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror(ERROR("recvmmsg in Socket::read_batch"));
+        }
+        return -1;
+    }
+    for (i = 0; i < received; i++) {
+        datagrams[i].iov_len = msgs[i].msg_len;
+    }
+    return received;
+}
+
+/// @brief Sends part of a file straight from the page cache, without copying
+///  it to user space ("sendfile()").
+/// @param fd File descriptor of the file, opened for reading.
+/// @param offset Position in the file of the first byte to send. The file
+///  position of "fd" is not changed.
+/// @param len Number of bytes to send.
+/// @return Amount of bytes sent, or "-1" on error. It's less than "len" if the
+///  file ends first, or if the socket is non-blocking and it would block
+///  ("-1" with "errno" set to "EAGAIN" if nothing was sent). To resume, call
+///  it again with "offset" and "len" advanced by the amount already sent.
+///  If the peer closed the connection, it fails with EPIPE without raising
+///  SIGPIPE.
+ssize_t Socket::send_file(int fd, off_t offset, size_t len) {
+    sigset_t mask, old_mask;
+    ssize_t bytes_sent = 0, aux;
+    Socket::block_sigpipe(&mask, &old_mask);
+    while ((size_t) bytes_sent < len) {
+        if ( (aux = sendfile(this->sockfd, fd, &offset, len - bytes_sent)) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (bytes_sent == 0) {
+                    bytes_sent = -1;
+                }
+                break;
+            }
+            perror(ERROR("sendfile in Socket::send_file"));
+            bytes_sent = -1;
+            break;
+        }
+        if (aux == 0) {
+            break;  // End of file.
+        }
+        bytes_sent += aux;
+    }
+    Socket::restore_sigpipe(&mask, &old_mask);
+    return bytes_sent;
+}
+
+/// @brief Forwards data between two connected sockets in both directions, in
+///  kernel space ("splice()" through a pipe per direction), until both
+///  directions are closed. When one peer stops sending, the other one is
+///  notified with a "shutdown(SHUT_WR)" once all its data was forwarded.
+///  Works with both blocking and non-blocking sockets.
+/// @param a First socket.
+/// @param b Second socket.
+/// @return Total amount of bytes forwarded, or "-1" on error.
+ssize_t Socket::proxy(Socket& a, Socket& b) {
+    Socket* src[2] = {&a, &b};
+    Socket* dst[2] = {&b, &a};
+    int pipes[2][2] = {{-1, -1}, {-1, -1}};
+    size_t pending[2] = {0, 0};
+    bool open[2] = {true, true};
+    bool shut[2] = {false, false};
+    struct pollfd fds[4];
+    sigset_t mask, old_mask;
+    ssize_t total = 0, aux;
+    int i;
+    if (pipe2(pipes[0], O_NONBLOCK) == -1 || pipe2(pipes[1], O_NONBLOCK) == -1) {
+        perror(ERROR("pipe2 in Socket::proxy"));
+        for (i = 0; i < 2; i++) {
+            if (pipes[i][0] != -1) {
+                ::close(pipes[i][0]);
+                ::close(pipes[i][1]);
+            }
+        }
+        return -1;
+    }
+    Socket::block_sigpipe(&mask, &old_mask);
+    while (open[0] || open[1] || pending[0] > 0 || pending[1] > 0) {
+        // Wait to read from a source while its pipe is empty, and to write to
+        // a destination while there is data in its pipe.
+        for (i = 0; i < 2; i++) {
+            fds[2*i].fd = (open[i] && pending[i] == 0) ? src[i]->sockfd : -1;
+            fds[2*i].events = POLLIN;
+            fds[2*i + 1].fd = (pending[i] > 0) ? dst[i]->sockfd : -1;
+            fds[2*i + 1].events = POLLOUT;
+        }
+        if (poll(fds, 4, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror(ERROR("poll in Socket::proxy"));
+            total = -1;
+            break;
+        }
+        for (i = 0; i < 2; i++) {
+            if (fds[2*i].fd != -1 && fds[2*i].revents != 0) {
+                aux = splice(src[i]->sockfd, NULL, pipes[i][1], NULL,
+                    SOCKET_SPLICE_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (aux > 0) {
+                    pending[i] += aux;
+                } else if (aux == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    open[i] = false;
+                }
+            }
+            if (fds[2*i + 1].fd != -1 && fds[2*i + 1].revents != 0) {
+                aux = splice(pipes[i][0], NULL, dst[i]->sockfd, NULL,
+                    pending[i], SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (aux > 0) {
+                    pending[i] -= aux;
+                    total += aux;
+                } else if (aux == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    // Destination gone, the data in this direction is lost.
+                    open[i] = false;
+                    pending[i] = 0;
+                }
+            }
+            if (!open[i] && pending[i] == 0 && !shut[i]) {
+                shutdown(dst[i]->sockfd, SHUT_WR);
+                shut[i] = true;
+            }
+        }
+    }
+    Socket::restore_sigpipe(&mask, &old_mask);
+    for (i = 0; i < 2; i++) {
+        ::close(pipes[i][0]);
+        ::close(pipes[i][1]);
+    }
+    return total;
+}
+
+/// @brief Enables zero-copy sends (SO_ZEROCOPY), needed before calling
+///  Socket::write_zerocopy(). Only worth it for large buffers (tens of KB or
+///  more): pinning the pages and handling the notification cost more than
+///  copying small ones.
+/// @param enable "true" to enable, "false" to disable.
+/// @return "0" on success, "-1" on error.
+int Socket::set_zerocopy(bool enable) {
+    int value = enable;
+    if (setsockopt(this->sockfd, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value)) == -1) {
+        perror(ERROR("setsockopt in Socket::set_zerocopy"));
+        return -1;
+    }
+    if (enable && !this->zc_pending) {
+        this->zc_pending.reset(new std::deque<ZeroCopyBuffer>());
+    }
+    return 0;
+}
+
+/// @brief Writes to the socket without copying the data into the kernel
+///  (MSG_ZEROCOPY). The buffer is lent to the kernel, and it must not be
+///  modified nor freed until its completion is received through
+///  Socket::reap_zerocopy(), which then calls "callback".
+/// @param msg Message to send. It must stay valid until the callback.
+/// @param len Length of the message in bytes.
+/// @param callback Called when the buffer can be reused (NULL for none).
+/// @param arg Passed to the callback.
+/// @return Amount of bytes sent, or "-1" on error (EINVAL if
+///  Socket::set_zerocopy() wasn't called). Same as Socket::write(), on a
+///  non-blocking socket it might be less than "len", and then only the part
+///  sent is owned by the kernel. If the kernel runs out of memory to pin pages
+///  (ENOBUFS), completions are reaped and the send is retried.
+int Socket::write_zerocopy(const void* msg, int len, zerocopy_callback callback, void* arg) {
+    ZeroCopyBuffer pending;
+    uint32_t first_id = this->zc_next_id;
+    int bytes_sent = 0;
+    int aux;
+    if (!this->zc_pending) {
+        errno = EINVAL;
+        return -1;
+    }
+    while (bytes_sent < len) {
+        if ( (aux = send(this->sockfd, (const char*) msg + bytes_sent, len - bytes_sent, MSG_ZEROCOPY | MSG_NOSIGNAL)) == -1) {
+            if (errno == ENOBUFS && this->reap_zerocopy(-1) > 0) {
+                continue;   // Too many pages pinned, wait for completions.
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            perror(ERROR("send in Socket::write_zerocopy"));
+            break;
+        }
+        // Each successful call gets the next notification id.
+        this->zc_next_id++;
+        bytes_sent += aux;
+    }
+    if (bytes_sent == 0) {
+        return -1;
+    }
+    pending.buf = msg;
+    pending.len = bytes_sent;
+    pending.first_id = first_id;
+    pending.last_id = this->zc_next_id - 1;
+    pending.remaining = this->zc_next_id - first_id;
+    pending.copied = false;
+    pending.callback = callback;
+    pending.arg = arg;
+    this->zc_pending->push_back(pending);
+    return bytes_sent;
+}
+
+/// @brief Reads zero-copy completion notifications from the socket error
+///  queue, and calls the callback of every buffer that can be reused. The
+///  notified ranges of ids can come in any order, and a buffer sent with
+///  several calls is released once all of them completed.
+/// @param timeout_ms Milliseconds to wait for a notification if none is
+///  queued: "0" to return right away, "-1" to wait until the next one.
+/// @return Number of buffers released, or "-1" on error.
+int Socket::reap_zerocopy(int timeout_ms) {
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + CMSG_SPACE(sizeof(struct sockaddr_in6))];
+    struct msghdr msg;
+    struct cmsghdr* cmsg;
+    struct sock_extended_err* err;
+    struct pollfd pfd;
+    int released = 0;
+    bool copied;
+    if (!this->zc_pending || this->zc_pending->empty()) {
+        return 0;
+    }
+    pfd.fd = this->sockfd;
+    pfd.events = 0;     // POLLERR is always reported.
+    while (true) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(this->sockfd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror(ERROR("recvmsg in Socket::reap_zerocopy"));
+                return -1;
+            }
+            if (released > 0 || timeout_ms == 0) {
+                break;
+            }
+            if (poll(&pfd, 1, timeout_ms) <= 0) {
+                break;
+            }
+            continue;
+        }
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            err = (struct sock_extended_err*) CMSG_DATA(cmsg);
+            if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            // The range [ee_info, ee_data] of ids completed.
+            copied = (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+            released += this->complete_zerocopy(err->ee_info, err->ee_data, copied);
+        }
+    }
+    return released;
+}
+
+/// @brief Marks the ids [lo, hi] as completed, and releases the buffers
+///  whose ids all completed. Ids wrap around, so they are compared by their
+///  distance to "lo".
+/// @return Number of buffers released.
+int Socket::complete_zerocopy(uint32_t lo, uint32_t hi, bool copied) {
+    std::deque<ZeroCopyBuffer>& pending = *(this->zc_pending);
+    int64_t range = (int32_t) (hi - lo);
+    int released = 0;
+    for (size_t i = 0; i < pending.size(); ) {
+        ZeroCopyBuffer& buffer = pending[i];
+        int64_t first = (int32_t) (buffer.first_id - lo);
+        int64_t last = (int32_t) (buffer.last_id - lo);
+        if (first > range) {
+            break;      // Buffers are kept in the order their ids were given.
+        }
+        if (last >= 0) {
+            buffer.remaining -= ((last < range) ? last : range) - ((first > 0) ? first : 0) + 1;
+            buffer.copied = buffer.copied || copied;
+        }
+        if (buffer.remaining == 0) {
+            ZeroCopyBuffer done = buffer;
+            pending.erase(pending.begin() + i);
+            if (done.callback != NULL) {
+                done.callback(done.buf, done.len, done.copied, done.arg);
+            }
+            released++;
+            continue;
+        }
+        i++;
+    }
+    return released;
+}
+
+/// @brief Number of buffers sent with Socket::write_zerocopy() that are
+///  still owned by the kernel.
+int Socket::get_zerocopy_pending(void) const {
+    return (this->zc_pending) ? this->zc_pending->size() : 0;
+}
+
 /******************************************************************************
  *  Setters and getters
 ******************************************************************************/
@@ -333,3 +800,27 @@ int Socket::get_port_from_sockfd(int sockfd) {
     }
     return this->get_port_from_sockaddr((struct sockaddr*)&addr);
 }
+
+/// @brief Blocks SIGPIPE for the calling thread. Used around syscalls that
+///  don't accept MSG_NOSIGNAL, like "sendfile()" and "splice()".
+/// @param mask Where the mask with only SIGPIPE will be stored.
+/// @param old_mask Where the previous signal mask will be stored.
+void Socket::block_sigpipe(sigset_t* mask, sigset_t* old_mask) {
+    sigemptyset(mask);
+    sigaddset(mask, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, mask, old_mask);
+}
+
+/// @brief Discards any SIGPIPE raised while it was blocked with
+///  Socket::block_sigpipe(), and restores the previous signal mask.
+void Socket::restore_sigpipe(sigset_t* mask, sigset_t* old_mask) {
+    struct timespec zero = {0, 0};
+    sigset_t pending;
+    if (!sigismember(old_mask, SIGPIPE)) {
+        sigpending(&pending);
+        if (sigismember(&pending, SIGPIPE)) {
+            sigtimedwait(mask, NULL, &zero);
+        }
+        pthread_sigmask(SIG_SETMASK, old_mask, NULL);
+    }
+}
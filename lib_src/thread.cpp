@@ -57,5 +57,19 @@ int Thread::send_signal(int signal) {
     return Signal::kill(this->id, signal);
 }
 
+/// @brief Pins the Thread to a single CPU.
+/// @param cpu CPU number, from "0" to the amount of CPUs - 1.
+/// @return "0" on success, "-1" on error.
+int Thread::set_affinity(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(this->id, sizeof(cpu_set_t), &set) != 0) {
+        perror(ERROR("pthread_setaffinity_np in Thread::set_affinity"));
+        return -1;
+    }
+    return 0;
+}
+
 
 
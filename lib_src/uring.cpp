@@ -0,0 +1,265 @@
+#include "uring.h"
+
+/******************************************************************************
+ * Constructors and destructors
+******************************************************************************/
+
+/// @brief Creates an "io_uring" instance, and maps its queues.
+/// @param entries Size of the submission queue. Rounded up to a power of 2.
+/// @return Throws std::runtime_error if "io_uring" is not available.
+Uring::Uring(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    this->buf_ring = NULL;
+    this->buffers = NULL;
+    this->to_submit = 0;
+    if ( (this->ring_fd = syscall(__NR_io_uring_setup, entries, &params)) == -1) {
+        perror(ERROR("io_uring_setup in Uring::Uring"));
+        throw(std::runtime_error("io_uring_setup"));
+    }
+    this->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    this->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    this->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    this->sq_ring = mmap(NULL, this->sq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQ_RING);
+    this->cq_ring = mmap(NULL, this->cq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_CQ_RING);
+    this->sqes = (struct io_uring_sqe*) mmap(NULL, this->sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQES);
+    if (this->sq_ring == MAP_FAILED || this->cq_ring == MAP_FAILED || this->sqes == MAP_FAILED) {
+        perror(ERROR("mmap in Uring::Uring"));
+        ::close(this->ring_fd);
+        throw(std::runtime_error("mmap"));
+    }
+    this->sq_head = (unsigned*) ((char*) this->sq_ring + params.sq_off.head);
+    this->sq_tail = (unsigned*) ((char*) this->sq_ring + params.sq_off.tail);
+    this->sq_mask = (unsigned*) ((char*) this->sq_ring + params.sq_off.ring_mask);
+    this->sq_array = (unsigned*) ((char*) this->sq_ring + params.sq_off.array);
+    this->cq_head = (unsigned*) ((char*) this->cq_ring + params.cq_off.head);
+    this->cq_tail = (unsigned*) ((char*) this->cq_ring + params.cq_off.tail);
+    this->cq_mask = (unsigned*) ((char*) this->cq_ring + params.cq_off.ring_mask);
+    this->cqes = (struct io_uring_cqe*) ((char*) this->cq_ring + params.cq_off.cqes);
+}
+
+/// @brief Closes the "io_uring" instance. Pending operations are cancelled.
+Uring::~Uring() {
+    ::close(this->ring_fd);
+    munmap(this->sqes, this->sqes_size);
+    munmap(this->cq_ring, this->cq_ring_size);
+    munmap(this->sq_ring, this->sq_ring_size);
+    if (this->buf_ring != NULL) {
+        munmap(this->buf_ring, this->buf_ring_size);
+        free(this->buffers);
+    }
+}
+
+/// @brief Checks if the kernel supports "io_uring", and if it is allowed.
+/// @return "true" if it is supported, "false" otherwise.
+bool Uring::is_supported(void) {
+    struct io_uring_params params;
+    int fd;
+    memset(&params, 0, sizeof(params));
+    if ( (fd = syscall(__NR_io_uring_setup, 1, &params)) == -1) {
+        return false;
+    }
+    ::close(fd);
+    return true;
+}
+
+/******************************************************************************
+ * Provided buffers
+******************************************************************************/
+
+/// @brief Allocates a ring of buffers and provides them to the kernel, to be
+///  used by Uring::recv(). The kernel picks a free buffer when data arrives,
+///  and it must be given back with Uring::recycle_buffer() after being used.
+///  Needs Linux 5.19 or newer.
+/// @param count Amount of buffers. Must be a power of 2, up to 32768.
+/// @param size Size of each buffer in bytes.
+/// @return "0" on success, "-1" on error.
+int Uring::set_buffers(unsigned count, unsigned size) {
+    struct io_uring_buf_reg reg;
+    this->buf_ring_size = count * sizeof(struct io_uring_buf);
+    this->buf_ring = (struct io_uring_buf*) mmap(NULL, this->buf_ring_size,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (this->buf_ring == MAP_FAILED) {
+        perror(ERROR("mmap in Uring::set_buffers"));
+        this->buf_ring = NULL;
+        return -1;
+    }
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t) (uintptr_t) this->buf_ring;
+    reg.ring_entries = count;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (syscall(__NR_io_uring_register, this->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+        perror(ERROR("io_uring_register in Uring::set_buffers"));
+        munmap(this->buf_ring, this->buf_ring_size);
+        this->buf_ring = NULL;
+        return -1;
+    }
+    if ( (this->buffers = (char*) malloc((size_t) count * size)) == NULL) {
+        perror(ERROR("malloc in Uring::set_buffers"));
+        syscall(__NR_io_uring_register, this->ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        munmap(this->buf_ring, this->buf_ring_size);
+        this->buf_ring = NULL;
+        return -1;
+    }
+    this->buf_count = count;
+    this->buf_size = size;
+    this->buf_ring[0].resv = 0;
+    for (unsigned i = 0; i < count; i++) {
+        this->recycle_buffer(i);
+    }
+    return 0;
+}
+
+/// @brief Returns the buffer with the "id" found in a completion flags
+///  (cqe.flags >> IORING_CQE_BUFFER_SHIFT).
+char* Uring::get_buffer(unsigned short id) {
+    return this->buffers + (size_t) id * this->buf_size;
+}
+
+/// @brief Gives a buffer back to the kernel, so it can be used again.
+void Uring::recycle_buffer(unsigned short id) {
+    unsigned short tail = this->buf_ring[0].resv;
+    struct io_uring_buf* buf = &(this->buf_ring[tail & (this->buf_count - 1)]);
+    buf->addr = (uint64_t) (uintptr_t) this->get_buffer(id);
+    buf->len = this->buf_size;
+    buf->bid = id;
+    __atomic_store_n(&(this->buf_ring[0].resv), (unsigned short) (tail + 1), __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * Operations
+******************************************************************************/
+
+/// @brief Queues an "accept()". The completion result is the new socket file
+///  descriptor, or "-errno" on error.
+/// @param sockfd Listening socket.
+/// @param data Identifies the operation in the completion.
+/// @param multishot If "true", a completion is generated for every new
+///  client, until one without the IORING_CQE_F_MORE flag is received.
+/// @return "0" on success, "-1" if the submission queue is full.
+int Uring::accept(int sockfd, uint64_t data, bool multishot) {
+    struct io_uring_sqe* sqe;
+    if ( (sqe = this->get_sqe()) == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = sockfd;
+    sqe->ioprio = (multishot) ? IORING_ACCEPT_MULTISHOT : 0;
+    sqe->user_data = data;
+    return 0;
+}
+
+/// @brief Queues a "recv()", into one of the provided buffers. The completion
+///  result is the amount of bytes received, "0" if the connection was closed,
+///  or "-errno" on error. The buffer id is in the completion flags.
+/// @param sockfd Connected socket.
+/// @param data Identifies the operation in the completion.
+/// @param multishot If "true", a completion is generated every time data
+///  arrives, until one without the IORING_CQE_F_MORE flag is received.
+/// @return "0" on success, "-1" if the submission queue is full.
+int Uring::recv(int sockfd, uint64_t data, bool multishot) {
+    struct io_uring_sqe* sqe;
+    if ( (sqe = this->get_sqe()) == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sockfd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->ioprio = (multishot) ? IORING_RECV_MULTISHOT : 0;
+    sqe->user_data = data;
+    return 0;
+}
+
+/// @brief Queues a "send()". The buffer must not be modified until the
+///  completion is received. The completion result is the amount of bytes sent,
+///  which might be less than "len", or "-errno" on error.
+/// @param sockfd Connected socket.
+/// @param buf Data to be sent.
+/// @param len Length of the data in bytes.
+/// @param data Identifies the operation in the completion.
+/// @return "0" on success, "-1" if the submission queue is full.
+int Uring::send(int sockfd, const void* buf, unsigned len, uint64_t data) {
+    struct io_uring_sqe* sqe;
+    if ( (sqe = this->get_sqe()) == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = sockfd;
+    sqe->addr = (uint64_t) (uintptr_t) buf;
+    sqe->len = len;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = data;
+    return 0;
+}
+
+/// @brief Submits all the queued operations with a single system call, and
+///  optionally waits for completions.
+/// @param wait_nr Amount of completions to wait for ("0" by default).
+/// @param mask If not NULL, signal mask set while waiting.
+/// @return Amount of operations submitted, or "-1" on error. If interrupted
+///  by a signal, "-1" with "errno" set to "EINTR".
+int Uring::submit(unsigned wait_nr, const sigset_t* mask) {
+    int submitted;
+    if ( (submitted = syscall(__NR_io_uring_enter, this->ring_fd, this->to_submit, wait_nr,
+            (wait_nr > 0) ? IORING_ENTER_GETEVENTS : 0, mask, _NSIG / 8)) == -1) {
+        if (errno != EINTR) {
+            perror(ERROR("io_uring_enter in Uring::submit"));
+        }
+        return -1;
+    }
+    this->to_submit -= submitted;
+    return submitted;
+}
+
+/// @brief Copies the available completions, and frees their place in the
+///  completion queue. Doesn't make any system call.
+/// @param cqes Where the completions will be copied.
+/// @param max Size of "cqes".
+/// @return Amount of completions copied.
+int Uring::get_completions(struct io_uring_cqe* cqes, int max) {
+    unsigned head = *(this->cq_head);
+    unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+    int count = 0;
+    while (head != tail && count < max) {
+        cqes[count++] = this->cqes[head & *(this->cq_mask)];
+        head++;
+    }
+    __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+/******************************************************************************
+ * Private methods
+******************************************************************************/
+
+/// @brief Gets a free entry of the submission queue. If it is full, the
+///  queued operations are submitted first.
+/// @return The entry, cleared, or NULL if there is no room.
+struct io_uring_sqe* Uring::get_sqe(void) {
+    unsigned head = __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *(this->sq_tail);
+    unsigned index;
+    struct io_uring_sqe* sqe;
+    if (tail - head > *(this->sq_mask)) {
+        if (this->submit() == -1) {
+            return NULL;
+        }
+        head = __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head > *(this->sq_mask)) {
+            return NULL;
+        }
+    }
+    index = tail & *(this->sq_mask);
+    sqe = &(this->sqes[index]);
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    this->sq_array[index] = index;
+    // Without SQPOLL, the kernel only reads the queue in "io_uring_enter()",
+    // so the entry can still be filled by the caller after this.
+    __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    this->to_submit++;
+    return sqe;
+}
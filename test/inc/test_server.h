@@ -1,5 +1,7 @@
 #include "server.h"
 #include "socket.h"
+#include "framed_socket.h"
+#include "buffered_socket.h"
 #include "gtest/gtest.h"
 #include <sys/types.h>
 #include <unistd.h>
@@ -11,6 +13,9 @@ typedef struct msg_t {
     int number;
 } msg_t;
 
+// Bytes sent by BulkEchoServer, more than the socket buffers hold.
+#define BULK_SIZE (16 * 1024 * 1024)
+
 class EchoServer: public Server {
 protected:
     void on_accept(Socket& socket) override {
@@ -42,3 +47,213 @@ protected:
 public:
     ClosedConnectionServer(const char* ip, const char* port): Server(ip, port) {}
 };
+
+class ReactorEchoServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {}
+    int on_readable(Socket& socket) override {
+        msg_t msg_read;
+        msg_t msg_echo;
+        if (socket.read(&msg_read, sizeof(msg_t)) <= 0) {
+            return -1;
+        }
+        strcpy(msg_echo.text, "echo: ");
+        msg_echo.number = msg_read.number;
+        strcat(msg_echo.text, msg_read.text);
+        EXPECT_EQ(socket.write(&msg_echo, sizeof(msg_t)), sizeof(msg_t));
+        if (strcmp(msg_read.text, "exit") == 0) {
+            Signal::kill(getpid(), SIGINT);
+        }
+        return 0;
+    }
+public:
+    ReactorEchoServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+class ThreadEchoServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {
+        msg_t msg_read;
+        msg_t msg_echo;
+        while(socket.read(&msg_read, sizeof(msg_t)) > 0) {
+            strcpy(msg_echo.text, "echo: ");
+            msg_echo.number = msg_read.number;
+            strcat(msg_echo.text, msg_read.text);
+            EXPECT_EQ(socket.write(&msg_echo, sizeof(msg_t)), sizeof(msg_t));
+            if (strcmp(msg_read.text, "exit") == 0) {
+                Signal::kill(getpid(), SIGINT);
+                return;
+            }
+        }
+    }
+    void on_busy(Socket& socket) override {
+        msg_t msg;
+        strcpy(msg.text, "busy");
+        msg.number = 0;
+        EXPECT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+    }
+public:
+    ThreadEchoServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+class PoolBusyServer: public ThreadEchoServer {
+protected:
+    // Lets the client know that it can connect, without connecting to check it.
+    void on_start(void) override {
+        Sem sem(".", 2);
+        sem++;
+    }
+public:
+    PoolBusyServer(const char* ip, const char* port): ThreadEchoServer(ip, port) {}
+};
+
+class CrashingEchoServer: public EchoServer {
+protected:
+    // The worker process dies with the "crash" message, without answering.
+    void on_accept(Socket& socket) override {
+        msg_t msg;
+        if (socket.read(&msg, sizeof(msg_t), MSG_PEEK) == sizeof(msg_t) && strcmp(msg.text, "crash") == 0) {
+            _exit(1);
+        }
+        EchoServer::on_accept(socket);
+    }
+public:
+    CrashingEchoServer(const char* ip, const char* port): EchoServer(ip, port) {}
+};
+
+class UringEchoServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {}
+    int on_data(Socket& socket, const char* data, int len) override {
+        msg_t msg_read;
+        msg_t msg_echo;
+        if (len != sizeof(msg_t)) {
+            return -1;
+        }
+        memcpy(&msg_read, data, sizeof(msg_t));
+        strcpy(msg_echo.text, "echo: ");
+        msg_echo.number = msg_read.number;
+        strcat(msg_echo.text, msg_read.text);
+        EXPECT_EQ(this->send_async(socket, &msg_echo, sizeof(msg_t)), 0);
+        if (strcmp(msg_read.text, "exit") == 0) {
+            Signal::kill(getpid(), SIGINT);
+        }
+        return 0;
+    }
+public:
+    UringEchoServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+class BulkEchoServer: public UringEchoServer {
+protected:
+    // Answers "bulk" with more data than the socket buffers can hold, and then
+    // the echo. Other messages are echoed right away.
+    int on_data(Socket& socket, const char* data, int len) override {
+        if (len == sizeof(msg_t) && strcmp(((const msg_t*) data)->text, "bulk") == 0) {
+            std::vector<char> bulk(BULK_SIZE);
+            for (size_t i = 0; i < bulk.size(); i++) {
+                bulk[i] = i % 251;
+            }
+            EXPECT_EQ(this->send_async(socket, bulk.data(), bulk.size()), 0);
+        }
+        return UringEchoServer::on_data(socket, data, len);
+    }
+public:
+    BulkEchoServer(const char* ip, const char* port): UringEchoServer(ip, port) {}
+};
+
+class FramedEchoServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {
+        FramedSocket framed(socket);
+        std::vector<char> frame(FRAME_MAX_SIZE);
+        int len;
+        while ( (len = framed.read_frame(frame.data(), frame.size())) > 0) {
+            // Echo back in a single write all the frames received together.
+            ASSERT_EQ(framed.write_frame(frame.data(), len, framed.has_frame()), len);
+            if (len == 4 && memcmp(frame.data(), "exit", 4) == 0) {
+                Signal::kill(getppid(), SIGINT);
+                return;
+            }
+        }
+    }
+public:
+    FramedEchoServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+class LineEchoServer: public Server {
+protected:
+    void on_accept(Socket& socket) override {
+        BufferedSocket buffered(socket, 64);
+        char line[64];
+        int len;
+        // Replies are flushed automatically before blocking on the next read.
+        while ( (len = buffered.read_until('\n', line, sizeof(line))) > 0) {
+            ASSERT_EQ(buffered.write(line, len), len);
+            if (strncmp(line, "exit\n", len) == 0) {
+                buffered.flush();
+                Signal::kill(getppid(), SIGINT);
+                return;
+            }
+        }
+    }
+public:
+    LineEchoServer(const char* ip, const char* port): Server(ip, port) {}
+};
+
+class FileServer: public Server {
+private:
+    int fd;
+    size_t len;
+protected:
+    void on_accept(Socket& socket) override {
+        off_t offset = 0;
+        ssize_t sent;
+        char request;
+        if (socket.read(&request, sizeof(char)) <= 0) {
+            return;     // Socket::is_listening() probe.
+        }
+        // Sent in two parts, resuming from the offset where the first ended.
+        ASSERT_EQ(socket.send_file(this->fd, offset, this->len / 3), (ssize_t) this->len / 3);
+        offset += this->len / 3;
+        while ((size_t) offset < this->len) {
+            ASSERT_GT( (sent = socket.send_file(this->fd, offset, this->len - offset)), 0);
+            offset += sent;
+        }
+        Signal::kill(getppid(), SIGINT);
+    }
+public:
+    FileServer(const char* ip, const char* port, int fd, size_t len): Server(ip, port), fd(fd), len(len) {}
+};
+
+class ProxyServer: public Server {
+private:
+    const char* upstream_port;
+protected:
+    void on_accept(Socket& socket) override {
+        Socket upstream("localhost", this->upstream_port);
+        EXPECT_GE(Socket::proxy(socket, upstream), 0);
+    }
+public:
+    ProxyServer(const char* ip, const char* port, const char* upstream_port): Server(ip, port), upstream_port(upstream_port) {}
+};
+
+class DrainServer: public Server {
+private:
+    long expected;
+protected:
+    void on_accept(Socket& socket) override {
+        std::vector<char> buffer(1 << 16);
+        long received = 0;
+        int len;
+        while (received < this->expected && (len = socket.read(buffer.data(), buffer.size())) > 0) {
+            received += len;
+        }
+        if (received == this->expected) {
+            socket << 'k';
+            Signal::kill(getppid(), SIGINT);
+        }
+    }
+public:
+    DrainServer(const char* ip, const char* port, long expected): Server(ip, port), expected(expected) {}
+};
@@ -0,0 +1,157 @@
+#include "journal.h"
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define TEST_JOURNAL_DIR    "./test_journal"
+
+/// @brief Removes the journal directory and its files.
+static void remove_journal(void) {
+    DIR* dir_stream = opendir(TEST_JOURNAL_DIR);
+    struct dirent* entry;
+    if (dir_stream == NULL) {
+        return;
+    }
+    while ( (entry = readdir(dir_stream)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            unlink((std::string(TEST_JOURNAL_DIR) + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir_stream);
+    rmdir(TEST_JOURNAL_DIR);
+}
+
+/// @brief Tested: append(), JournalReader::read(), commit() and replay from
+///  the committed offset, in another process.
+TEST(JournalTest, AppendRead) {
+    remove_journal();
+    char data[64];
+    {
+        Journal journal(TEST_JOURNAL_DIR);
+        EXPECT_EQ(journal.append("", 0), -1);
+        for (int i = 0; i < 10; i++) {
+            int len = snprintf(data, sizeof(data), "record %d", i) + 1;
+            EXPECT_EQ(journal.append(data, len), 0);
+        }
+        EXPECT_EQ(journal.sync(), 0);
+        JournalReader reader(TEST_JOURNAL_DIR, "consumer");
+        for (int i = 0; i < 5; i++) {
+            EXPECT_GT(reader.read(data, sizeof(data)), 0);
+        }
+        EXPECT_STREQ(data, "record 4");
+        EXPECT_EQ(reader.read(data, 2), -1);      // Too small, not consumed.
+        EXPECT_EQ(errno, EMSGSIZE);
+        EXPECT_EQ(reader.commit(), 0);
+    }
+    if (!fork()) {
+        // Child: a restarted consumer continues after the commit.
+        JournalReader reader(TEST_JOURNAL_DIR, "consumer");
+        int count = 0;
+        bool in_order = true;
+        while (reader.read(data, sizeof(data)) > 0) {
+            char expected[64];
+            snprintf(expected, sizeof(expected), "record %d", 5 + count++);
+            in_order = in_order && strcmp(data, expected) == 0;
+        }
+        exit((count == 5 && in_order) ? 0 : 1);
+    } else {
+        int status;
+        ASSERT_NE(wait(&status), -1);
+        EXPECT_EQ(WEXITSTATUS(status), 0);
+    }
+    remove_journal();
+}
+
+/// @brief Tested: Segment rollover, a reader following the writer across
+///  segments, and trim().
+TEST(JournalTest, Rollover) {
+    remove_journal();
+    Journal journal(TEST_JOURNAL_DIR, 4096, 16);
+    JournalReader reader(TEST_JOURNAL_DIR, "consumer");
+    long value, sum = 0;
+    int count = 0;
+    for (long i = 0; i < 2000; i++) {
+        EXPECT_EQ(journal.append(&i, sizeof(i)), 0);
+        if (i % 100 == 0) {
+            while (reader.read(&value, sizeof(value)) > 0) {
+                sum += value;
+                count++;
+            }
+        }
+    }
+    while (reader.read(&value, sizeof(value)) > 0) {
+        sum += value;
+        count++;
+    }
+    EXPECT_EQ(count, 2000);
+    EXPECT_EQ(sum, 1999L * 2000 / 2);
+    EXPECT_GT(journal.get_offset(), 4096UL * 4);
+    EXPECT_GT(journal.trim(reader.get_offset()), 0);
+    JournalReader late(TEST_JOURNAL_DIR, "late");   // Starts at the oldest left.
+    EXPECT_EQ(late.read(&value, sizeof(value)), (ssize_t) sizeof(value));
+    EXPECT_GT(value, 0);
+    remove_journal();
+}
+
+/// @brief Tested: Reopening the journal after a record was corrupted (as if
+///  the writer crashed while writing it). It's discarded, and appending
+///  continues in its place.
+TEST(JournalTest, Recovery) {
+    remove_journal();
+    uint64_t last_offset;
+    int value;
+    {
+        Journal journal(TEST_JOURNAL_DIR);
+        for (value = 0; value < 3; value++) {
+            journal.append(&value, sizeof(value));
+        }
+        last_offset = journal.get_offset() - Journal::record_size(sizeof(value));
+    }
+    // Corrupt the payload of the last record.
+    int fd = open(Journal::segment_path(TEST_JOURNAL_DIR, 0).c_str(), O_RDWR);
+    ASSERT_NE(fd, -1);
+    value = -1;
+    pwrite(fd, &value, sizeof(value), last_offset + sizeof(Journal::Header));
+    close(fd);
+    {
+        Journal journal(TEST_JOURNAL_DIR);
+        EXPECT_EQ(journal.get_offset(), last_offset);
+        value = 10;
+        journal.append(&value, sizeof(value));
+    }
+    JournalReader reader(TEST_JOURNAL_DIR, "consumer");
+    int expected[3] = {0, 1, 10};
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(reader.read(&value, sizeof(value)), (ssize_t) sizeof(value));
+        EXPECT_EQ(value, expected[i]);
+    }
+    EXPECT_EQ(reader.read(&value, sizeof(value)), 0);
+    remove_journal();
+}
+
+/// @brief Tested: Readers don't see records until they are synced, and a
+///  second writer can't open the journal.
+TEST(JournalTest, SyncedAndSingleWriter) {
+    remove_journal();
+    int value;
+    {
+        Journal journal(TEST_JOURNAL_DIR, JOURNAL_SEGMENT_SIZE, 0, -1);
+        EXPECT_THROW(Journal(TEST_JOURNAL_DIR), std::runtime_error);
+        JournalReader reader(TEST_JOURNAL_DIR, "consumer");
+        for (value = 0; value < 3; value++) {
+            EXPECT_EQ(journal.append(&value, sizeof(value)), 0);
+        }
+        EXPECT_EQ(reader.read(&value, sizeof(value)), 0);
+        EXPECT_EQ(reader.get_offset(), 0UL);
+        EXPECT_EQ(journal.sync(), 0);
+        for (int i = 0; i < 3; i++) {
+            EXPECT_EQ(reader.read(&value, sizeof(value)), (ssize_t) sizeof(value));
+            EXPECT_EQ(value, i);
+        }
+        EXPECT_EQ(reader.read(&value, sizeof(value)), 0);
+    }
+    // The lock goes away with the writer.
+    Journal journal(TEST_JOURNAL_DIR);
+    remove_journal();
+}
@@ -1,7 +1,10 @@
 #include "msg_queue.h"
+#include "thread.h"
 #include "gtest/gtest.h"
 #include <sys/wait.h>
 #include <string.h>
+#include <poll.h>
+#include <signal.h>
 
 /// @brief Tested: IO operations with int type.
 TEST (MsgQueueTest, IntType) {
@@ -113,3 +116,205 @@ TEST(MsgQueueTest, Priority) {
     EXPECT_EQ(queue.read(-4), 2);   // Read higher priority available, should read 2.
     EXPECT_EQ(queue.read(), 4);     // First one.
 }
+
+/// @brief Tested: write_many(), read_many()
+TEST(MsgQueueTest, Batch) {
+    MsgQueue<int> queue(".", 2, true);
+    int values[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    int output[8];
+    EXPECT_EQ(queue.read_many(output, 8, 0, IPC_NOWAIT), -1);
+    EXPECT_EQ(errno, ENOMSG);
+    EXPECT_EQ(queue.write_many(values, 5), 5);
+    EXPECT_EQ(queue.write_many(values + 5, 3, 2), 3);
+    EXPECT_EQ(queue.get_msg_qtty(), 8);
+    EXPECT_EQ(queue.read_many(output, 3), 3);       // Limited by "max_n".
+    EXPECT_EQ(output[0], 0);
+    EXPECT_EQ(output[2], 2);
+    EXPECT_EQ(queue.read_many(output, 8, 2), 3);    // Only "mtype = 2".
+    EXPECT_EQ(output[0], 5);
+    EXPECT_EQ(output[2], 7);
+    EXPECT_EQ(queue.read_many(output, 8), 2);       // Whatever is left.
+    EXPECT_EQ(output[0], 3);
+    EXPECT_EQ(output[1], 4);
+    if (!fork()) {
+        // Child
+        MsgQueue<int> child_queue(".", 2);
+        usleep(10000);
+        child_queue.write_many(values, 8);
+        exit(0);
+    } else {
+        int total = 0, result;
+        while (total < 8 && (result = queue.read_many(output + total, 8 - total)) > 0) {
+            total += result;
+        }
+        EXPECT_EQ(total, 8);
+        EXPECT_EQ(output[7], 7);
+        wait(NULL);
+    }
+}
+
+/// @brief Tested: write() and read() of variable length messages.
+TEST(MsgQueueTest, VariableLength) {
+    MsgQueue<char> queue(".", 2, true);
+    const char* short_text = "co";
+    const char* long_text = "a longer message, of another length";
+    char output[64];
+    EXPECT_EQ(queue.read(output, sizeof(output), 0, IPC_NOWAIT), -1);
+    EXPECT_EQ(errno, ENOMSG);
+    EXPECT_EQ(queue.write(short_text, strlen(short_text) + 1), 0);
+    EXPECT_EQ(queue.write(long_text, strlen(long_text) + 1, 2), 0);
+    EXPECT_EQ(queue.read(output, 4, 2), -1);   // Doesn't fit, isn't consumed.
+    EXPECT_EQ(errno, E2BIG);
+    EXPECT_EQ(queue.read(output, sizeof(output)), (ssize_t) strlen(short_text) + 1);
+    EXPECT_STREQ(output, short_text);
+    if (!fork()) {
+        // Child
+        MsgQueue<char> child_queue(".", 2);
+        char child_output[64];
+        ssize_t len = child_queue.read(child_output, sizeof(child_output));
+        child_queue.write(&len, sizeof(len), 3);
+        exit(0);
+    } else {
+        ssize_t len;
+        wait(NULL);
+        EXPECT_EQ(queue.read(&len, sizeof(len), 3), (ssize_t) sizeof(len));
+        EXPECT_EQ(len, (ssize_t) strlen(long_text) + 1);
+        EXPECT_TRUE(queue.is_empty());
+    }
+}
+
+#define THREAD_MSGS     2000
+
+typedef struct thread_arg_t {
+    MsgQueue<char>* queue;
+    long mixed;         // Messages read with bytes of different messages.
+} thread_arg_t;
+
+/// @brief Writes THREAD_MSGS variable length messages, every byte equal to
+///  the first one, and reads as many checking they aren't mixed.
+static void* variable_length_thread(void* arg) {
+    thread_arg_t* thread_arg = (thread_arg_t*) arg;
+    char data[128], output[128];
+    ssize_t len;
+    for (int i = 0; i < THREAD_MSGS; i++) {
+        memset(data, 'a' + i % 26, sizeof(data));
+        thread_arg->queue->write(data, 1 + i % sizeof(data));
+        len = thread_arg->queue->read(output, sizeof(output));
+        for (ssize_t j = 1; j < len; j++) {
+            if (output[j] != output[0]) {
+                thread_arg->mixed++;
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+/// @brief Tested: variable length write() and read() from several threads on
+///  the same MsgQueue object.
+TEST(MsgQueueTest, VariableLengthThreads) {
+    MsgQueue<char> queue(".", 2, true);
+    Thread threads[4];
+    thread_arg_t args[4];
+    for (int i = 0; i < 4; i++) {
+        args[i].queue = &queue;
+        args[i].mixed = 0;
+        ASSERT_EQ(threads[i].create(variable_length_thread, &(args[i])), 0);
+    }
+    for (int i = 0; i < 4; i++) {
+        threads[i].join();
+        EXPECT_EQ(args[i].mixed, 0);
+    }
+    EXPECT_TRUE(queue.is_empty());
+}
+
+/// @brief Tested: MSGQ_POSIX backend. Creation, IO, priorities, get_fd() and
+///  notify().
+TEST(MsgQueueTest, PosixBackend) {
+    EXPECT_FALSE(MsgQueue<int>::exists(".", 2, MSGQ_POSIX));
+    EXPECT_THROW(MsgQueue<int>(".", 2, false, MSGQ_POSIX), std::runtime_error);
+    MsgQueue<int> queue(".", 2, true, MSGQ_POSIX);
+    EXPECT_TRUE(MsgQueue<int>::exists(".", 2, MSGQ_POSIX));
+    EXPECT_FALSE(MsgQueue<int>::exists(".", 2));
+    int values[3] = {1, 2, 3}, output[3], status;
+    struct pollfd pfd;
+    pfd.fd = queue.get_fd();
+    pfd.events = POLLIN;
+    ASSERT_NE(pfd.fd, -1);
+    EXPECT_EQ(poll(&pfd, 1, 0), 0);
+    EXPECT_EQ(queue.read_many(output, 3, 0, IPC_NOWAIT), -1);
+    EXPECT_EQ(errno, ENOMSG);
+
+    // Higher "mtype" (priority) first.
+    queue.write(10, 1);
+    queue.write(30, 3);
+    queue.write(20, 2);
+    EXPECT_EQ(poll(&pfd, 1, 0), 1);
+    EXPECT_EQ(queue.get_msg_qtty(), 3);
+    EXPECT_EQ(queue.read(), 30);
+    EXPECT_EQ(queue.read(), 20);
+    EXPECT_EQ(queue.read(), 10);
+    EXPECT_TRUE(queue.is_empty());
+    queue.peek(0, &status);
+    EXPECT_EQ(status, ENOTSUP);
+    EXPECT_EQ(queue.write_many(values, 3), 3);
+    EXPECT_EQ(queue.read_many(output, 3), 3);
+    EXPECT_EQ(output[2], 3);
+
+    // A message from another process, announced with a signal.
+    sigset_t set;
+    siginfo_t info;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+    EXPECT_EQ(queue.notify(SIGUSR1), 0);
+    if (!fork()) {
+        // Child
+        MsgQueue<int> child_queue(".", 2, false, MSGQ_POSIX);
+        child_queue << 40;
+        exit(0);
+    } else {
+        struct timespec timeout = {5, 0};
+        EXPECT_EQ(sigtimedwait(&set, &info, &timeout), SIGUSR1);
+        EXPECT_EQ(info.si_code, SI_MESGQ);
+        EXPECT_EQ(queue.read(), 40);
+        wait(NULL);
+    }
+    sigprocmask(SIG_UNBLOCK, &set, NULL);
+}
+
+/// @brief Tested: MSGQ_STATS. get_msg_qtty(), get_stats(), reset_high_water().
+TEST(MsgQueueTest, Stats) {
+    // The counters don't take the key of a memory with the same path and id.
+    SharedMemory<long> shm(".", 2, 16);
+    MsgQueue<int> queue(".", 2, true, MSGQ_SYSV | MSGQ_STATS);
+    MsgQueueStats stats;
+    int values[4] = {0, 1, 2, 3}, output[4];
+    EXPECT_TRUE(queue.is_empty());
+    EXPECT_EQ(queue.write_many(values, 4), 4);
+    queue.read();
+    EXPECT_EQ(queue.get_msg_qtty(), 3);
+    if (!fork()) {
+        // Child
+        MsgQueue<int> child_queue(".", 2, false, MSGQ_STATS);
+        child_queue.read_many(output, 4);
+        child_queue << 4;
+        exit(0);
+    } else {
+        wait(NULL);
+        EXPECT_EQ(queue.get_stats(&stats), 0);
+        EXPECT_EQ(stats.depth, 1);
+        EXPECT_EQ(stats.high_water, 4);
+        EXPECT_EQ(stats.enqueued, 5UL);
+        EXPECT_EQ(stats.dequeued, 4UL);
+        EXPECT_GT(stats.enqueue_rate, 0);
+        queue.reset_high_water();
+        EXPECT_EQ(queue.get_stats(&stats), 0);
+        EXPECT_EQ(stats.high_water, 1);
+        EXPECT_EQ(queue.read(), 4);
+        EXPECT_TRUE(queue.is_empty());
+    }
+    MsgQueue<int> plain(".", 3, true);
+    EXPECT_EQ(plain.get_stats(&stats), -1);
+    EXPECT_EQ(errno, ENOTSUP);
+}
@@ -0,0 +1,120 @@
+#include "mutex.h"
+#include "shared_memory.h"
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <errno.h>
+#include <new>
+
+typedef struct shared_t {
+    SharedMutex mutex;
+    SharedCond cond;
+    long counter;
+    bool ready;
+} shared_t;
+
+/// @brief Builds a shared_t inside the shared memory.
+static shared_t* build(SharedMemory<char>& shm) {
+    shared_t* shared = (shared_t*) &(shm[0]);
+    new (&(shared->mutex)) SharedMutex();
+    new (&(shared->cond)) SharedCond();
+    shared->counter = 0;
+    shared->ready = false;
+    return shared;
+}
+
+/// @brief Destroys the shared_t built by build().
+static void destroy(shared_t* shared) {
+    shared->cond.~SharedCond();
+    shared->mutex.~SharedMutex();
+}
+
+/// @brief Tested: SharedMutex::lock(), trylock(), unlock().
+TEST(SharedMutexTest, LockUnlock) {
+    SharedMemory<char> shm(".", 2, sizeof(shared_t));
+    shared_t* shared = build(shm);
+    EXPECT_EQ(shared->mutex.lock(), 0);
+    EXPECT_EQ(shared->mutex.trylock(), -1);
+    EXPECT_EQ(errno, EBUSY);
+    EXPECT_EQ(shared->mutex.unlock(), 0);
+    EXPECT_EQ(shared->mutex.trylock(), 0);
+    EXPECT_EQ(shared->mutex.unlock(), 0);
+    destroy(shared);
+}
+
+/// @brief Tested: processes incrementing a counter under the mutex.
+TEST(SharedMutexTest, Processes) {
+    const int processes = 4, increments = 10000;
+    SharedMemory<char> shm(".", 2, sizeof(shared_t));
+    shared_t* shared = build(shm);
+    for (int p = 0; p < processes; p++) {
+        if (!fork()) {
+            SharedMemory<char> child_shm(".", 2);
+            shared_t* child_shared = (shared_t*) &(child_shm[0]);
+            for (int i = 0; i < increments; i++) {
+                child_shared->mutex.lock();
+                child_shared->counter++;
+                child_shared->mutex.unlock();
+            }
+            exit(0);
+        }
+    }
+    for (int p = 0; p < processes; p++) {
+        wait(NULL);
+    }
+    EXPECT_EQ(shared->counter, (long) processes * increments);
+    destroy(shared);
+}
+
+/// @brief Tested: the mutex is recovered when its owner dies holding it.
+TEST(SharedMutexTest, OwnerDies) {
+    SharedMemory<char> shm(".", 2, sizeof(shared_t));
+    shared_t* shared = build(shm);
+    if (!fork()) {
+        SharedMemory<char> child_shm(".", 2);
+        ((shared_t*) &(child_shm[0]))->mutex.lock();
+        exit(0);
+    }
+    wait(NULL);
+    EXPECT_EQ(shared->mutex.lock(), 1);
+    EXPECT_EQ(shared->mutex.unlock(), 0);
+    EXPECT_EQ(shared->mutex.lock(), 0);
+    EXPECT_EQ(shared->mutex.unlock(), 0);
+    destroy(shared);
+}
+
+/// @brief Tested: SharedCond::wait(), signal(), broadcast(), and a timeout.
+TEST(SharedCondTest, WaitSignal) {
+    const int processes = 3;
+    SharedMemory<char> shm(".", 2, sizeof(shared_t));
+    shared_t* shared = build(shm);
+    shared->mutex.lock();
+    EXPECT_EQ(shared->cond.wait(shared->mutex, 10), -1);
+    EXPECT_EQ(errno, ETIMEDOUT);
+    shared->mutex.unlock();
+    for (int p = 0; p < processes; p++) {
+        if (!fork()) {
+            SharedMemory<char> child_shm(".", 2);
+            shared_t* child_shared = (shared_t*) &(child_shm[0]);
+            child_shared->mutex.lock();
+            while (!child_shared->ready) {
+                child_shared->cond.wait(child_shared->mutex);
+            }
+            child_shared->counter++;
+            child_shared->mutex.unlock();
+            child_shared->cond.signal();
+            exit(0);
+        }
+    }
+    shared->mutex.lock();
+    shared->ready = true;
+    EXPECT_EQ(shared->cond.broadcast(), 0);
+    while (shared->counter < processes) {
+        EXPECT_NE(shared->cond.wait(shared->mutex, 1000), -1);
+    }
+    shared->mutex.unlock();
+    for (int p = 0; p < processes; p++) {
+        wait(NULL);
+    }
+    EXPECT_EQ(shared->counter, (long) processes);
+    destroy(shared);
+}
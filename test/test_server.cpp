@@ -162,3 +162,690 @@ TEST (ServerTest, CloseServerConnection) {
         ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), -1);
     }
 }
+
+/// @brief Tested: Server::start_reactor(), with multiple clients connected at
+///  the same time to a single process.
+TEST (ServerTest, ReactorMultipleClients) {
+    uint8_t i;
+    Sem g_sem(".", 2, true);
+    g_sem = 0;
+    for (i=0; i<5; i++) {
+        if (!fork()) {
+            // Client
+            while(!Socket::is_listening("localhost", "3000"));
+            Socket socket("localhost", "3000");
+            msg_t msg;
+            msg.number = i;
+            strcpy(msg.text, "hello");
+            ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_STREQ(msg.text, "echo: hello");
+            ASSERT_EQ(msg.number, i);
+            g_sem++;
+            // Every client keeps its connection open until all of them were served.
+            g_sem.op(0);
+            socket.close();
+            exit(0);
+        }
+    }
+    if (!fork()) {
+        g_sem.op(-5);
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket socket("localhost", "3000");
+        msg_t msg;
+        strcpy(msg.text, "exit");
+        ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: exit");
+        socket.close();
+        exit(0);
+    }
+    // Host
+    ReactorEchoServer server("localhost", "3000");
+    server.start_reactor();
+    ASSERT_EQ(wait(NULL), -1);
+}
+
+/// @brief Tested: Server::start_pool(), with multiple clients.
+TEST (ServerTest, PoolMultipleClients) {
+    uint8_t i;
+    Sem g_sem(".", 2, true);
+    g_sem = 0;
+    for (i=0; i<5; i++) {
+        if (!fork()) {
+            // Client
+            while(!Socket::is_listening("localhost", "3000"));
+            Socket socket("localhost", "3000");
+            msg_t msg;
+            msg.number = i;
+            if (i == 4) {
+                g_sem.op(-4);
+                strcpy(msg.text, "exit");
+            } else {
+                strcpy(msg.text, "hello");
+            }
+            ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_EQ(msg.number, i);
+            ASSERT_STREQ(msg.text, (i == 4) ? "echo: exit" : "echo: hello");
+            g_sem++;
+            socket.close();
+            exit(0);
+        }
+    }
+    // Host
+    ThreadEchoServer server("localhost", "3000");
+    server.start_pool(2, 4);
+    ASSERT_EQ(wait(NULL), -1);
+}
+
+/// @brief Tested: Server::start_pool(), rejecting clients with POOL_BUSY.
+TEST (ServerTest, PoolBusy) {
+    Sem g_sem(".", 2, true);
+    g_sem = 0;
+    if (!fork()) {
+        // Client
+        msg_t msg;
+        g_sem--;
+        // Keeps the only worker busy.
+        Socket first("localhost", "3000");
+        strcpy(msg.text, "first");
+        ASSERT_EQ(first.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(first.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: first");
+        // Fills the queue.
+        Socket second("localhost", "3000");
+        // Rejected.
+        Socket third("localhost", "3000");
+        ASSERT_EQ(third.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "busy");
+        ASSERT_EQ(third.read(&msg, sizeof(msg_t)), 0);
+        // The queued client is attended after the first one leaves.
+        first.close();
+        strcpy(msg.text, "exit");
+        ASSERT_EQ(second.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(second.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: exit");
+        second.close();
+        third.close();
+        exit(0);
+    } else {
+        // Host
+        PoolBusyServer server("localhost", "3000");
+        server.start_pool(1, 1, Server::POOL_BUSY);
+        ASSERT_EQ(wait(NULL), -1);
+    }
+}
+
+/// @brief Tested: Server::start_sharded(), with multiple clients.
+TEST (ServerTest, ShardedMultipleClients) {
+    uint8_t i;
+    Sem g_sem(".", 2, true);
+    g_sem = 0;
+    for (i=0; i<5; i++) {
+        if (!fork()) {
+            // Client. A shard attends one client at a time, so the last one
+            // doesn't connect until the others were served.
+            if (i == 4) {
+                g_sem.op(-4);
+            }
+            while(!Socket::is_listening("localhost", "3000"));
+            Socket socket("localhost", "3000");
+            msg_t msg;
+            msg.number = i;
+            strcpy(msg.text, (i == 4) ? "exit" : "hello");
+            ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_EQ(msg.number, i);
+            ASSERT_STREQ(msg.text, (i == 4) ? "echo: exit" : "echo: hello");
+            g_sem++;
+            socket.close();
+            exit(0);
+        }
+    }
+    // Host
+    ThreadEchoServer server("localhost", "3000");
+    server.start_sharded(3, true);
+    ASSERT_EQ(wait(NULL), -1);
+}
+
+/// @brief Tested: a second server can't bind the port of another one, unless
+///  the first one shares it with Server::start_sharded().
+TEST (ServerTest, PortInUse) {
+    EchoServer server("127.0.0.1", "3001");
+    ASSERT_EQ(listen(server.get_socket().get_sockfd(), 1), 0);
+    EXPECT_THROW(EchoServer("127.0.0.1", "3001"), std::runtime_error);
+}
+
+/// @brief Tested: Server::start_prefork(), with multiple clients.
+TEST (ServerTest, PreforkMultipleClients) {
+    uint8_t i;
+    Sem g_sem(".", 2, true);
+    g_sem = 0;
+    for (i=0; i<5; i++) {
+        if (!fork()) {
+            // Client
+            if (i == 4) {
+                g_sem.op(-4);
+            }
+            while(!Socket::is_listening("localhost", "3000"));
+            Socket socket("localhost", "3000");
+            msg_t msg;
+            msg.number = i;
+            strcpy(msg.text, (i == 4) ? "exit" : "hello");
+            ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_EQ(msg.number, i);
+            ASSERT_STREQ(msg.text, (i == 4) ? "echo: exit" : "echo: hello");
+            socket.close();
+            g_sem++;
+            exit(0);
+        }
+    }
+    // Host
+    EchoServer server("localhost", "3000");
+    server.start_prefork(2);
+    while (wait(NULL) != -1);
+    EXPECT_EQ(g_sem.get(), 1);
+}
+
+/// @brief Tested: Server::start_prefork(), replacing a dead worker.
+TEST (ServerTest, PreforkRespawn) {
+    Sem g_sem(".", 2, true);
+    g_sem = 0;
+    if (!fork()) {
+        // Client
+        msg_t msg;
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket first("localhost", "3000");
+        strcpy(msg.text, "crash");
+        ASSERT_EQ(first.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        // Closed or reset, as the message was never read.
+        ASSERT_LE(first.read(&msg, sizeof(msg_t)), 0);
+        first.close();
+        // Attended by a new worker.
+        Socket second("localhost", "3000");
+        strcpy(msg.text, "exit");
+        ASSERT_EQ(second.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(second.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: exit");
+        second.close();
+        g_sem++;
+        exit(0);
+    } else {
+        // Host
+        CrashingEchoServer server("localhost", "3000");
+        server.start_prefork(1);
+        while (wait(NULL) != -1);
+        EXPECT_EQ(g_sem.get(), 1);
+    }
+}
+
+/// @brief Tested: Server::start_uring(), Server::send_async(), with multiple
+///  clients connected at the same time to a single process.
+TEST (ServerTest, UringMultipleClients) {
+    uint8_t i;
+    Sem g_sem(".", 2, true);
+    g_sem = 0;
+    for (i=0; i<5; i++) {
+        if (!fork()) {
+            // Client
+            while(!Socket::is_listening("localhost", "3000"));
+            Socket socket("localhost", "3000");
+            msg_t msg;
+            msg.number = i;
+            strcpy(msg.text, "hello");
+            ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+            ASSERT_STREQ(msg.text, "echo: hello");
+            ASSERT_EQ(msg.number, i);
+            g_sem++;
+            // Every client keeps its connection open until all of them were served.
+            g_sem.op(0);
+            socket.close();
+            exit(0);
+        }
+    }
+    if (!fork()) {
+        g_sem.op(-5);
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket socket("localhost", "3000");
+        msg_t msg;
+        strcpy(msg.text, "exit");
+        ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: exit");
+        socket.close();
+        exit(0);
+    }
+    // Host
+    UringEchoServer server("localhost", "3000");
+    server.start_uring();
+    ASSERT_EQ(wait(NULL), -1);
+}
+
+/// @brief Tested: Server::start_reactor(), with on_data() instead of on_readable().
+TEST (ServerTest, ReactorData) {
+    if (!fork()) {
+        // Client
+        msg_t msg;
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket socket("localhost", "3000");
+        strcpy(msg.text, "first");
+        ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: first");
+        strcpy(msg.text, "exit");
+        ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: exit");
+        socket.close();
+        exit(0);
+    } else {
+        // Host
+        UringEchoServer server("localhost", "3000");
+        server.start_reactor();
+        ASSERT_EQ(wait(NULL), -1);
+    }
+}
+
+/// @brief Tested: Server::send_async() in reactor mode doesn't block the other
+///  clients while one doesn't read what it's sent.
+TEST (ServerTest, ReactorSlowReader) {
+    Sem g_sem(".", 2, true);
+    g_sem = 0;
+    if (!fork()) {
+        // Slow client. Reads the bulk data only after the other one was served.
+        std::vector<char> bulk(BULK_SIZE);
+        msg_t msg;
+        int len = 0, n;
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket socket("localhost", "3000");
+        strcpy(msg.text, "bulk");
+        ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        g_sem++;
+        g_sem.op(-2);
+        while (len < BULK_SIZE && (n = socket.read(bulk.data() + len, BULK_SIZE - len)) > 0) {
+            len += n;
+        }
+        ASSERT_EQ(len, BULK_SIZE);
+        for (int i = 0; i < BULK_SIZE; i++) {
+            ASSERT_EQ(bulk[i], (char) (i % 251));
+        }
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t), MSG_WAITALL), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: bulk");
+        strcpy(msg.text, "exit");
+        ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t), MSG_WAITALL), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: exit");
+        socket.close();
+        exit(0);
+    }
+    if (!fork()) {
+        g_sem.op(-1);
+        Socket socket("localhost", "3000");
+        msg_t msg;
+        strcpy(msg.text, "hello");
+        ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: hello");
+        g_sem.op(2);
+        socket.close();
+        exit(0);
+    }
+    // Host
+    BulkEchoServer server("localhost", "3000");
+    server.start_reactor();
+    ASSERT_EQ(wait(NULL), -1);
+}
+
+/// @brief Tested: Varint encoding of the frame length prefix.
+TEST (FramedSocketTest, Varint) {
+    uint32_t values[] = {0, 1, 127, 128, 300, 16383, 16384, FRAME_MAX_SIZE, 0xFFFFFFFF};
+    int lengths[] = {1, 1, 1, 2, 2, 2, 3, 4, 5};
+    char buf[FRAME_HEADER_MAX];
+    uint32_t value;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        ASSERT_EQ(FramedSocket::encode_varint(values[i], buf), lengths[i]);
+        ASSERT_EQ(FramedSocket::decode_varint(buf, lengths[i], &value), lengths[i]);
+        ASSERT_EQ(value, values[i]);
+        // Incomplete varint.
+        ASSERT_EQ(FramedSocket::decode_varint(buf, lengths[i] - 1, &value), 0);
+    }
+    memset(buf, 0xFF, sizeof(buf));
+    ASSERT_EQ(FramedSocket::decode_varint(buf, sizeof(buf), &value), -1);
+}
+
+/// @brief Tested: Many small frames batched in a single write, and a frame
+///  larger than the buffers, echoed back by the server.
+TEST (FramedSocketTest, Echo) {
+    if (!fork()) {
+        // Client
+        char text[64];
+        std::vector<char> big(3 * FRAME_BUFFER_SIZE), frame(3 * FRAME_BUFFER_SIZE);
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket socket("localhost", "3000");
+        FramedSocket framed(socket);
+        for (int i = 0; i < 100; i++) {
+            sprintf(text, "frame %d", i);
+            ASSERT_EQ(framed.write_frame(text, strlen(text), true), (int) strlen(text));
+        }
+        ASSERT_EQ(framed.flush(), 0);
+        for (int i = 0; i < 100; i++) {
+            sprintf(text, "frame %d", i);
+            ASSERT_EQ(framed.read_frame(frame.data(), frame.size()), (int) strlen(text));
+            ASSERT_EQ(memcmp(frame.data(), text, strlen(text)), 0);
+        }
+        for (size_t i = 0; i < big.size(); i++) {
+            big[i] = (char) i;
+        }
+        ASSERT_EQ(framed.write_frame(big.data(), big.size()), (int) big.size());
+        ASSERT_EQ(framed.read_frame(frame.data(), frame.size()), (int) big.size());
+        ASSERT_EQ(memcmp(frame.data(), big.data(), big.size()), 0);
+        // Frame larger than the user's buffer.
+        ASSERT_EQ(framed.write_frame(big.data(), big.size()), (int) big.size());
+        ASSERT_EQ(framed.read_frame(frame.data(), 10), -1);
+        ASSERT_EQ(errno, EMSGSIZE);
+        ASSERT_EQ(framed.write_frame("exit", 4), 4);
+        ASSERT_EQ(framed.read_frame(frame.data(), frame.size()), 4);
+        ASSERT_EQ(framed.read_frame(frame.data(), frame.size()), 0);
+        socket.close();
+        exit(0);
+    } else {
+        // Host
+        FramedEchoServer server("localhost", "3000");
+        server.start();
+        ASSERT_EQ(wait(NULL), -1);
+    }
+}
+
+/// @brief Tested: A frame larger than the buffers written to a non blocking
+///  socket with a small send buffer. The part the kernel can't take is kept
+///  for FramedSocket::flush(), and the next frame arrives intact after it.
+TEST (FramedSocketTest, NonBlockingLargeFrame) {
+    Socket listener("127.0.0.1", "3002", AF_INET, SOCK_STREAM, true);
+    ASSERT_EQ(listen(listener.get_sockfd(), 1), 0);
+    Socket client("127.0.0.1", "3002", AF_INET);
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = accept(listener.get_sockfd(), (struct sockaddr*) &addr, &addr_len), small = 128 * 1024;
+    ASSERT_NE(fd, -1);
+    Socket peer;
+    ASSERT_EQ(peer.init(fd, (struct sockaddr*) &addr), 0);
+    ASSERT_EQ(setsockopt(client.get_sockfd(), SOL_SOCKET, SO_SNDBUF, &small, sizeof(small)), 0);
+    ASSERT_EQ(client.set_nonblocking(), 0);
+    ASSERT_EQ(peer.set_nonblocking(), 0);
+    FramedSocket writer(client, 1024), reader(peer, 1024);
+    std::vector<char> big(8 << 20), frame(8 << 20);
+    for (size_t i = 0; i < big.size(); i++) {
+        big[i] = (char) (i * 7);
+    }
+    ASSERT_EQ(writer.write_frame(big.data(), big.size()), (int) big.size());
+    int len = -1;
+    bool queued = false;
+    while (len == -1) {
+        // The next frame only fits once the rest of the big one is sent.
+        if (!queued && writer.write_frame("end", 3) == 3) {
+            queued = true;
+        } else {
+            writer.flush();
+        }
+        if ( (len = reader.read_frame(frame.data(), frame.size())) == -1) {
+            ASSERT_EQ(errno, EAGAIN);
+        }
+    }
+    ASSERT_EQ(len, (int) big.size());
+    ASSERT_EQ(memcmp(frame.data(), big.data(), big.size()), 0);
+    while (!queued) {
+        queued = writer.write_frame("end", 3) == 3;
+    }
+    while ( (len = reader.read_frame(frame.data(), frame.size())) == -1) {
+        ASSERT_EQ(errno, EAGAIN);
+        writer.flush();
+    }
+    ASSERT_EQ(len, 3);
+    ASSERT_EQ(memcmp(frame.data(), "end", 3), 0);
+    // Sockets can be assigned, sharing the file descriptor.
+    Socket copy;
+    copy = peer;
+    ASSERT_EQ(copy.get_sockfd(), fd);
+    ASSERT_EQ(copy.get_peer_port(), client.get_my_port());
+}
+
+/// @brief Tested: Coalesced writes, "read_until()", views and the stream
+///  operators of BufferedSocket, with a ring small enough to wrap around.
+TEST (BufferedSocketTest, LineEcho) {
+    if (!fork()) {
+        // Client
+        char text[64], line[64];
+        const char* view;
+        int number;
+        char c;
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket socket("localhost", "3000");
+        ASSERT_THROW(BufferedSocket(socket, 0), std::runtime_error);
+        BufferedSocket buffered(socket, 64);
+        for (int i = 0; i < 100; i++) {
+            sprintf(text, "line %d\n", i);
+            ASSERT_EQ(buffered.write(text, strlen(text)), (int) strlen(text));
+        }
+        for (int i = 0; i < 100; i++) {
+            sprintf(text, "line %d\n", i);
+            if (i % 2) {
+                ASSERT_EQ(buffered.read_until('\n', line, sizeof(line)), (int) strlen(text));
+                ASSERT_EQ(memcmp(line, text, strlen(text)), 0);
+            } else {
+                ASSERT_EQ(buffered.peek_until('\n', &view), (int) strlen(text));
+                ASSERT_EQ(memcmp(view, text, strlen(text)), 0);
+                buffered.consume(strlen(text));
+            }
+        }
+        buffered << 1234 << '\n';
+        ASSERT_EQ(buffered.peek(&view, sizeof(int)), (int) sizeof(int));
+        buffered >> number >> c;
+        ASSERT_EQ(number, 1234);
+        ASSERT_EQ(c, '\n');
+        ASSERT_EQ(buffered.write("exit\n", 5), 5);
+        ASSERT_EQ(buffered.read_exact(line, 5), 5);
+        ASSERT_EQ(memcmp(line, "exit\n", 5), 0);
+        ASSERT_EQ(buffered.read(line, sizeof(line)), 0);
+        socket.close();
+        exit(0);
+    } else {
+        // Host
+        LineEchoServer server("localhost", "3000");
+        server.start();
+        ASSERT_EQ(wait(NULL), -1);
+    }
+}
+
+/// @brief Tested: A "msg_t" written from two buffers and read into two
+///  buffers, without joining them in user space.
+TEST (SocketTest, Vectored) {
+    if (!fork()) {
+        // Client
+        char text[50] = "vectored";
+        int number = 7;
+        char reply[offsetof(msg_t, number)];
+        msg_t tail;
+        struct iovec iov[2];
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket socket("localhost", "3000");
+        iov[0].iov_base = text;
+        iov[0].iov_len = offsetof(msg_t, number);
+        iov[1].iov_base = &number;
+        iov[1].iov_len = sizeof(msg_t) - offsetof(msg_t, number);
+        ASSERT_EQ(socket.writev(iov, 2), sizeof(msg_t));
+        iov[0].iov_base = reply;
+        iov[1].iov_base = &tail.number;
+        ASSERT_EQ(socket.readv(iov, 2, MSG_WAITALL), sizeof(msg_t));
+        ASSERT_STREQ(reply, "echo: vectored");
+        ASSERT_EQ(tail.number, 7);
+        strcpy(text, "exit");
+        iov[0].iov_base = text;
+        iov[1].iov_base = &number;
+        ASSERT_EQ(socket.writev(iov, 2), sizeof(msg_t));
+        ASSERT_EQ(socket.read(&tail, sizeof(msg_t), MSG_WAITALL), sizeof(msg_t));
+        socket.close();
+        exit(0);
+    } else {
+        // Host
+        EchoServer server("localhost", "3000");
+        server.start();
+        ASSERT_EQ(wait(NULL), -1);
+    }
+}
+
+/// @brief Tested: Many UDP datagrams sent and received in batches, and
+///  answered to the address each one came from.
+TEST (SocketTest, DatagramBatch) {
+    Sem g_sem(".", 2, true);
+    g_sem = 0;
+    if (!fork()) {
+        // Client
+        char buffers[100][16], replies[100][16];
+        struct iovec datagrams[100];
+        int received = 0, aux;
+        g_sem--;
+        Socket socket("127.0.0.1", "3000", AF_INET, SOCK_DGRAM);
+        for (int i = 0; i < 100; i++) {
+            datagrams[i].iov_base = buffers[i];
+            datagrams[i].iov_len = sprintf(buffers[i], "dgram %d", i) + 1;
+        }
+        ASSERT_EQ(socket.write_batch(datagrams, 100), 100);
+        while (received < 100) {
+            for (int i = received; i < 100; i++) {
+                datagrams[i].iov_base = replies[i];
+                datagrams[i].iov_len = sizeof(replies[i]);
+            }
+            ASSERT_GT( (aux = socket.read_batch(&datagrams[received], 100 - received)), 0);
+            received += aux;
+        }
+        for (int i = 0; i < 100; i++) {
+            ASSERT_STREQ(replies[i], buffers[i]);
+            ASSERT_EQ(datagrams[i].iov_len, strlen(buffers[i]) + 1);
+        }
+        exit(0);
+    } else {
+        // Host
+        Socket socket("127.0.0.1", "3000", AF_INET, SOCK_DGRAM, true);
+        char buffers[SOCKET_BATCH_MAX][16];
+        struct iovec datagrams[SOCKET_BATCH_MAX];
+        struct sockaddr_storage addrs[SOCKET_BATCH_MAX];
+        int received = 0, aux;
+        g_sem++;
+        while (received < 100) {
+            for (int i = 0; i < SOCKET_BATCH_MAX; i++) {
+                datagrams[i].iov_base = buffers[i];
+                datagrams[i].iov_len = sizeof(buffers[i]);
+            }
+            ASSERT_GT( (aux = socket.read_batch(datagrams, SOCKET_BATCH_MAX, addrs)), 0);
+            ASSERT_EQ(socket.write_batch(datagrams, aux, addrs), aux);
+            received += aux;
+        }
+        wait(NULL);
+    }
+}
+
+/// @brief Tested: A file sent with "sendfile()" in several parts.
+TEST (SocketTest, SendFile) {
+    char path[] = "/tmp/ccotti_sendfile_XXXXXX";
+    std::vector<char> data(1 << 20), received(1 << 20);
+    int fd = mkstemp(path);
+    ASSERT_NE(fd, -1);
+    unlink(path);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (char) (i * 7);
+    }
+    ASSERT_EQ(write(fd, data.data(), data.size()), (ssize_t) data.size());
+    if (!fork()) {
+        // Client
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket socket("localhost", "3000");
+        socket << 'f';
+        ASSERT_EQ(socket.read(received.data(), received.size(), MSG_WAITALL), (int) received.size());
+        ASSERT_EQ(memcmp(received.data(), data.data(), data.size()), 0);
+        socket.close();
+        exit(0);
+    } else {
+        // Host
+        FileServer server("localhost", "3000", fd, data.size());
+        server.start();
+        wait(NULL);
+        close(fd);
+    }
+}
+
+/// @brief Tested: An echo server reached through a "splice()" proxy.
+TEST (SocketTest, Proxy) {
+    pid_t proxy, client;
+    if ( (proxy = fork()) == 0) {
+        // Proxy
+        while(!Socket::is_listening("localhost", "3000"));
+        ProxyServer server("localhost", "3001", "3000");
+        server.start();
+        exit(0);
+    }
+    if ( (client = fork()) == 0) {
+        // Client
+        msg_t msg;
+        while(!Socket::is_listening("localhost", "3001"));
+        Socket socket("localhost", "3001");
+        strcpy(msg.text, "proxied");
+        ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t), MSG_WAITALL), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: proxied");
+        strcpy(msg.text, "exit");
+        ASSERT_EQ(socket.write(&msg, sizeof(msg_t)), sizeof(msg_t));
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t), MSG_WAITALL), sizeof(msg_t));
+        ASSERT_STREQ(msg.text, "echo: exit");
+        // The proxy forwards the server's close.
+        ASSERT_EQ(socket.read(&msg, sizeof(msg_t)), 0);
+        socket.close();
+        exit(0);
+    }
+    // Host
+    EchoServer server("localhost", "3000");
+    server.start();
+    waitpid(client, NULL, 0);
+    Signal::kill(proxy, SIGINT);
+    waitpid(proxy, NULL, 0);
+}
+
+static void count_release(const void* buf, int len, bool copied, void* arg) {
+    *((int*) arg) += 1;
+}
+
+/// @brief Tested: Buffers sent with MSG_ZEROCOPY are released through the
+///  callback once the kernel is done with them.
+TEST (SocketTest, ZeroCopy) {
+    if (!fork()) {
+        // Client
+        std::vector<char> buffers[4];
+        int released = 0;
+        char ack;
+        while(!Socket::is_listening("localhost", "3000"));
+        Socket socket("localhost", "3000");
+        ASSERT_EQ(socket.get_zerocopy_pending(), 0);
+        ASSERT_EQ(socket.write_zerocopy("x", 1), -1);
+        ASSERT_EQ(errno, EINVAL);
+        ASSERT_EQ(socket.set_zerocopy(), 0);
+        for (int i = 0; i < 4; i++) {
+            buffers[i].assign(1 << 20, (char) i);
+            ASSERT_EQ(socket.write_zerocopy(buffers[i].data(), buffers[i].size(), count_release, &released), 1 << 20);
+        }
+        while (socket.get_zerocopy_pending() > 0) {
+            ASSERT_NE(socket.reap_zerocopy(-1), -1);
+        }
+        ASSERT_EQ(released, 4);
+        socket >> ack;
+        ASSERT_EQ(ack, 'k');
+        socket.close();
+        exit(0);
+    } else {
+        // Host
+        DrainServer server("localhost", "3000", 4 << 20);
+        server.start();
+        wait(NULL);
+    }
+}
@@ -3,6 +3,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/wait.h>
+#include <vector>
 
 /// @brief Tested: SharedMemory::ShareMemory(), SharedMemory::exists()
 TEST(SharedMemTest, Creation) {
@@ -103,3 +105,199 @@ TEST(SharedMemoryTest, StructType) {
         EXPECT_STREQ(shm[1].name, "zzz1");
     }
 }
+
+/// @brief Tested: bounds checking of the array methods, SharedMemory::get_size(),
+///  shm_stream_copy().
+TEST(SharedMemoryTest, BulkCopy) {
+    const int size = 1024 * 1024 + 5;
+    SharedMemory<int> shm(".", 2, size);
+    std::vector<int> data(size), copy(size, 0);
+    EXPECT_EQ(shm.get_size(), (size_t) size);
+    for (int i = 0; i < size; i++) {
+        data[i] = i;
+    }
+    EXPECT_EQ(shm.write(data.data(), 2, size - 1), -1);
+    EXPECT_EQ(errno, ERANGE);
+    EXPECT_EQ(shm.read(copy.data(), 1, -1), -1);
+    EXPECT_EQ(errno, ERANGE);
+    EXPECT_EQ(shm.write(data.data() + 1, size - 1, 1), 0);  // Unaligned in both sides.
+    shm << 0;
+    if (!fork()) {
+        SharedMemory<int> child_shm(".", 2);
+        EXPECT_EQ(child_shm.get_size(), (size_t) size);
+        EXPECT_EQ(child_shm.read(copy.data(), 2, size - 1), -1);   // Past the end.
+        EXPECT_EQ(child_shm.read(copy.data(), size), 0);
+        EXPECT_TRUE(copy == data);
+        exit(0);
+    }
+    wait(NULL);
+    EXPECT_EQ(shm.read(copy.data(), 3, size - 3), 0);
+    EXPECT_EQ(copy[2], size - 1);
+}
+
+/// @brief Tested: shm_stream_copy() with every alignment and tail length.
+TEST(SharedMemoryTest, StreamCopy) {
+    SharedMemory<char> shm(".", 2, 4096);
+    char data[1024];
+    for (int i = 0; i < 1024; i++) {
+        data[i] = (char) i;
+    }
+    for (int offset = 0; offset < 16; offset++) {
+        for (int len = 0; len < 200; len += 7) {
+            memset(&shm[0], 0, 4096);
+            shm_stream_copy(&shm[offset], data + 3, len);
+            EXPECT_EQ(memcmp(&shm[offset], data + 3, len), 0);
+            EXPECT_EQ(shm[offset + len], 0);
+            if (offset) {
+                EXPECT_EQ(shm[offset - 1], 0);
+            }
+        }
+    }
+}
+
+/// @brief Returns how many pages of the memory at "address" are in RAM.
+static size_t resident_pages(void* address, size_t length) {
+    size_t page = sysconf(_SC_PAGESIZE), count = 0;
+    std::vector<unsigned char> pages((length + page - 1) / page);
+    if (mincore(address, length, pages.data()) == -1) {
+        return 0;
+    }
+    for (size_t i = 0; i < pages.size(); i++) {
+        count += pages[i] & 1;
+    }
+    return count;
+}
+
+/// @brief Tested: SharedMemory::SharedMemory() and SharedMemory::exists() with
+///  SHMEM_POSIX, SHMEM_POPULATE.
+TEST(SharedMemoryTest, PosixBackend) {
+    const int size = 64 * 1024;
+    EXPECT_FALSE(SharedMemory<int>::exists(".", 2, SHMEM_POSIX));
+    EXPECT_THROW(SharedMemory<int>(".", 2, 0, SHMEM_POSIX), std::runtime_error);
+    {
+        SharedMemory<int> shm(".", 2, size, SHMEM_POSIX | SHMEM_POPULATE);
+        EXPECT_TRUE(SharedMemory<int>::exists(".", 2, SHMEM_POSIX));
+        EXPECT_FALSE(SharedMemory<int>::exists(".", 2));
+        EXPECT_THROW(SharedMemory<int>(".", 2, size, SHMEM_POSIX), std::runtime_error);
+        EXPECT_EQ(resident_pages(&shm[0], size * sizeof(int)), size * sizeof(int) / sysconf(_SC_PAGESIZE));
+        shm << 10;
+        if (!fork()) {
+            SharedMemory<int> child_shm(".", 2, 0, SHMEM_POSIX);
+            EXPECT_EQ(child_shm.get_size(), (size_t) size);
+            child_shm[0] += 10;
+            child_shm.write(30, size - 1);
+            exit(0);
+        }
+        wait(NULL);
+        EXPECT_EQ(shm[0], 20);
+        EXPECT_EQ(shm.read(size - 1), 30);
+    }
+    EXPECT_FALSE(SharedMemory<int>::exists(".", 2, SHMEM_POSIX));
+}
+
+/// @brief Tested: SHMEM_MEMFD, SHMEM_THP, SHMEM_LOCK, SHMEM_POPULATE and NUMA
+///  binding, with each backend.
+TEST(SharedMemoryTest, PageOptions) {
+    const int size = 256 * 1024;
+    const int flags = SHMEM_THP | SHMEM_LOCK | SHMEM_POPULATE;
+    const size_t pages = size * sizeof(int) / sysconf(_SC_PAGESIZE);
+    EXPECT_THROW(SharedMemory<int>(".", 2, 0, SHMEM_MEMFD), std::runtime_error);
+    EXPECT_THROW(SharedMemory<int>(".", 2, size, SHMEM_POSIX | SHMEM_HUGETLB), std::runtime_error);
+    EXPECT_THROW(SharedMemory<int>(".", 2, size, SHMEM_SYSV, 1000), std::runtime_error);
+    EXPECT_FALSE(SharedMemory<int>::exists(".", 2));
+    SharedMemory<int> memfd(".", 2, size, SHMEM_MEMFD | flags, 0);
+    SharedMemory<int> sysv(".", 2, size, SHMEM_SYSV | flags, 0);
+    SharedMemory<int> posix(".", 2, size, SHMEM_POSIX | flags);
+    EXPECT_FALSE(SharedMemory<int>::exists(".", 2, SHMEM_MEMFD));
+    EXPECT_EQ(resident_pages(&memfd[0], size * sizeof(int)), pages);
+    EXPECT_EQ(resident_pages(&sysv[0], size * sizeof(int)), pages);
+    EXPECT_EQ(resident_pages(&posix[0], size * sizeof(int)), pages);
+    memfd << 10;
+    if (!fork()) {
+        memfd[0] += 10;     // Inherited mapping.
+        exit(0);
+    }
+    wait(NULL);
+    EXPECT_EQ(memfd[0], 20);
+}
+
+/// @brief Tested: SHMEM_HUGETLB. Needs huge pages reserved in the system
+///  (/proc/sys/vm/nr_hugepages).
+TEST(SharedMemoryTest, HugePages) {
+    const int size = SHMEM_HUGE_PAGE / sizeof(int) + 1;   // Two huge pages.
+    try {
+        SharedMemory<int> sysv(".", 2, size, SHMEM_SYSV | SHMEM_HUGETLB | SHMEM_POPULATE);
+        SharedMemory<int> memfd(".", 3, size, SHMEM_MEMFD | SHMEM_HUGETLB | SHMEM_POPULATE);
+        sysv.write(10, size - 1);
+        memfd.write(20, size - 1);
+        EXPECT_EQ(sysv.read(size - 1), 10);
+        EXPECT_EQ(memfd.read(size - 1), 20);
+    } catch (std::runtime_error&) {
+        GTEST_SKIP() << "no huge pages reserved";
+    }
+}
+
+/// @brief Tested: SHMEM_SEQLOCK, SharedMemory::get_version(). Writers in two
+///  processes write whole arrays of equal values, while readers check that
+///  their snapshots are never a mix of two writes.
+TEST(SharedMemoryTest, Seqlock) {
+    struct counted_t {
+        long value;
+        counted_t& operator= (const counted_t& other) { this->value = other.value; return *this; }
+    };
+    const int size = 64, writes = 20000, readers = 2;
+    EXPECT_THROW(SharedMemory<counted_t>(".", 2, 1, SHMEM_SEQLOCK), std::runtime_error);
+    SharedMemory<long> shm(".", 2, size, SHMEM_SEQLOCK);
+    SharedMemory<long> results(".", 3, readers);
+    long array[size];
+    EXPECT_EQ(shm.get_version(), (uint32_t) 0);
+    for (int i = 0; i < size; i++) {
+        array[i] = 0;
+    }
+    EXPECT_EQ(shm.write(array, size), 0);
+    shm.write(5, size - 1);
+    EXPECT_EQ(shm.read(size - 1), 5);
+    shm.write(0L, size - 1);
+    EXPECT_EQ(shm.get_version(), (uint32_t) 6);
+    for (int r = 0; r < readers; r++) {
+        results[r] = 0;
+    }
+    for (int w = 1; w <= 2; w++) {
+        if (!fork()) {
+            SharedMemory<long> child_shm(".", 2, 0, SHMEM_SEQLOCK);
+            long values[size];
+            EXPECT_EQ(child_shm.get_size(), (size_t) size);
+            for (int i = 0; i < writes; i++) {
+                for (int j = 0; j < size; j++) {
+                    values[j] = w * writes + i;
+                }
+                child_shm.write(values, size);
+            }
+            exit(0);
+        }
+    }
+    for (int r = 0; r < readers; r++) {
+        if (!fork()) {
+            SharedMemory<long> child_shm(".", 2, 0, SHMEM_SEQLOCK);
+            SharedMemory<long> child_results(".", 3);
+            long values[size];
+            for (int i = 0; i < writes; i++) {
+                child_shm.read(values, size);
+                for (int j = 1; j < size; j++) {
+                    if (values[j] != values[0]) {
+                        child_results[r]++;
+                        break;
+                    }
+                }
+            }
+            exit(0);
+        }
+    }
+    for (int p = 0; p < 2 + readers; p++) {
+        wait(NULL);
+    }
+    for (int r = 0; r < readers; r++) {
+        EXPECT_EQ(results[r], 0);
+    }
+    EXPECT_EQ(shm.get_version(), (uint32_t) (6 + 2 * 2 * writes));
+}
@@ -0,0 +1,112 @@
+#include "shm_arena.h"
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <errno.h>
+#include <vector>
+
+typedef std::vector<int, ShmAllocator<int>> shm_vector;
+
+struct node_t {
+    int value;
+    ShmPtr<node_t> next;
+};
+
+/// @brief Tested: ShmArena::ShmArena(), ShmArena::exists(), allocate(),
+///  deallocate(), get_used().
+TEST(ShmArenaTest, AllocateFree) {
+    EXPECT_FALSE(ShmArena::exists(".", 2));
+    EXPECT_THROW(ShmArena(".", 2), std::runtime_error);
+    ShmArena arena(".", 2, 1024 * 1024);
+    EXPECT_TRUE(ShmArena::exists(".", 2));
+    EXPECT_EQ(arena.get_size(), (size_t) 1024 * 1024);
+    EXPECT_EQ(arena.get_used(), (size_t) 0);
+    char* small = (char*) arena.allocate(20);
+    char* large = (char*) arena.allocate(100000);
+    ASSERT_NE(small, nullptr);
+    ASSERT_NE(large, nullptr);
+    EXPECT_EQ((uintptr_t) small % SHM_ARENA_ALIGN, (uintptr_t) 0);
+    EXPECT_EQ((uintptr_t) large % SHM_ARENA_ALIGN, (uintptr_t) 0);
+    EXPECT_TRUE(arena.contains(small));
+    EXPECT_FALSE(arena.contains(&arena));
+    EXPECT_EQ(arena.get_used(), (size_t) 32 + 100000);
+    arena.deallocate(small);
+    arena.deallocate(large);
+    EXPECT_EQ(arena.get_used(), (size_t) 0);
+    // Freed blocks are reused by their size class, or by the best fit.
+    EXPECT_EQ(arena.allocate(32), small);
+    EXPECT_EQ(arena.allocate(90000), large);
+    EXPECT_EQ(arena.allocate(2 * 1024 * 1024), nullptr);
+    EXPECT_EQ(errno, ENOMEM);
+    EXPECT_EQ(arena.allocate(SIZE_MAX), nullptr);
+    EXPECT_EQ(errno, ENOMEM);
+    EXPECT_EQ(arena.allocate(SIZE_MAX - 8), nullptr);
+    EXPECT_EQ(arena.allocate(SIZE_MAX - 2 * sizeof(uint64_t)), nullptr);
+}
+
+/// @brief Tested: ShmPtr, ShmArena::construct(), set_root(), get_root(), with
+///  a linked list used from another mapping of the arena, at another address.
+TEST(ShmArenaTest, OffsetPointers) {
+    ShmArena arena(".", 2, 1024 * 1024);
+    ShmPtr<node_t> head;
+    EXPECT_FALSE(head);
+    EXPECT_TRUE(head == nullptr);
+    for (int i = 0; i < 10; i++) {
+        node_t* node = arena.construct<node_t>();
+        node->value = i;
+        node->next = head;
+        head = node;
+    }
+    arena.set_root(head.get());
+    if (!fork()) {
+        ShmArena child_arena(".", 2);
+        int sum = 0;
+        EXPECT_NE(child_arena.get_header(), arena.get_header());
+        node_t* first = (node_t*) child_arena.get_root();
+        for (node_t* node = first; node != NULL; node = node->next.get()) {
+            EXPECT_TRUE(child_arena.contains(node));
+            sum += node->value;
+        }
+        EXPECT_EQ(sum, 45);
+        node_t* node = child_arena.construct<node_t>();
+        node->value = 100;
+        node->next = first;
+        child_arena.set_root(node);
+        exit(0);
+    }
+    wait(NULL);
+    int sum = 0;
+    for (ShmPtr<node_t> node((node_t*) arena.get_root()); node; node = node->next) {
+        sum += node->value;
+    }
+    EXPECT_EQ(sum, 145);
+}
+
+/// @brief Tested: ShmAllocator with std::vector built in the arena, and grown
+///  by another process through its own mapping.
+TEST(ShmArenaTest, Containers) {
+    ShmArena arena(".", 2, 1024 * 1024);
+    shm_vector* vector = arena.construct<shm_vector>(ShmAllocator<int>(arena));
+    for (int i = 0; i < 10; i++) {
+        vector->push_back(i);
+    }
+    arena.set_root(vector);
+    if (!fork()) {
+        ShmArena child_arena(".", 2);
+        shm_vector* child_vector = (shm_vector*) child_arena.get_root();
+        EXPECT_EQ(child_vector->size(), (size_t) 10);
+        EXPECT_EQ((*child_vector)[9], 9);
+        for (int i = 10; i < 1000; i++) {
+            child_vector->push_back(i);
+        }
+        exit(0);
+    }
+    wait(NULL);
+    ASSERT_EQ(vector->size(), (size_t) 1000);
+    long sum = 0;
+    for (int value : *vector) {
+        sum += value;
+    }
+    EXPECT_EQ(sum, 999 * 1000 / 2);
+    arena.destroy(vector);
+    EXPECT_EQ(arena.get_used(), (size_t) 0);
+}
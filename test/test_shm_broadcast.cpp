@@ -0,0 +1,92 @@
+#include "shm_broadcast.h"
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <errno.h>
+
+/// @brief Tested: ShmBroadcast::ShmBroadcast(), ShmBroadcast::exists()
+TEST(ShmBroadcastTest, Creation) {
+    EXPECT_FALSE(ShmBroadcast<int>::exists(".", 2));
+    EXPECT_THROW(ShmBroadcast<int>(".", 2), std::runtime_error);
+    ShmBroadcast<int> channel(".", 2, 10);
+    EXPECT_TRUE(ShmBroadcast<int>::exists(".", 2));
+    EXPECT_EQ(channel.get_capacity(), 16);
+    EXPECT_THROW(ShmBroadcast<int>(".", 2, 10), std::runtime_error);
+    // A memory that holds something else.
+    SharedMemory<char> other(".", 3, 4096);
+    memset(&(other[0]), 0xff, 4096);
+    EXPECT_THROW(ShmBroadcast<int>(".", 3), std::runtime_error);
+}
+
+/// @brief Tested: Joining mid-stream, seek_oldest(), seek_latest(), overrun
+///  detection and timed read().
+TEST(ShmBroadcastTest, Cursors) {
+    ShmBroadcast<int> channel(".", 2, 4);
+    int value, status;
+    channel << 0 << 1;
+    ShmBroadcast<int> late(".", 2);     // Joins after "1".
+    EXPECT_EQ(late.try_read(value), 0);
+    late.read(&status, 10);
+    EXPECT_EQ(status, ETIMEDOUT);
+    channel << 2;
+    EXPECT_EQ(late.get_pending(), 1);
+    EXPECT_EQ(late.try_read(value), 1);
+    EXPECT_EQ(value, 2);
+    late.seek_oldest();
+    EXPECT_EQ(late.read(), 0);
+
+    // Only the last 3 of the 4 slots are safe to read once lapped.
+    for (int i = 3; i < 10; i++) {
+        channel << i;
+    }
+    EXPECT_EQ(late.try_read(value), -1);
+    EXPECT_EQ(errno, EOVERFLOW);
+    EXPECT_EQ(late.get_lost(), 6UL);
+    for (int i = 7; i < 10; i++) {
+        EXPECT_EQ(late.try_read(value), 1);
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_EQ(late.try_read(value), 0);
+    channel << 10;
+    late.seek_latest();
+    EXPECT_EQ(late.try_read(value), 0);
+}
+
+/// @brief Tested: Every subscriber gets every message, in order, from a single
+///  publish.
+TEST(ShmBroadcastTest, FanOut) {
+    const int subscribers = 4, messages = 20000;
+    ShmBroadcast<int> channel(".", 2, messages);
+    // Sum and amount of messages read by each subscriber.
+    SharedMemory<long> results(".", 3, 2 * subscribers);
+    for (int i = 0; i < 2 * subscribers; i++) {
+        results[i] = 0;
+    }
+    for (int s = 0; s < subscribers; s++) {
+        if (!fork()) {
+            // Child
+            ShmBroadcast<int> child_channel(".", 2);
+            SharedMemory<long> child_results(".", 3);
+            int value;
+            child_channel.seek_oldest();
+            for (int i = 0; i < messages; i++) {
+                child_channel >> value;
+                if (value != i) {
+                    break;
+                }
+                child_results[2 * s] += value;
+                child_results[2 * s + 1]++;
+            }
+            exit(0);
+        }
+    }
+    for (int i = 0; i < messages; i++) {
+        channel << i;
+    }
+    for (int s = 0; s < subscribers; s++) {
+        wait(NULL);
+    }
+    for (int s = 0; s < subscribers; s++) {
+        EXPECT_EQ(results[2 * s + 1], messages);
+        EXPECT_EQ(results[2 * s], (long) messages * (messages - 1) / 2);
+    }
+}
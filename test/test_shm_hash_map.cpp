@@ -0,0 +1,176 @@
+#include "shm_hash_map.h"
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <errno.h>
+#include <time.h>
+
+typedef struct pair_t {
+    long key;
+    long twice;     // Always 2 * key, to catch torn reads.
+} pair_t;
+
+/// @brief Tested: ShmHashMap::ShmHashMap(), ShmHashMap::exists(), get_capacity().
+TEST(ShmHashMapTest, Creation) {
+    EXPECT_FALSE((ShmHashMap<int, int>::exists(".", 2)));
+    EXPECT_THROW((ShmHashMap<int, int>(".", 2)), std::runtime_error);
+    ShmHashMap<int, int> map(".", 2, 100);
+    EXPECT_TRUE((ShmHashMap<int, int>::exists(".", 2)));
+    EXPECT_EQ(map.get_capacity(), (size_t) 128);
+    EXPECT_EQ(map.get_size(), (size_t) 0);
+    EXPECT_THROW((ShmHashMap<int, int>(".", 2, 100)), std::runtime_error);
+    // A memory that holds something else.
+    SharedMemory<char> other(".", 3, 8192);
+    memset(&(other[0]), 0xff, 8192);
+    EXPECT_THROW((ShmHashMap<int, int>(".", 3)), std::runtime_error);
+}
+
+/// @brief Tested: insert(), find(), contains(), erase(), get_size(), and a
+///  full map.
+TEST(ShmHashMapTest, InsertFindErase) {
+    ShmHashMap<int, long> map(".", 2, 64);
+    long value;
+    EXPECT_FALSE(map.find(1, value));
+    EXPECT_EQ(map.insert(1, 10), 1);
+    EXPECT_EQ(map.insert(1, 11), 0);
+    EXPECT_TRUE(map.find(1, value));
+    EXPECT_EQ(value, 11);
+    EXPECT_EQ(map.erase(1), 1);
+    EXPECT_EQ(map.erase(1), 0);
+    EXPECT_FALSE(map.contains(1));
+    for (int i = 0; i < 64; i++) {
+        EXPECT_EQ(map.insert(i, i * 10L), 1);
+    }
+    EXPECT_EQ(map.get_size(), (size_t) 64);
+    EXPECT_EQ(map.insert(64, 640), -1);
+    EXPECT_EQ(errno, ENOSPC);
+    EXPECT_EQ(map.insert(63, 630), 0);     // Updates still work.
+    // Erased buckets are reused, and keys behind them still found.
+    for (int i = 0; i < 64; i += 2) {
+        EXPECT_EQ(map.erase(i), 1);
+    }
+    for (int i = 100; i < 132; i++) {
+        EXPECT_EQ(map.insert(i, i * 10L), 1);
+    }
+    for (int i = 0; i < 64; i++) {
+        EXPECT_EQ(map.contains(i), i % 2 == 1);
+    }
+    for (int i = 100; i < 132; i++) {
+        EXPECT_TRUE(map.find(i, value));
+        EXPECT_EQ(value, i * 10L);
+    }
+}
+
+/// @brief Tested: writers on disjoint keys in several processes, while readers
+///  check that they never see a half written value.
+TEST(ShmHashMapTest, ConcurrentReadersWriters) {
+    const int writers = 4, readers = 2, keys = 2000, rounds = 5;
+    ShmHashMap<long, pair_t> map(".", 2, writers * keys);
+    // Torn reads seen by each reader.
+    SharedMemory<long> results(".", 3, readers);
+    for (int r = 0; r < readers; r++) {
+        results[r] = 0;
+    }
+    for (int w = 0; w < writers; w++) {
+        if (!fork()) {
+            ShmHashMap<long, pair_t> child_map(".", 2);
+            for (int round = 0; round < rounds; round++) {
+                for (long k = w * keys; k < (w + 1) * keys; k++) {
+                    pair_t pair = {k + round, 2 * (k + round)};
+                    child_map.insert(k, pair);
+                }
+                for (long k = w * keys; k < (w + 1) * keys; k += 3) {
+                    child_map.erase(k);
+                }
+            }
+            exit(0);
+        }
+    }
+    for (int r = 0; r < readers; r++) {
+        if (!fork()) {
+            ShmHashMap<long, pair_t> child_map(".", 2);
+            SharedMemory<long> child_results(".", 3);
+            pair_t pair;
+            for (int i = 0; i < 20 * writers * keys; i++) {
+                if (child_map.find(i % (writers * keys), pair) && pair.twice != 2 * pair.key) {
+                    child_results[r]++;
+                }
+            }
+            exit(0);
+        }
+    }
+    for (int p = 0; p < writers + readers; p++) {
+        wait(NULL);
+    }
+    for (int r = 0; r < readers; r++) {
+        EXPECT_EQ(results[r], 0);
+    }
+    pair_t pair;
+    for (long k = 0; k < writers * keys; k++) {
+        if ((k % keys) % 3 == 0) {
+            EXPECT_FALSE(map.contains(k));
+        } else {
+            ASSERT_TRUE(map.find(k, pair));
+            EXPECT_EQ(pair.key, k + rounds - 1);
+        }
+    }
+    EXPECT_EQ(map.get_size(), (size_t) (writers * (keys - (keys + 2) / 3)));
+}
+
+/// @brief Nanoseconds per lookup of a missing key, the best of a few runs.
+static double miss_ns(ShmHashMap<long, long>& map) {
+    const int lookups = 100000;
+    double best = 1e9;
+    for (int run = 0; run < 5; run++) {
+        struct timespec begin, end;
+        long found = 0;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        for (long k = 0; k < lookups; k++) {
+            found += map.contains(-1 - k);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ns = ((end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec)) / lookups;
+        best = (ns < best && found == 0) ? ns : best;
+    }
+    return best;
+}
+
+/// @brief Tested: many insert() and erase() pairs don't fill the map with
+///  erased buckets (misses stay as fast as in a new map), and a reader never
+///  misses a key while they are cleaned up.
+TEST(ShmHashMapTest, Churn) {
+    const long keys = 512, pairs = 200000;
+    ShmHashMap<long, long> map(".", 2, 1024);
+    SharedMemory<long> misses(".", 3, 2);
+    misses[0] = misses[1] = 0;
+    for (long k = 0; k < keys; k++) {
+        map.insert(k, k);
+    }
+    double fresh = miss_ns(map);
+    pid_t reader = fork();
+    if (!reader) {
+        ShmHashMap<long, long> child_map(".", 2);
+        SharedMemory<long> child_misses(".", 3);
+        long value;
+        while (!child_misses[1]) {
+            for (long k = 0; k < keys; k++) {
+                if (!child_map.find(k, value) || value != k) {
+                    child_misses[0]++;
+                }
+            }
+        }
+        exit(0);
+    }
+    for (long i = 0; i < pairs; i++) {
+        EXPECT_EQ(map.insert(keys + i, i), 1);
+        EXPECT_EQ(map.erase(keys + i), 1);
+    }
+    misses[1] = 1;
+    waitpid(reader, NULL, 0);
+    EXPECT_EQ(misses[0], 0);
+    EXPECT_EQ(map.get_size(), (size_t) keys);
+    double churned = miss_ns(map);
+    EXPECT_LT(churned, 5 * fresh + 20);
+    for (long k = 0; k < keys; k++) {
+        EXPECT_TRUE(map.contains(k));
+    }
+}
@@ -0,0 +1,91 @@
+#include "shm_mpmc_queue.h"
+#include "shm_ring_queue.h"
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <errno.h>
+
+/// @brief Tested: ShmMpmcQueue::ShmMpmcQueue(), ShmMpmcQueue::exists()
+TEST(ShmMpmcQueueTest, Creation) {
+    EXPECT_FALSE(ShmMpmcQueue<int>::exists(".", 2));
+    EXPECT_THROW(ShmMpmcQueue<int>(".", 2), std::runtime_error);
+    ShmMpmcQueue<int> queue(".", 2, 10);
+    EXPECT_TRUE(ShmMpmcQueue<int>::exists(".", 2));
+    EXPECT_EQ(queue.get_capacity(), 16);
+    EXPECT_THROW(ShmMpmcQueue<int>(".", 2, 10), std::runtime_error);
+    // Another kind of structure.
+    ShmRingQueue<int> ring(".", 3, 10);
+    EXPECT_THROW(ShmMpmcQueue<int>(".", 3), std::runtime_error);
+}
+
+/// @brief Tested: try_write(), try_read(), timed write() and read(),
+///  get_msg_qtty(), is_empty(), has_msg().
+TEST(ShmMpmcQueueTest, TryAndTimeout) {
+    ShmMpmcQueue<int> queue(".", 2, 4);
+    int value, status;
+    EXPECT_TRUE(queue.is_empty());
+    EXPECT_FALSE(queue.has_msg());
+    EXPECT_FALSE(queue.try_read(value));
+    queue.read(&status, 10);
+    EXPECT_EQ(status, ETIMEDOUT);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.try_write(i));
+    }
+    EXPECT_FALSE(queue.try_write(4));
+    EXPECT_EQ(queue.write(4, 10), -1);
+    EXPECT_EQ(errno, ETIMEDOUT);
+    EXPECT_EQ(queue.get_msg_qtty(), 4);
+    EXPECT_TRUE(queue.try_read(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_EQ(queue.write(4, 10), 0);
+    for (int i = 1; i < 5; i++) {
+        EXPECT_EQ(queue.read(&status, 10), i);
+        EXPECT_EQ(status, 0);
+    }
+    EXPECT_TRUE(queue.is_empty());
+}
+
+/// @brief Tested: Several producers and consumers through a small queue, so
+///  that all of them have to wait. Every message must be read exactly once.
+TEST(ShmMpmcQueueTest, MultipleProducersConsumers) {
+    const int processes = 4, messages = 10000;
+    ShmMpmcQueue<int> queue(".", 2, 8);
+    // Sum and amount of messages read by each consumer.
+    SharedMemory<long> results(".", 3, 2 * processes);
+    for (int i = 0; i < 2 * processes; i++) {
+        results[i] = 0;
+    }
+    for (int p = 0; p < processes; p++) {
+        if (!fork()) {
+            // Producer
+            ShmMpmcQueue<int> child_queue(".", 2);
+            for (int i = 0; i < messages; i++) {
+                child_queue << p * messages + i;
+            }
+            exit(0);
+        }
+        if (!fork()) {
+            // Consumer
+            ShmMpmcQueue<int> child_queue(".", 2);
+            SharedMemory<long> child_results(".", 3);
+            int value;
+            for (int i = 0; i < messages; i++) {
+                child_queue >> value;
+                child_results[2 * p] += value;
+                child_results[2 * p + 1]++;
+            }
+            exit(0);
+        }
+    }
+    for (int i = 0; i < 2 * processes; i++) {
+        wait(NULL);
+    }
+    long sum = 0, count = 0;
+    for (int p = 0; p < processes; p++) {
+        sum += results[2 * p];
+        count += results[2 * p + 1];
+    }
+    long total = (long) processes * messages;
+    EXPECT_EQ(count, total);
+    EXPECT_EQ(sum, total * (total - 1) / 2);
+    EXPECT_TRUE(queue.is_empty());
+}
@@ -0,0 +1,180 @@
+#include "shm_rcu.h"
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <errno.h>
+
+/// @brief Tested: ShmRcu::ShmRcu(), ShmRcu::exists(), get_size(),
+///  get_generation().
+TEST(ShmRcuTest, Creation) {
+    EXPECT_FALSE(ShmRcu<int>::exists(".", 2));
+    EXPECT_THROW(ShmRcu<int>(".", 2), std::runtime_error);
+    EXPECT_THROW(ShmRcu<int>(".", 2, 10, 1), std::runtime_error);
+    ShmRcu<int> rcu(".", 2, 10);
+    EXPECT_TRUE(ShmRcu<int>::exists(".", 2));
+    EXPECT_EQ(rcu.get_size(), (size_t) 10);
+    EXPECT_EQ(rcu.get_generation(), (uint64_t) 1);
+    const int* version = rcu.read_lock();
+    ASSERT_NE(version, nullptr);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(version[i], 0);
+    }
+    rcu.read_unlock();
+    ShmRcu<int> other(".", 2);
+    EXPECT_EQ(other.get_size(), (size_t) 10);
+    // A memory that holds something else.
+    SharedMemory<char> not_rcu(".", 3, 4096);
+    memset(&(not_rcu[0]), 0xff, 4096);
+    EXPECT_THROW(ShmRcu<int>(".", 3), std::runtime_error);
+}
+
+/// @brief Tested: write_begin(), publish(), abort(), write(), read(), and
+///  that a version being read doesn't change.
+TEST(ShmRcuTest, Publish) {
+    ShmRcu<int> rcu(".", 2, 4);
+    int values[4] = {1, 2, 3, 4}, copy[4];
+    EXPECT_EQ(rcu.publish(), -1);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_EQ(rcu.write(values, 4), 0);
+    EXPECT_EQ(rcu.get_generation(), (uint64_t) 2);
+    const int* version = rcu.read_lock();
+    EXPECT_EQ(version[3], 4);
+    // Writes start from the last version, and are only seen once published.
+    int* next = rcu.write_begin();
+    ASSERT_NE(next, nullptr);
+    EXPECT_NE(next, version);
+    EXPECT_EQ(next[0], 1);
+    next[0] = 10;
+    EXPECT_EQ(version[0], 1);
+    EXPECT_EQ(rcu.publish(), 0);
+    EXPECT_EQ(version[0], 1);
+    rcu.read_unlock();
+    EXPECT_EQ(rcu.read(copy, 2, 0), 0);
+    EXPECT_EQ(copy[0], 10);
+    EXPECT_EQ(copy[1], 2);
+    EXPECT_EQ(rcu.read(copy, 2, 3), -1);
+    EXPECT_EQ(errno, ERANGE);
+    EXPECT_EQ(rcu.write(values, 1, 4), -1);
+    EXPECT_EQ(errno, ERANGE);
+    // Aborted writes aren't seen.
+    next = rcu.write_begin();
+    next[0] = 20;
+    rcu.abort();
+    EXPECT_EQ(rcu.read(copy, 1), 0);
+    EXPECT_EQ(copy[0], 10);
+    EXPECT_EQ(rcu.get_generation(), (uint64_t) 3);
+}
+
+/// @brief Tested: the writer doesn't reuse a copy while a reader in another
+///  process holds it, and reclaims the slot of a reader that died.
+TEST(ShmRcuTest, ReaderEpochs) {
+    ShmRcu<long> rcu(".", 2, 8);
+    SharedMemory<long> results(".", 3, 1);
+    results[0] = 0;
+    if (!fork()) {
+        ShmRcu<long> child_rcu(".", 2);
+        child_rcu.read_lock();
+        results[0] = 1;
+        while (results[0] != 2) {
+            sched_yield();
+        }
+        child_rcu.read_unlock();
+        results[0] = 3;
+        while (results[0] != 4) {
+            sched_yield();
+        }
+        child_rcu.read_lock();
+        exit(0);    // Dies while reading.
+    }
+    while (results[0] != 1) {
+        sched_yield();
+    }
+    long value = 1;
+    // The other copy is free, but the next write would reuse the held one.
+    EXPECT_EQ(rcu.write(&value, 1, 0, 0), 0);
+    EXPECT_EQ(rcu.write(&value, 1, 0, 20), -1);
+    EXPECT_EQ(errno, ETIMEDOUT);
+    results[0] = 2;
+    while (results[0] != 3) {
+        sched_yield();
+    }
+    EXPECT_EQ(rcu.write(&value, 1, 0, 0), 0);
+    results[0] = 4;
+    wait(NULL);
+    EXPECT_EQ(rcu.write(&value, 1, 0, 0), 0);
+    EXPECT_EQ(rcu.write(&value, 1, 0, 0), 0);
+}
+
+/// @brief Tested: readers in several processes always see whole versions, in
+///  order, while a writer publishes new ones.
+TEST(ShmRcuTest, ConcurrentReaders) {
+    const int readers = 3, size = 1024, versions = 500;
+    ShmRcu<long> rcu(".", 2, size, 3);
+    // Torn or out of order versions seen by each reader.
+    SharedMemory<long> results(".", 3, readers + 1);
+    for (int r = 0; r <= readers; r++) {
+        results[r] = 0;
+    }
+    for (int r = 0; r < readers; r++) {
+        if (!fork()) {
+            ShmRcu<long> child_rcu(".", 2);
+            long last = 0, errors = 0;
+            while (results[readers] == 0) {
+                const long* version = child_rcu.read_lock();
+                for (int i = 1; i < size; i++) {
+                    if (version[i] != version[0]) {
+                        errors++;
+                        break;
+                    }
+                }
+                if (version[0] < last) {
+                    errors++;
+                }
+                last = version[0];
+                child_rcu.read_unlock();
+                results[r] = -1;    // Started.
+            }
+            results[r] = errors;
+            exit(0);
+        }
+    }
+    for (int r = 0; r < readers; r++) {
+        while (results[r] != -1) {
+            sched_yield();
+        }
+    }
+    for (long v = 1; v <= versions; v++) {
+        long* next = rcu.write_begin(false);
+        ASSERT_NE(next, nullptr);
+        for (int i = 0; i < size; i++) {
+            next[i] = v;
+        }
+        EXPECT_EQ(rcu.publish(), 0);
+    }
+    results[readers] = 1;
+    for (int r = 0; r < readers; r++) {
+        wait(NULL);
+    }
+    for (int r = 0; r < readers; r++) {
+        EXPECT_EQ(results[r], 0);
+    }
+    EXPECT_EQ(rcu.get_generation(), (uint64_t) versions + 1);
+}
+
+/// @brief Tested: slots of readers that exited without destroying their
+///  object are reclaimed when every slot is taken.
+TEST(ShmRcuTest, ReclaimSlots) {
+    const int readers = 4;
+    ShmRcu<long> rcu(".", 2, 8, 2, readers);
+    long value;
+    for (int r = 0; r < 2 * readers; r++) {
+        if (!fork()) {
+            ShmRcu<long> child_rcu(".", 2);
+            exit(child_rcu.read(&value, 1) == 0 ? 0 : 1);   // Keeps its slot.
+        }
+        int status;
+        ASSERT_NE(wait(&status), -1);
+        EXPECT_EQ(WEXITSTATUS(status), 0);
+    }
+    EXPECT_EQ(rcu.read(&value, 1), 0);
+    EXPECT_EQ(rcu.write(&value, 1, 0, 0), 0);
+}
@@ -0,0 +1,100 @@
+#include "shm_ring_queue.h"
+#include "gtest/gtest.h"
+#include <sys/wait.h>
+#include <string.h>
+
+/// @brief Tested: ShmRingQueue::ShmRingQueue(), ShmRingQueue::exists()
+TEST(ShmRingQueueTest, Creation) {
+    EXPECT_FALSE(ShmRingQueue<int>::exists(".", 2));
+    EXPECT_THROW(ShmRingQueue<int>(".", 2), std::runtime_error);
+    ShmRingQueue<int> queue(".", 2, 10);
+    EXPECT_TRUE(ShmRingQueue<int>::exists(".", 2));
+    EXPECT_EQ(queue.get_capacity(), 16);
+    EXPECT_THROW(ShmRingQueue<int>(".", 2, 10), std::runtime_error);
+}
+
+/// @brief Tested: connecting to a memory that doesn't hold a queue, or whose
+///  creator never finished it, throws instead of waiting forever.
+TEST(ShmRingQueueTest, NotAQueue) {
+    SharedMemory<char> shm(".", 2, 4096);
+    memset(&(shm[0]), 0, 4096);
+    EXPECT_THROW(ShmRingQueue<int>(".", 2), std::runtime_error);
+    memset(&(shm[0]), 0xff, 4096);
+    EXPECT_THROW(ShmRingQueue<int>(".", 2), std::runtime_error);
+}
+
+/// @brief Tested: try_write(), try_read(), get_msg_qtty(), is_empty(), has_msg().
+TEST(ShmRingQueueTest, QttyTest) {
+    ShmRingQueue<int> queue(".", 2, 4);
+    int value;
+    EXPECT_TRUE(queue.is_empty());
+    EXPECT_FALSE(queue.has_msg());
+    EXPECT_FALSE(queue.try_read(value));
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.try_write(i));
+    }
+    EXPECT_FALSE(queue.try_write(4));
+    EXPECT_EQ(queue.get_msg_qtty(), 4);
+    EXPECT_TRUE(queue.try_read(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(queue.try_write(4));
+    for (int i = 1; i < 5; i++) {
+        EXPECT_EQ(queue.read(), i);
+    }
+    EXPECT_TRUE(queue.is_empty());
+}
+
+/// @brief Tested: Many messages through a small queue, so that both the
+///  writer and the reader have to wait for each other.
+TEST(ShmRingQueueTest, IntType) {
+    ShmRingQueue<int> queue(".", 2, 8);
+    if (!fork()) {
+        // Child
+        ShmRingQueue<int> child_queue(".", 2);
+        for (int i = 0; i < 100000; i++) {
+            child_queue << i;
+        }
+        exit(0);
+    } else {
+        int value;
+        long sum = 0;
+        for (int i = 0; i < 100000; i++) {
+            queue >> value;
+            ASSERT_EQ(value, i);
+            sum += value;
+        }
+        wait(NULL);
+        EXPECT_EQ(sum, 4999950000L);
+        EXPECT_TRUE(queue.is_empty());
+    }
+}
+
+/// @brief Tested: All IO operations with a struct type, in both directions.
+TEST(ShmRingQueueTest, StructType) {
+    struct person {
+        char name[20];
+        int id;
+    };
+    struct person data;
+    data.id = 10;
+    strcpy(data.name, "co");
+    ShmRingQueue<struct person> to_child(".", 2, 4);
+    ShmRingQueue<struct person> to_parent(".", 3, 4);
+    to_child.write(data);
+    if (!fork()) {
+        // Child
+        struct person child_data;
+        ShmRingQueue<struct person> child_in(".", 2);
+        ShmRingQueue<struct person> child_out(".", 3);
+        child_in >> child_data;
+        strcat(child_data.name, "tti");
+        child_data.id += 10;
+        child_out << child_data;
+        exit(0);
+    } else {
+        wait(NULL);
+        data = to_parent.read();
+        EXPECT_EQ(data.id, 20);
+        EXPECT_STREQ(data.name, "cotti");
+    }
+}
@@ -111,3 +111,11 @@ TEST_F(ThreadTest, SignalThread) {
     Signal::unblock(SIGUSR1);
     EXPECT_EQ(g_value, 1);
 }
+
+/// @brief Tested: Thread::set_affinity()
+TEST_F(ThreadTest, Affinity) {
+    Thread thread(creation_with_mutex_run);
+    EXPECT_EQ(thread.set_affinity(0), 0);
+    thread.join();
+    EXPECT_EQ(g_value, 1);
+}